@@ -0,0 +1,164 @@
+// BVH against testing every box, with the frustum and the ray queries of Render and the picking
+// Random boxes at the same density for 1k, 10k and 100k objects, the camera in the middle of them
+
+#include "BVH.h"
+#include "BoundingVolumes.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static const int CAMERA_COUNT = 64;
+static const int RAY_COUNT = 1000;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double ElapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// The BVH only stores the pointer, the index of the box is kept on it and never dereferenced
+static GameObject* ToUserData(size_t index) { return reinterpret_cast<GameObject*>((uintptr_t)(index + 1)); }
+static size_t FromUserData(GameObject* userData) { return (size_t)reinterpret_cast<uintptr_t>(userData) - 1; }
+
+static bool RunScene(int objectCount)
+{
+    std::mt19937 random(1234);
+    const float side = 4.0f * std::cbrt((float)objectCount);
+    std::uniform_real_distribution<float> position(-side * 0.5f, side * 0.5f);
+    std::uniform_real_distribution<float> size(0.25f, 2.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    std::vector<AABB> boxes(objectCount);
+    for (AABB& box : boxes)
+    {
+        glm::vec3 center(position(random), position(random), position(random));
+        glm::vec3 extents = glm::vec3(size(random), size(random), size(random)) * 0.5f;
+        box.min = center - extents;
+        box.max = center + extents;
+    }
+
+    auto RandomDirection = [&]()
+        {
+            glm::vec3 direction(unit(random), unit(random), unit(random));
+            return (glm::length(direction) > 0.001f) ? glm::normalize(direction) : glm::vec3(0.0f, 0.0f, -1.0f);
+        };
+
+    std::vector<Frustum> frustums(CAMERA_COUNT);
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, side * 0.5f);
+    for (Frustum& frustum : frustums)
+    {
+        glm::vec3 front = RandomDirection();
+        glm::vec3 up = (std::abs(front.y) < 0.99f) ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+        frustum.ExtractFromMatrix(projection * glm::lookAt(glm::vec3(0.0f), front, up));
+    }
+
+    std::vector<Ray> rays(RAY_COUNT);
+    for (Ray& ray : rays) ray = Ray(glm::vec3(0.0f), RandomDirection());
+    const float maxDistance = side;
+
+    // --- Build ---
+    BVH bvh;
+    Clock::time_point start = Clock::now();
+    std::vector<int> proxies(objectCount);
+    for (int i = 0; i < objectCount; ++i) proxies[i] = bvh.CreateProxy(boxes[i], ToUserData(i));
+    double insertMs = ElapsedMs(start);
+    float insertCost = bvh.ComputeCost();
+
+    start = Clock::now();
+    bvh.Rebuild();
+    double rebuildMs = ElapsedMs(start);
+
+    // --- Frustum ---
+    size_t bruteVisible = 0;
+    start = Clock::now();
+    for (const Frustum& frustum : frustums)
+    {
+        for (const AABB& box : boxes)
+        {
+            if (frustum.Intersects(box)) ++bruteVisible;
+        }
+    }
+    double bruteFrustumMs = ElapsedMs(start) / CAMERA_COUNT;
+
+    size_t bvhVisible = 0;
+    std::vector<GameObject*> results;
+    start = Clock::now();
+    for (const Frustum& frustum : frustums)
+    {
+        results.clear();
+        bvh.QueryFrustum(frustum, results);
+        bvhVisible += results.size();
+    }
+    double bvhFrustumMs = ElapsedMs(start) / CAMERA_COUNT;
+
+    // --- Rays, the closest box entry like the picking does before the triangles ---
+    std::vector<float> bruteHits(RAY_COUNT, maxDistance);
+    start = Clock::now();
+    for (int r = 0; r < RAY_COUNT; ++r)
+    {
+        for (const AABB& box : boxes)
+        {
+            float tEntry;
+            if (rays[r].Intersects(box, bruteHits[r], tEntry)) bruteHits[r] = tEntry;
+        }
+    }
+    double bruteRayMs = ElapsedMs(start) / RAY_COUNT;
+
+    std::vector<float> bvhHits(RAY_COUNT, maxDistance);
+    start = Clock::now();
+    for (int r = 0; r < RAY_COUNT; ++r)
+    {
+        const Ray& ray = rays[r];
+        bvhHits[r] = bvh.QueryRay(ray, maxDistance, [&](GameObject* userData, float closest)
+            {
+                float tEntry;
+                return ray.Intersects(boxes[FromUserData(userData)], closest, tEntry) ? tEntry : closest;
+            });
+    }
+    double bvhRayMs = ElapsedMs(start) / RAY_COUNT;
+
+    // --- Refit, a tenth of the objects move a little like with the gizmo ---
+    start = Clock::now();
+    for (int i = 0; i < objectCount; i += 10)
+    {
+        glm::vec3 offset = RandomDirection() * 0.5f;
+        boxes[i].min += offset;
+        boxes[i].max += offset;
+        bvh.MoveProxy(proxies[i], boxes[i]);
+    }
+    double refitMs = ElapsedMs(start);
+
+    printf("%d objects (height %d, SAH cost %.1f inserted, %.1f rebuilt)\n", objectCount, bvh.GetHeight(), insertCost, bvh.ComputeCost());
+    printf("  build:   insert %8.3f ms, rebuild %8.3f ms, refit of %d moved %8.3f ms\n", insertMs, rebuildMs, (objectCount + 9) / 10, refitMs);
+    printf("  frustum: brute force %8.4f ms, BVH %8.4f ms (%.1fx), %zu visible per camera\n",
+        bruteFrustumMs, bvhFrustumMs, (bvhFrustumMs > 0.0) ? bruteFrustumMs / bvhFrustumMs : 0.0, bvhVisible / CAMERA_COUNT);
+    printf("  ray:     brute force %8.4f ms, BVH %8.4f ms (%.1fx)\n",
+        bruteRayMs, bvhRayMs, (bvhRayMs > 0.0) ? bruteRayMs / bvhRayMs : 0.0);
+
+    // The BVH has to give the same answers
+    bool matches = (bruteVisible == bvhVisible);
+    for (int r = 0; r < RAY_COUNT; ++r)
+    {
+        if (std::abs(bruteHits[r] - bvhHits[r]) > 1e-4f) matches = false;
+    }
+    if (!matches) printf("Error: the BVH results are different from the brute force ones\n");
+    return matches;
+}
+
+int main()
+{
+    bool matches = true;
+    for (int objectCount : { 1000, 10000, 100000 })
+    {
+        matches = RunScene(objectCount) && matches;
+    }
+    return matches ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+// Old dynamic_cast scan against the slot table of GameObject::GetComponent on a 10k object scene
+// Each object has a transform and the components Render looks up every frame
+
+#include "GameObject.h"
+#include "ComponentTransform.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+static const int OBJECT_COUNT = 10000;
+static const int FRAMES = 200;
+
+// Stand-ins for the mesh, texture and camera components, the real ones need the Application and a GL context
+template<ComponentType TYPE>
+class BenchComponent : public Component
+{
+public:
+    static constexpr ComponentType staticType = TYPE;
+    BenchComponent(GameObject* owner) : Component(owner, TYPE) {}
+};
+
+using BenchMesh = BenchComponent<ComponentType::MESH>;
+using BenchTexture = BenchComponent<ComponentType::TEXTURE>;
+using BenchCamera = BenchComponent<ComponentType::CAMERA>;
+
+// GetComponent before the slot table: first component that casts to T
+template<typename T>
+static T* ScanComponent(const GameObject& go)
+{
+    for (auto& component : go.components)
+    {
+        T* castedComponent = dynamic_cast<T*>(component.get());
+        if (castedComponent != nullptr)
+        {
+            return castedComponent;
+        }
+    }
+    return nullptr;
+}
+
+// The four lookups of Render::CollectGameObject, the pointers are summed so they can't be optimized away
+template<typename Lookup>
+static double Measure(const std::vector<std::shared_ptr<GameObject>>& objects, Lookup lookup, uintptr_t& checksum)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for (int frame = 0; frame < FRAMES; ++frame)
+    {
+        for (const auto& go : objects) checksum += lookup(*go);
+    }
+    auto endTime = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(endTime - startTime).count() / FRAMES;
+}
+
+int main()
+{
+    std::vector<std::shared_ptr<GameObject>> objects;
+    objects.reserve(OBJECT_COUNT);
+
+    for (int i = 0; i < OBJECT_COUNT; ++i)
+    {
+        auto go = std::make_shared<GameObject>("Object");
+        go->AddComponent(std::make_shared<ComponentTransform>(go.get()));
+        go->AddComponent(std::make_shared<BenchMesh>(go.get()));
+
+        // Like an imported scene: most meshes have a texture, a few objects are cameras
+        if (i % 4 != 0) go->AddComponent(std::make_shared<BenchTexture>(go.get()));
+        if (i % 100 == 0) go->AddComponent(std::make_shared<BenchCamera>(go.get()));
+        objects.push_back(go);
+    }
+
+    uintptr_t scanChecksum = 0;
+    uintptr_t slotChecksum = 0;
+
+    double scanMs = Measure(objects, [](const GameObject& go)
+        {
+            return (uintptr_t)ScanComponent<ComponentTransform>(go) + (uintptr_t)ScanComponent<BenchMesh>(go) +
+                (uintptr_t)ScanComponent<BenchTexture>(go) + (uintptr_t)ScanComponent<BenchCamera>(go);
+        }, scanChecksum);
+
+    double slotMs = Measure(objects, [](const GameObject& go)
+        {
+            return (uintptr_t)go.GetComponent<ComponentTransform>() + (uintptr_t)go.GetComponent<BenchMesh>() +
+                (uintptr_t)go.GetComponent<BenchTexture>() + (uintptr_t)go.GetComponent<BenchCamera>();
+        }, slotChecksum);
+
+    printf("GetComponent, %d objects, 4 lookups each, average of %d frames\n", OBJECT_COUNT, FRAMES);
+    printf("  dynamic_cast scan: %8.3f ms per frame\n", scanMs);
+    printf("  slot table:        %8.3f ms per frame (%.1fx)\n", slotMs, (slotMs > 0.0) ? scanMs / slotMs : 0.0);
+
+    // Both must find the same components
+    if (scanChecksum != slotChecksum)
+    {
+        printf("Error: the lookups returned different components\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,199 @@
+// The first .rgs format read with the streams against the versioned one mapped, same synthetic mesh on both
+// Each reader runs on its own process, started from this one, so the peak memory is only of that reader
+// The bytes are summed after each load as the upload to the GPU would read them
+
+#include "MeshFile.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+static const unsigned int GRID_SIZE = 1024; // Vertices per side, about 2M triangles
+static const int LOAD_COUNT = 10;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Same as LoadFiles, highest RAM used by the process since it started
+static size_t GetPeakMemoryMB()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+    {
+        return pmc.PeakWorkingSetSize / (1024 * 1024);
+    }
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+#ifdef __APPLE__
+        return (size_t)usage.ru_maxrss / (1024 * 1024);
+#else
+        return (size_t)usage.ru_maxrss / 1024;
+#endif
+    }
+#endif
+    return 0;
+}
+
+static std::string GetFilePath(const char* version)
+{
+    return (std::filesystem::temp_directory_path() / (std::string("MeshLoadBenchmark_") + version + ".rgs")).string();
+}
+
+static uint64_t SumBytes(const void* data, size_t size, uint64_t sum)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i += 64) sum += bytes[i];
+    return sum;
+}
+
+// A wavy grid with normals and UVs, written as the first .rgs files and as the current ones
+static bool WriteFiles()
+{
+    const unsigned int vertexCount = GRID_SIZE * GRID_SIZE;
+    std::vector<float> positions((size_t)vertexCount * 3);
+    std::vector<float> normals((size_t)vertexCount * 3);
+    std::vector<float> texCoords((size_t)vertexCount * 2);
+    for (unsigned int y = 0; y < GRID_SIZE; ++y)
+    {
+        for (unsigned int x = 0; x < GRID_SIZE; ++x)
+        {
+            size_t v = (size_t)y * GRID_SIZE + x;
+            float u = (float)x / (GRID_SIZE - 1);
+            float w = (float)y / (GRID_SIZE - 1);
+            positions[v * 3 + 0] = u * 10.0f;
+            positions[v * 3 + 1] = 0.2f * std::sin(u * 40.0f) * std::cos(w * 40.0f);
+            positions[v * 3 + 2] = w * 10.0f;
+            normals[v * 3 + 1] = 1.0f;
+            texCoords[v * 2 + 0] = u;
+            texCoords[v * 2 + 1] = w;
+        }
+    }
+
+    std::vector<unsigned int> indices;
+    indices.reserve((size_t)(GRID_SIZE - 1) * (GRID_SIZE - 1) * 6);
+    for (unsigned int y = 0; y + 1 < GRID_SIZE; ++y)
+    {
+        for (unsigned int x = 0; x + 1 < GRID_SIZE; ++x)
+        {
+            unsigned int v = y * GRID_SIZE + x;
+            indices.insert(indices.end(), { v, v + GRID_SIZE, v + 1, v + 1, v + GRID_SIZE, v + GRID_SIZE + 1 });
+        }
+    }
+
+    // First format: the header and the float streams in the order LoadOldMeshFormat reads them
+    MeshFileHeader header;
+    header.numVertices = vertexCount;
+    header.numIndices = (unsigned int)indices.size();
+    header.hasNormals = true;
+    header.hasTexCoords = true;
+
+    std::ofstream file(GetFilePath("v1"), std::ios::binary | std::ios::trunc);
+    file.write((const char*)&header, sizeof(MeshFileHeader));
+    file.write((const char*)positions.data(), positions.size() * sizeof(float));
+    file.write((const char*)indices.data(), indices.size() * sizeof(unsigned int));
+    file.write((const char*)normals.data(), normals.size() * sizeof(float));
+    file.write((const char*)texCoords.data(), texCoords.size() * sizeof(float));
+    if (!file) return false;
+    file.close();
+
+    // Current format, packed with the quantized positions the engine uses by default
+    MeshData meshData;
+    meshData.packed = VertexFormat::Pack(positions.data(), vertexCount, indices.data(), (unsigned int)indices.size(), texCoords.data(), normals.data(), true);
+    return MeshFile::Save(GetFilePath("current").c_str(), meshData);
+}
+
+// Loads the file of one reader LOAD_COUNT times, prints the time and the peak memory
+static int RunReader(const std::string& reader)
+{
+    const bool mapped = (reader == "current");
+    const std::string path = GetFilePath(mapped ? "current" : "v1");
+
+    double totalMs = 0.0;
+    uint64_t sum = 0;
+    for (int i = 0; i < LOAD_COUNT; ++i)
+    {
+        MeshData meshData;
+        Clock::time_point start = Clock::now();
+
+        bool loaded = false;
+        if (mapped)
+        {
+            meshData.mappedFile = std::make_unique<MappedFile>();
+            loaded = meshData.mappedFile->Open(path.c_str()) && MeshFile::ReadMapped(path.c_str(), meshData);
+            if (loaded)
+            {
+                sum = SumBytes(meshData.view.vertices, meshData.view.GetVertexBytes(), sum);
+                sum = SumBytes(meshData.view.indices, meshData.view.GetIndexBytes(), sum);
+            }
+        }
+        else
+        {
+            loaded = MeshFile::ReadOld(path.c_str(), meshData);
+            if (loaded)
+            {
+                sum = SumBytes(meshData.vertices, (size_t)meshData.num_vertices * 3 * sizeof(float), sum);
+                sum = SumBytes(meshData.indices, (size_t)meshData.num_indices * sizeof(unsigned int), sum);
+                sum = SumBytes(meshData.normals, (size_t)meshData.num_vertices * 3 * sizeof(float), sum);
+                sum = SumBytes(meshData.texCoords, (size_t)meshData.num_vertices * 2 * sizeof(float), sum);
+            }
+        }
+
+        totalMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        MeshFile::ReleaseStreams(meshData);
+
+        if (!loaded)
+        {
+            printf("Error: could not load %s\n", path.c_str());
+            return 1;
+        }
+    }
+
+    std::error_code error;
+    printf("%-8s %8.2f MB file, %8.3f ms per load, peak memory %d MB (checksum %llu)\n", mapped ? "mapped" : "v1",
+        std::filesystem::file_size(path, error) / (1024.0 * 1024.0), totalMs / LOAD_COUNT, (int)GetPeakMemoryMB(), (unsigned long long)sum);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1) return RunReader(argv[1]);
+
+    // The readers start from new processes, so the mesh built here to write the files doesn't count on their peaks
+    if (!WriteFiles())
+    {
+        printf("Error: could not write the benchmark files\n");
+        return 1;
+    }
+
+    printf("%u vertices, %u triangles, average of %d loads, the files are on the OS cache after being written\n",
+        GRID_SIZE * GRID_SIZE, (GRID_SIZE - 1) * (GRID_SIZE - 1) * 2, LOAD_COUNT);
+    fflush(stdout);
+
+    const std::string self = std::string("\"") + argv[0] + "\"";
+    int result = 0;
+    if (std::system((self + " v1").c_str()) != 0) result = 1;
+    if (std::system((self + " current").c_str()) != 0) result = 1;
+
+    std::error_code error;
+    std::filesystem::remove(GetFilePath("v1"), error);
+    std::filesystem::remove(GetFilePath("current"), error);
+    return result;
+}
@@ -0,0 +1,131 @@
+// TransformSystem::UpdateWorldMatrices on 100k transforms, on the calling thread and split with ParallelFor
+// A wide hierarchy (one level of 100k children), a deep one (chains 2000 transforms long) and a tree with 4 children per node
+// Every root moves each frame, so all the world matrices are calculated again
+
+#include "TransformSystem.h"
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+static const uint32_t TRANSFORM_COUNT = 100000;
+static const int FRAMES = 50;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double ElapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Builds the hierarchy with parentOf(i), which is always lower than i, and returns the handles
+static std::vector<TransformHandle> CreateScene(const std::function<uint32_t(uint32_t)>& parentOf)
+{
+    TransformSystem& transforms = TransformSystem::GetInstance();
+
+    std::vector<TransformHandle> handles(TRANSFORM_COUNT);
+    for (uint32_t i = 0; i < TRANSFORM_COUNT; ++i)
+    {
+        handles[i] = transforms.Create();
+        transforms.SetPosition(handles[i], glm::vec3(0.01f * (i % 7), 0.02f * (i % 5), 0.5f));
+        transforms.SetRotation(handles[i], glm::quat(glm::vec3(0.001f * (i % 11), 0.002f * (i % 13), 0.0f)));
+
+        uint32_t parent = parentOf(i);
+        if (parent != INVALID_TRANSFORM) transforms.SetParent(handles[i], handles[parent]);
+    }
+    transforms.UpdateWorldMatrices();
+    return handles;
+}
+
+static void DestroyScene(const std::vector<TransformHandle>& handles)
+{
+    TransformSystem& transforms = TransformSystem::GetInstance();
+    for (TransformHandle handle : handles) transforms.Destroy(handle);
+    transforms.UpdateWorldMatrices();
+}
+
+// Moves the roots and runs the frame pass, the world matrices of the last frame are copied to worlds
+static double MeasureUpdate(const std::vector<TransformHandle>& handles, const std::vector<uint32_t>& roots, std::vector<glm::mat4>& worlds)
+{
+    TransformSystem& transforms = TransformSystem::GetInstance();
+
+    double totalMs = 0.0;
+    for (int frame = 0; frame < FRAMES; ++frame)
+    {
+        for (uint32_t root : roots) transforms.SetPosition(handles[root], glm::vec3((float)frame, 0.0f, 0.0f));
+
+        Clock::time_point start = Clock::now();
+        transforms.UpdateWorldMatrices();
+        totalMs += ElapsedMs(start);
+    }
+
+    worlds.resize(handles.size());
+    for (size_t i = 0; i < handles.size(); ++i) worlds[i] = transforms.GetWorldMatrix(handles[i]);
+    return totalMs / FRAMES;
+}
+
+static bool SameMatrices(const std::vector<glm::mat4>& a, const std::vector<glm::mat4>& b)
+{
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(glm::mat4)) == 0;
+}
+
+static bool RunScene(const char* name, const std::function<uint32_t(uint32_t)>& parentOf)
+{
+    TransformSystem& transforms = TransformSystem::GetInstance();
+    std::vector<TransformHandle> handles = CreateScene(parentOf);
+
+    std::vector<uint32_t> roots;
+    for (uint32_t i = 0; i < TRANSFORM_COUNT; ++i)
+    {
+        if (parentOf(i) == INVALID_TRANSFORM) roots.push_back(i);
+    }
+
+    // Without workers ParallelFor runs the whole range on the calling thread
+    JobSystem::GetInstance().Shutdown();
+    std::vector<glm::mat4> serialWorlds;
+    double serialMs = MeasureUpdate(handles, roots, serialWorlds);
+
+    JobSystem::GetInstance().Init();
+    std::vector<glm::mat4> parallelWorlds;
+    double parallelMs = MeasureUpdate(handles, roots, parallelWorlds);
+
+    // GetWorldMatrix of everything after a change and before the frame pass, each parent is calculated once
+    for (uint32_t root : roots) transforms.SetPosition(handles[root], glm::vec3((float)(FRAMES - 1), 0.0f, 0.0f));
+    std::vector<glm::mat4> pendingWorlds(handles.size());
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < handles.size(); ++i) pendingWorlds[i] = transforms.GetWorldMatrix(handles[i]);
+    double pendingMs = ElapsedMs(start);
+    transforms.UpdateWorldMatrices();
+
+    printf("%s: %u transforms, %u updated per frame\n", name, transforms.GetCount(), transforms.GetLastUpdatedCount());
+    printf("  UpdateWorldMatrices: serial %8.3f ms, ParallelFor on %u workers %8.3f ms (%.1fx)\n",
+        serialMs, JobSystem::GetInstance().GetWorkerCount(), parallelMs, (parallelMs > 0.0) ? serialMs / parallelMs : 0.0);
+    printf("  GetWorldMatrix of all with pending changes: %8.3f ms\n", pendingMs);
+
+    // The three ways must give the same matrices
+    bool matches = SameMatrices(serialWorlds, parallelWorlds) && SameMatrices(serialWorlds, pendingWorlds);
+    if (!matches) printf("Error: the world matrices are different\n");
+
+    DestroyScene(handles);
+    return matches;
+}
+
+int main()
+{
+    bool matches = true;
+
+    matches = RunScene("Wide", [](uint32_t i) { return (i == 0) ? INVALID_TRANSFORM : 0u; }) && matches;
+
+    const uint32_t chainLength = 2000;
+    matches = RunScene("Deep", [chainLength](uint32_t i) { return (i % chainLength == 0) ? INVALID_TRANSFORM : i - 1; }) && matches;
+
+    matches = RunScene("Tree", [](uint32_t i) { return (i == 0) ? INVALID_TRANSFORM : (i - 1) / 4; }) && matches;
+
+    JobSystem::GetInstance().Shutdown();
+    return matches ? 0 : 1;
+}
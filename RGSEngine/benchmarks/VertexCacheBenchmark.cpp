@@ -0,0 +1,144 @@
+// MeshOptimizer vertex cache pass on generated grids and spheres, the ACMR and ATVR before and after it
+// Each mesh also runs with its triangles shuffled, like the meshes exported without any order
+// The cache simulated is the FIFO of 16 vertices of AnalyzeVertexCache
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double ElapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Rows of quads of (size - 1) x (size - 1), in the order of the rows
+static std::vector<unsigned int> CreateGrid(unsigned int size, unsigned int& vertexCount)
+{
+    vertexCount = size * size;
+    std::vector<unsigned int> indices;
+    indices.reserve((size_t)(size - 1) * (size - 1) * 6);
+    for (unsigned int y = 0; y + 1 < size; ++y)
+    {
+        for (unsigned int x = 0; x + 1 < size; ++x)
+        {
+            unsigned int v = y * size + x;
+            indices.insert(indices.end(), { v, v + size, v + 1, v + 1, v + size, v + size + 1 });
+        }
+    }
+    return indices;
+}
+
+// UV sphere of rings x segments, with a vertex per pole and the seam sharing its vertices
+static std::vector<unsigned int> CreateSphere(unsigned int rings, unsigned int segments, unsigned int& vertexCount)
+{
+    // Pole 0, rings - 1 circles of segments vertices, pole 1
+    const unsigned int bottom = 1 + (rings - 1) * segments;
+    vertexCount = bottom + 1;
+    auto Ring = [segments](unsigned int ring, unsigned int segment) { return 1 + (ring - 1) * segments + segment % segments; };
+
+    std::vector<unsigned int> indices;
+    for (unsigned int s = 0; s < segments; ++s) indices.insert(indices.end(), { 0, Ring(1, s), Ring(1, s + 1) });
+    for (unsigned int r = 1; r + 1 < rings; ++r)
+    {
+        for (unsigned int s = 0; s < segments; ++s)
+        {
+            indices.insert(indices.end(), { Ring(r, s), Ring(r + 1, s), Ring(r, s + 1) });
+            indices.insert(indices.end(), { Ring(r, s + 1), Ring(r + 1, s), Ring(r + 1, s + 1) });
+        }
+    }
+    for (unsigned int s = 0; s < segments; ++s) indices.insert(indices.end(), { Ring(rings - 1, s), bottom, Ring(rings - 1, s + 1) });
+    return indices;
+}
+
+static void ShuffleTriangles(std::vector<unsigned int>& indices)
+{
+    std::vector<std::array<unsigned int, 3>> triangles(indices.size() / 3);
+    for (size_t t = 0; t < triangles.size(); ++t) triangles[t] = { indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] };
+
+    std::mt19937 random(1234);
+    std::shuffle(triangles.begin(), triangles.end(), random);
+    for (size_t t = 0; t < triangles.size(); ++t) std::copy(triangles[t].begin(), triangles[t].end(), indices.begin() + t * 3);
+}
+
+// The triangles sorted, each one rotated to start on its lowest index so the winding is kept
+static std::vector<std::array<unsigned int, 3>> SortedTriangles(const std::vector<unsigned int>& indices)
+{
+    std::vector<std::array<unsigned int, 3>> triangles(indices.size() / 3);
+    for (size_t t = 0; t < triangles.size(); ++t)
+    {
+        std::array<unsigned int, 3> triangle = { indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] };
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        triangles[t] = triangle;
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+static bool RunMesh(const char* name, std::vector<unsigned int> indices, unsigned int vertexCount)
+{
+    const std::vector<std::array<unsigned int, 3>> originalTriangles = SortedTriangles(indices);
+    MeshOptimizer::CacheStats before = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertexCount);
+
+    Clock::time_point start = Clock::now();
+    MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), vertexCount);
+    double cacheMs = ElapsedMs(start);
+    MeshOptimizer::CacheStats after = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertexCount);
+
+    // Only the order can change
+    bool matches = (SortedTriangles(indices) == originalTriangles);
+
+    // The fetch order is done after it on the import, it renumbers the vertices but keeps the cache hits
+    start = Clock::now();
+    unsigned int newVertexCount = 0;
+    MeshOptimizer::OptimizeVertexFetch(indices.data(), indices.size(), vertexCount, newVertexCount);
+    double fetchMs = ElapsedMs(start);
+    MeshOptimizer::CacheStats fetched = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), newVertexCount);
+    matches = matches && (newVertexCount == vertexCount) && (fetched.acmr == after.acmr);
+
+    printf("%-28s %8zu triangles  ACMR %.3f -> %.3f  ATVR %.3f -> %.3f  (cache %8.3f ms, fetch %7.3f ms)\n",
+        name, indices.size() / 3, before.acmr, after.acmr, before.atvr, after.atvr, cacheMs, fetchMs);
+
+    if (!matches) printf("Error: the optimized mesh of %s doesn't have the same triangles\n", name);
+    return matches;
+}
+
+int main()
+{
+    bool matches = true;
+    char name[64];
+
+    for (unsigned int size : { 16u, 128u, 1024u })
+    {
+        unsigned int vertexCount = 0;
+        std::vector<unsigned int> indices = CreateGrid(size, vertexCount);
+
+        snprintf(name, sizeof(name), "Grid %ux%u", size, size);
+        matches = RunMesh(name, indices, vertexCount) && matches;
+
+        ShuffleTriangles(indices);
+        snprintf(name, sizeof(name), "Grid %ux%u shuffled", size, size);
+        matches = RunMesh(name, indices, vertexCount) && matches;
+    }
+
+    for (unsigned int rings : { 16u, 128u, 512u })
+    {
+        unsigned int vertexCount = 0;
+        std::vector<unsigned int> indices = CreateSphere(rings, rings * 2, vertexCount);
+
+        snprintf(name, sizeof(name), "Sphere %ux%u", rings, rings * 2);
+        matches = RunMesh(name, indices, vertexCount) && matches;
+
+        ShuffleTriangles(indices);
+        snprintf(name, sizeof(name), "Sphere %ux%u shuffled", rings, rings * 2);
+        matches = RunMesh(name, indices, vertexCount) && matches;
+    }
+
+    return matches ? 0 : 1;
+}
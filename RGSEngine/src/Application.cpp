@@ -8,7 +8,10 @@
 #include "LoadFiles.h"
 #include "ModuleScene.h"
 #include "ModuleEditor.h"
+#include "ModuleResources.h"
 #include "Time.h"
+#include "JobSystem.h"
+#include "TransformSystem.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
@@ -21,12 +24,16 @@ Application::Application() {
 
     LOG("Constructor Application::Application");
 
+    // Created before the modules so it's destroyed after them, the transforms of the scene release their handles on it
+    TransformSystem::GetInstance();
+
     // Modules
     window = std::make_shared<Window>();
     input = std::make_shared<Input>();
     scene = std::make_shared<ModuleScene>();
     editor = std::make_shared<ModuleEditor>();
     render = std::make_shared<Render>();
+    resources = std::make_shared<ModuleResources>();
     loadFiles = std::make_shared<LoadFiles>();
 
     // Ordered for awake / Start / Update
@@ -36,6 +43,7 @@ Application::Application() {
     AddModule(std::static_pointer_cast<Module>(scene));
     AddModule(std::static_pointer_cast<Module>(editor));
     AddModule(std::static_pointer_cast<Module>(render));
+    AddModule(std::static_pointer_cast<Module>(resources));
     AddModule(std::static_pointer_cast<Module>(loadFiles));
 
     // Render last 
@@ -60,6 +68,8 @@ bool Application::Awake() {
 
     std::cout << "DIRECTORIO ACTUAL: " << std::filesystem::current_path() << std::endl;
 
+    JobSystem::GetInstance().Init();
+
     //Iterates the module list and calls Awake on each module
     bool result = true;
     for (const auto& module : moduleList) {
@@ -125,6 +135,8 @@ bool Application::CleanUp() {
         }
     }
 
+    JobSystem::GetInstance().Shutdown();
+
     return result;
 }
 
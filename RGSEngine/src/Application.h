@@ -13,6 +13,7 @@ class Render;
 class ModuleScene;
 class ModuleEditor;
 class LoadFiles;
+class ModuleResources;
 
 class Application
 {
@@ -73,6 +74,7 @@ public:
     std::shared_ptr<Render> render;
     std::shared_ptr<ModuleScene> scene;
     std::shared_ptr<ModuleEditor> editor;
+    std::shared_ptr<ModuleResources> resources;
     std::shared_ptr<LoadFiles> loadFiles;
 
     bool isGameMode = false;
@@ -0,0 +1,260 @@
+#include "AssetDatabase.h"
+#include "Log.h"
+
+#include <nlohmann/json.hpp>
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+
+static const int ASSET_DATABASE_VERSION = 1;
+
+static std::string ToHex(uint64_t value)
+{
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long)value);
+    return buffer;
+}
+
+static uint64_t FromHex(const std::string& text)
+{
+    return (uint64_t)strtoull(text.c_str(), nullptr, 16);
+}
+
+// The same file reached by different relative paths is one entry
+static std::string NormalizePath(const std::string& path)
+{
+    return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+static bool GetFileStamp(const std::string& path, uint64_t& size, int64_t& writeTime)
+{
+    std::error_code error;
+    size = (uint64_t)std::filesystem::file_size(path, error);
+    if (error) return false;
+
+    auto time = std::filesystem::last_write_time(path, error);
+    if (error) return false;
+
+    writeTime = (int64_t)time.time_since_epoch().count();
+    return true;
+}
+
+uint64_t AssetDatabase::Hash(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool AssetDatabase::HashFile(const std::string& path, uint64_t& hash)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    std::vector<char> buffer(1 << 20);
+    hash = 14695981039346656037ull;
+    while (file)
+    {
+        file.read(buffer.data(), buffer.size());
+        hash = Hash(buffer.data(), (size_t)file.gcount(), hash);
+    }
+    return file.eof();
+}
+
+void AssetDatabase::Load(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    indexPath = path;
+    entries.clear();
+    staleArtifacts.clear();
+    dirty = false;
+
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        LOG("Asset database not found, the sources will be imported again: %s", path.c_str());
+        return;
+    }
+
+    nlohmann::json index = nlohmann::json::parse(file, nullptr, false);
+    if (index.is_discarded() || index.value("version", 0) != ASSET_DATABASE_VERSION || !index.contains("sources"))
+    {
+        LOG("Invalid asset database, the sources will be imported again: %s", path.c_str());
+        return;
+    }
+
+    for (const auto& source : index["sources"])
+    {
+        Entry entry;
+        entry.fileSize = source.value("size", (uint64_t)0);
+        entry.writeTime = source.value("writeTime", (int64_t)0);
+        entry.contentHash = FromHex(source.value("contentHash", std::string()));
+        entry.settingsHash = FromHex(source.value("settingsHash", std::string()));
+        entry.key = source.value("key", std::string());
+        entry.artifacts = source.value("artifacts", std::vector<std::string>());
+
+        std::string sourcePath = source.value("path", std::string());
+        if (!sourcePath.empty() && !entry.key.empty()) entries[sourcePath] = std::move(entry);
+    }
+    staleArtifacts = index.value("staleArtifacts", std::vector<std::string>());
+
+    // Nothing is loaded yet, so no resource has them mapped
+    RemoveStaleArtifacts();
+
+    LOG("Asset database loaded: %d sources", (int)entries.size());
+}
+
+void AssetDatabase::Save()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!dirty || indexPath.empty()) return;
+
+    nlohmann::json sources = nlohmann::json::array();
+    for (const auto& [sourcePath, entry] : entries)
+    {
+        sources.push_back({
+            { "path", sourcePath },
+            { "size", entry.fileSize },
+            { "writeTime", entry.writeTime },
+            { "contentHash", ToHex(entry.contentHash) },
+            { "settingsHash", ToHex(entry.settingsHash) },
+            { "key", entry.key },
+            { "artifacts", entry.artifacts } });
+    }
+
+    nlohmann::json index = { { "version", ASSET_DATABASE_VERSION }, { "sources", sources }, { "staleArtifacts", staleArtifacts } };
+
+    std::ofstream file(indexPath, std::ios::trunc);
+    if (!file.is_open())
+    {
+        LOG("Error saving the asset database: %s", indexPath.c_str());
+        return;
+    }
+
+    file << index.dump(1);
+    dirty = false;
+}
+
+std::string AssetDatabase::GetSourceKey(const std::string& sourcePath, uint64_t settingsHash)
+{
+    const std::string path = NormalizePath(sourcePath);
+
+    uint64_t fileSize = 0;
+    int64_t writeTime = 0;
+    if (!GetFileStamp(path, fileSize, writeTime)) return std::string();
+
+    uint64_t contentHash = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(path);
+        if (it != entries.end() && it->second.fileSize == fileSize && it->second.writeTime == writeTime)
+        {
+            if (it->second.settingsHash == settingsHash) return it->second.key;
+            contentHash = it->second.contentHash;
+        }
+    }
+
+    // Outside the lock, a big FBX takes a while and the other sources don't have to wait for it
+    if (contentHash == 0 && !HashFile(path, contentHash))
+    {
+        LOG("Error reading the source to hash it: %s", path.c_str());
+        return std::string();
+    }
+
+    uint64_t keyHash = Hash(&settingsHash, sizeof(settingsHash), contentHash);
+    std::string key = ToHex(keyHash);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry& entry = entries[path];
+
+    if (!entry.key.empty() && entry.key != key)
+    {
+        LOG("Source changed, importing it again: %s", path.c_str());
+        if (!IsKeyUsed(entry.key, path))
+        {
+            for (const std::string& artifact : entry.artifacts)
+            {
+                if (std::find(staleArtifacts.begin(), staleArtifacts.end(), artifact) == staleArtifacts.end()) staleArtifacts.push_back(artifact);
+            }
+        }
+        entry.artifacts.clear();
+    }
+
+    entry.fileSize = fileSize;
+    entry.writeTime = writeTime;
+    entry.contentHash = contentHash;
+    entry.settingsHash = settingsHash;
+    entry.key = key;
+    dirty = true;
+    return key;
+}
+
+void AssetDatabase::AddArtifact(const std::string& sourcePath, const std::string& artifactPath)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(NormalizePath(sourcePath));
+    if (it == entries.end()) return;
+
+    std::vector<std::string>& artifacts = it->second.artifacts;
+    if (std::find(artifacts.begin(), artifacts.end(), artifactPath) != artifacts.end()) return;
+
+    artifacts.push_back(artifactPath);
+    staleArtifacts.erase(std::remove(staleArtifacts.begin(), staleArtifacts.end(), artifactPath), staleArtifacts.end());
+    dirty = true;
+}
+
+size_t AssetDatabase::GetSourceCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+bool AssetDatabase::IsKeyUsed(const std::string& key, const std::string& exceptSource) const
+{
+    // Copies of the same file on different paths share the artifacts
+    for (const auto& [sourcePath, entry] : entries)
+    {
+        if (sourcePath != exceptSource && entry.key == key) return true;
+    }
+    return false;
+}
+
+bool AssetDatabase::IsArtifactUsed(const std::string& artifactPath) const
+{
+    for (const auto& [sourcePath, entry] : entries)
+    {
+        if (std::find(entry.artifacts.begin(), entry.artifacts.end(), artifactPath) != entry.artifacts.end()) return true;
+    }
+    return false;
+}
+
+void AssetDatabase::RemoveStaleArtifacts()
+{
+    size_t kept = 0;
+    int removed = 0;
+    for (const std::string& artifact : staleArtifacts)
+    {
+        if (IsArtifactUsed(artifact)) continue;
+
+        std::error_code error;
+        if (std::filesystem::remove(artifact, error) || !std::filesystem::exists(artifact, error))
+        {
+            ++removed;
+            continue;
+        }
+        staleArtifacts[kept++] = artifact;
+    }
+
+    if (kept != staleArtifacts.size())
+    {
+        staleArtifacts.resize(kept);
+        dirty = true;
+    }
+    if (removed > 0) LOG("Removed %d Library files of changed sources", removed);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+
+// Index of the imported source files, saved as Library/AssetDatabase.json
+// Each source gets a key from the hash of its content and of the import settings, the Library artifacts are named with it
+// So two sources with the same file or mesh names don't collide, and an edited source is imported again
+class AssetDatabase
+{
+public:
+
+    void Load(const std::string& path);
+
+    // Only writes the file if something changed since the last Load or Save
+    void Save();
+
+    // Key of the artifacts of the source with these settings, empty if the source can't be read
+    // The content is only hashed again when the size or the write time of the file change
+    // The artifacts of the previous key are deleted on the next Load if no source uses them by then, a resource may still have them mapped
+    // Can be called from the workers
+    std::string GetSourceKey(const std::string& sourcePath, uint64_t settingsHash);
+
+    // Registers a file created from the source, so it can be removed when the source changes
+    void AddArtifact(const std::string& sourcePath, const std::string& artifactPath);
+
+    size_t GetSourceCount();
+
+    // FNV-1a 64, seed is the hash of the previous data when several values are combined
+    static uint64_t Hash(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+    static bool HashFile(const std::string& path, uint64_t& hash);
+
+private:
+
+    struct Entry
+    {
+        uint64_t fileSize = 0;
+        int64_t writeTime = 0;
+        uint64_t contentHash = 0;
+        uint64_t settingsHash = 0;
+        std::string key;
+        std::vector<std::string> artifacts;
+    };
+
+    bool IsKeyUsed(const std::string& key, const std::string& exceptSource) const;
+    bool IsArtifactUsed(const std::string& artifactPath) const;
+
+    // Removes the stale artifacts no source uses, the ones that can't be deleted yet stay for the next Load
+    void RemoveStaleArtifacts();
+
+    std::unordered_map<std::string, Entry> entries;
+    std::vector<std::string> staleArtifacts;
+    std::string indexPath;
+    bool dirty = false;
+
+    // The FBX imports and the texture decodes ask for keys from the workers
+    std::mutex mutex;
+};
@@ -0,0 +1,445 @@
+#include "BVH.h"
+
+#include <algorithm>
+
+// Number of buckets used to evaluate the splits on the SAH rebuild
+static const int SAH_BINS = 12;
+
+BVH::BVH()
+{
+}
+
+BVH::~BVH()
+{
+}
+
+int BVH::AllocateNode()
+{
+    if (freeList == NULL_NODE)
+    {
+        nodes.emplace_back();
+        Node& node = nodes.back();
+        node.height = 0;
+        return (int)nodes.size() - 1;
+    }
+
+    int index = freeList;
+    freeList = nodes[index].next;
+
+    nodes[index] = Node();
+    nodes[index].height = 0;
+    return index;
+}
+
+void BVH::FreeNode(int node)
+{
+    nodes[node].next = freeList;
+    nodes[node].height = -1;
+    nodes[node].userData = nullptr;
+    freeList = node;
+}
+
+int BVH::CreateProxy(const AABB& box, GameObject* userData)
+{
+    int leaf = AllocateNode();
+    nodes[leaf].box = box;
+    nodes[leaf].userData = userData;
+
+    InsertLeaf(leaf);
+    ++proxyCount;
+
+    return leaf;
+}
+
+void BVH::DestroyProxy(int proxy)
+{
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    --proxyCount;
+}
+
+bool BVH::MoveProxy(int proxy, const AABB& box)
+{
+    Node& leaf = nodes[proxy];
+    if (leaf.box.min == box.min && leaf.box.max == box.max) return false;
+
+    leaf.box = box;
+    RefitAncestors(leaf.parent);
+    return true;
+}
+
+void BVH::Clear()
+{
+    nodes.clear();
+    root = NULL_NODE;
+    freeList = NULL_NODE;
+    proxyCount = 0;
+}
+
+void BVH::InsertLeaf(int leaf)
+{
+    if (root == NULL_NODE)
+    {
+        root = leaf;
+        nodes[root].parent = NULL_NODE;
+        return;
+    }
+
+    // Find the best sibling going down the tree, each step picks the child with the lowest SAH cost
+    // The cost includes the area that the ancestors grow (inheritance) when the leaf is added
+    // Copied because allocating the new parent can grow the nodes vector
+    const AABB leafBox = nodes[leaf].box;
+    int index = root;
+    while (!nodes[index].IsLeaf())
+    {
+        const Node& node = nodes[index];
+        int child1 = node.child1;
+        int child2 = node.child2;
+
+        float area = node.box.GetSurfaceArea();
+        float combinedArea = AABB::Union(node.box, leafBox).GetSurfaceArea();
+
+        // Cost of making a new parent for this node and the leaf
+        float cost = 2.0f * combinedArea;
+
+        // Minimum cost of pushing the leaf further down the tree
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        float cost1 = AABB::Union(leafBox, nodes[child1].box).GetSurfaceArea() + inheritanceCost;
+        if (!nodes[child1].IsLeaf()) cost1 -= nodes[child1].box.GetSurfaceArea();
+
+        float cost2 = AABB::Union(leafBox, nodes[child2].box).GetSurfaceArea() + inheritanceCost;
+        if (!nodes[child2].IsLeaf()) cost2 -= nodes[child2].box.GetSurfaceArea();
+
+        if (cost < cost1 && cost < cost2) break;
+
+        index = (cost1 < cost2) ? child1 : child2;
+    }
+
+    int sibling = index;
+
+    // New parent for the sibling and the leaf
+    int oldParent = nodes[sibling].parent;
+    int newParent = AllocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].box = AABB::Union(leafBox, nodes[sibling].box);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent != NULL_NODE)
+    {
+        if (nodes[oldParent].child1 == sibling)
+            nodes[oldParent].child1 = newParent;
+        else
+            nodes[oldParent].child2 = newParent;
+    }
+    else
+    {
+        root = newParent;
+    }
+
+    RefitAncestors(nodes[newParent].parent);
+}
+
+void BVH::RemoveLeaf(int leaf)
+{
+    if (leaf == root)
+    {
+        root = NULL_NODE;
+        return;
+    }
+
+    // The sibling takes the place of the parent
+    int parent = nodes[leaf].parent;
+    int grandParent = nodes[parent].parent;
+    int sibling = (nodes[parent].child1 == leaf) ? nodes[parent].child2 : nodes[parent].child1;
+
+    if (grandParent != NULL_NODE)
+    {
+        if (nodes[grandParent].child1 == parent)
+            nodes[grandParent].child1 = sibling;
+        else
+            nodes[grandParent].child2 = sibling;
+
+        nodes[sibling].parent = grandParent;
+        FreeNode(parent);
+
+        RefitAncestors(grandParent);
+    }
+    else
+    {
+        root = sibling;
+        nodes[sibling].parent = NULL_NODE;
+        FreeNode(parent);
+    }
+
+    nodes[leaf].parent = NULL_NODE;
+}
+
+void BVH::RefitAncestors(int node)
+{
+    while (node != NULL_NODE)
+    {
+        Node& current = nodes[node];
+        const Node& child1 = nodes[current.child1];
+        const Node& child2 = nodes[current.child2];
+
+        current.box = AABB::Union(child1.box, child2.box);
+        current.height = 1 + std::max(child1.height, child2.height);
+
+        node = current.parent;
+    }
+}
+
+void BVH::Rebuild()
+{
+    if (root == NULL_NODE) return;
+
+    // Keep the leaves (their index is the proxy id) and free all the internal nodes
+    std::vector<int> leaves;
+    leaves.reserve(proxyCount);
+    for (int i = 0; i < (int)nodes.size(); ++i)
+    {
+        if (nodes[i].height < 0) continue;
+
+        if (nodes[i].IsLeaf())
+        {
+            nodes[i].parent = NULL_NODE;
+            leaves.push_back(i);
+        }
+        else
+        {
+            FreeNode(i);
+        }
+    }
+
+    std::vector<glm::vec3> centroids(nodes.size());
+    for (int leaf : leaves)
+    {
+        centroids[leaf] = nodes[leaf].box.GetCenter();
+    }
+
+    root = BuildRecursive(leaves, centroids, 0, (int)leaves.size());
+    nodes[root].parent = NULL_NODE;
+}
+
+int BVH::BuildRecursive(std::vector<int>& leaves, std::vector<glm::vec3>& centroids, int begin, int end)
+{
+    int count = end - begin;
+    if (count == 1) return leaves[begin];
+
+    // Box of the node and box of the centroids, the split axis is the longest one of the centroids
+    AABB bounds;
+    AABB centroidBounds;
+    for (int i = begin; i < end; ++i)
+    {
+        bounds.Expand(nodes[leaves[i]].box);
+        centroidBounds.Expand(centroids[leaves[i]]);
+    }
+
+    glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+    int axis = 0;
+    if (extent.y > extent.x) axis = 1;
+    if (extent.z > extent[axis]) axis = 2;
+
+    int mid = begin + count / 2;
+
+    if (extent[axis] > 0.0f)
+    {
+        struct Bin
+        {
+            AABB box;
+            int count = 0;
+        };
+        Bin bins[SAH_BINS];
+
+        float scale = SAH_BINS / extent[axis];
+        auto BinIndex = [&](int leaf)
+            {
+                int b = (int)((centroids[leaf][axis] - centroidBounds.min[axis]) * scale);
+                return std::min(b, SAH_BINS - 1);
+            };
+
+        for (int i = begin; i < end; ++i)
+        {
+            Bin& bin = bins[BinIndex(leaves[i])];
+            bin.box.Expand(nodes[leaves[i]].box);
+            ++bin.count;
+        }
+
+        // Sweep from both sides to get the area and count of each side for every split plane
+        float leftArea[SAH_BINS - 1];
+        int leftCount[SAH_BINS - 1];
+        AABB accumulated;
+        int accumulatedCount = 0;
+        for (int b = 0; b < SAH_BINS - 1; ++b)
+        {
+            accumulated.Expand(bins[b].box);
+            accumulatedCount += bins[b].count;
+            leftArea[b] = accumulated.GetSurfaceArea();
+            leftCount[b] = accumulatedCount;
+        }
+
+        float bestCost = FLT_MAX;
+        int bestSplit = -1;
+        accumulated.Reset();
+        accumulatedCount = 0;
+        for (int b = SAH_BINS - 1; b > 0; --b)
+        {
+            accumulated.Expand(bins[b].box);
+            accumulatedCount += bins[b].count;
+
+            if (leftCount[b - 1] == 0 || accumulatedCount == 0) continue;
+
+            float cost = leftArea[b - 1] * leftCount[b - 1] + accumulated.GetSurfaceArea() * accumulatedCount;
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestSplit = b;
+            }
+        }
+
+        if (bestSplit != -1)
+        {
+            auto middle = std::partition(leaves.begin() + begin, leaves.begin() + end,
+                [&](int leaf) { return BinIndex(leaf) < bestSplit; });
+            mid = (int)(middle - leaves.begin());
+        }
+    }
+
+    // All the centroids on the same bin (or the same point), a median split keeps the tree balanced
+    if (mid == begin || mid == end)
+    {
+        mid = begin + count / 2;
+        std::nth_element(leaves.begin() + begin, leaves.begin() + mid, leaves.begin() + end,
+            [&](int a, int b) { return centroids[a][axis] < centroids[b][axis]; });
+    }
+
+    int child1 = BuildRecursive(leaves, centroids, begin, mid);
+    int child2 = BuildRecursive(leaves, centroids, mid, end);
+
+    int node = AllocateNode();
+    nodes[node].box = bounds;
+    nodes[node].child1 = child1;
+    nodes[node].child2 = child2;
+    nodes[node].height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+    nodes[child1].parent = node;
+    nodes[child2].parent = node;
+
+    return node;
+}
+
+void BVH::QueryFrustum(const Frustum& frustum, std::vector<GameObject*>& results) const
+{
+    if (root == NULL_NODE) return;
+
+    // Each entry carries if the parent was completely inside, then the subtree doesn't need more tests
+    std::vector<std::pair<int, bool>> stack;
+    stack.reserve(64);
+    stack.emplace_back(root, false);
+
+    while (!stack.empty())
+    {
+        int index = stack.back().first;
+        bool inside = stack.back().second;
+        stack.pop_back();
+
+        const Node& node = nodes[index];
+
+        if (!inside)
+        {
+            FrustumTest test = frustum.Test(node.box);
+            if (test == FrustumTest::OUTSIDE) continue;
+            inside = (test == FrustumTest::INSIDE);
+        }
+
+        if (node.IsLeaf())
+        {
+            results.push_back(node.userData);
+        }
+        else
+        {
+            stack.emplace_back(node.child1, inside);
+            stack.emplace_back(node.child2, inside);
+        }
+    }
+}
+
+float BVH::QueryRay(const Ray& ray, float maxDistance, const std::function<float(GameObject* userData, float maxDistance)>& callback) const
+{
+    if (root == NULL_NODE) return maxDistance;
+
+    float tEntry;
+    if (!ray.Intersects(nodes[root].box, maxDistance, tEntry)) return maxDistance;
+
+    // Stack of nodes with the distance where the ray enters them, the nearest child is visited first
+    std::vector<std::pair<int, float>> stack;
+    stack.reserve(64);
+    stack.emplace_back(root, tEntry);
+
+    while (!stack.empty())
+    {
+        int index = stack.back().first;
+        float entry = stack.back().second;
+        stack.pop_back();
+
+        // A closer hit was found after this node was pushed
+        if (entry > maxDistance) continue;
+
+        const Node& node = nodes[index];
+        if (node.IsLeaf())
+        {
+            float distance = callback(node.userData, maxDistance);
+            if (distance < maxDistance) maxDistance = distance;
+            continue;
+        }
+
+        float entry1, entry2;
+        bool hit1 = ray.Intersects(nodes[node.child1].box, maxDistance, entry1);
+        bool hit2 = ray.Intersects(nodes[node.child2].box, maxDistance, entry2);
+
+        if (hit1 && hit2)
+        {
+            // Pushed far first so the near one is popped first
+            if (entry1 < entry2)
+            {
+                stack.emplace_back(node.child2, entry2);
+                stack.emplace_back(node.child1, entry1);
+            }
+            else
+            {
+                stack.emplace_back(node.child1, entry1);
+                stack.emplace_back(node.child2, entry2);
+            }
+        }
+        else if (hit1)
+        {
+            stack.emplace_back(node.child1, entry1);
+        }
+        else if (hit2)
+        {
+            stack.emplace_back(node.child2, entry2);
+        }
+    }
+
+    return maxDistance;
+}
+
+float BVH::ComputeCost() const
+{
+    if (root == NULL_NODE) return 0.0f;
+
+    float rootArea = nodes[root].box.GetSurfaceArea();
+    if (rootArea <= 0.0f) return 0.0f;
+
+    float totalArea = 0.0f;
+    for (const Node& node : nodes)
+    {
+        if (node.height > 0) totalArea += node.box.GetSurfaceArea();
+    }
+
+    return totalArea / rootArea;
+}
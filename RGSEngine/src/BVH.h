@@ -0,0 +1,85 @@
+#pragma once
+
+#include "BoundingVolumes.h"
+
+#include <vector>
+#include <functional>
+
+class GameObject;
+
+// Dynamic Bounding Volume Hierarchy over world space boxes
+// The leaves are inserted with the Surface Area Heuristic, moved with a refit of their ancestors
+// and when the refits degrade the tree it can be rebuilt from scratch with a binned SAH split
+class BVH
+{
+public:
+
+    BVH();
+    ~BVH();
+
+    // Returns the proxy id, it's the index of the leaf node and it doesn't change on Rebuild
+    int CreateProxy(const AABB& box, GameObject* userData);
+    void DestroyProxy(int proxy);
+
+    // Updates the box of the leaf and refits its ancestors, returns false if the box didn't change
+    bool MoveProxy(int proxy, const AABB& box);
+
+    // Top down build of the whole tree with binned SAH, the proxies keep their ids
+    void Rebuild();
+
+    void Clear();
+
+    // All the objects whose box touches the frustum
+    void QueryFrustum(const Frustum& frustum, std::vector<GameObject*>& results) const;
+
+    // Visits the leaves hit by the ray from nearest to farthest box. The callback returns the exact distance of the hit
+    // with that object (or maxDistance if it's missed) and the traversal ignores the boxes behind the closest hit
+    // Returns the closest distance found
+    float QueryRay(const Ray& ray, float maxDistance, const std::function<float(GameObject* userData, float maxDistance)>& callback) const;
+
+    const AABB& GetProxyBox(int proxy) const { return nodes[proxy].box; }
+    GameObject* GetProxyData(int proxy) const { return nodes[proxy].userData; }
+
+    // --- Stats ---
+    int GetProxyCount() const { return proxyCount; }
+    int GetHeight() const { return (root != NULL_NODE) ? nodes[root].height : 0; }
+
+    // SAH cost of the tree: sum of the areas of the internal nodes relative to the root, lower is better
+    float ComputeCost() const;
+
+    static const int NULL_NODE = -1;
+
+private:
+
+    struct Node
+    {
+        AABB box;
+        GameObject* userData = nullptr;
+
+        int parent = NULL_NODE;
+        int child1 = NULL_NODE;
+        int child2 = NULL_NODE;
+        int next = NULL_NODE; // Next free node when it's on the free list
+
+        int height = -1; // 0 for the leaves, -1 for the free nodes
+
+        bool IsLeaf() const { return child1 == NULL_NODE; }
+    };
+
+    int AllocateNode();
+    void FreeNode(int node);
+
+    void InsertLeaf(int leaf);
+    void RemoveLeaf(int leaf);
+
+    // Recalculates the boxes and heights from the node to the root
+    void RefitAncestors(int node);
+
+    // Builds the subtree of leaves[begin, end) and returns its root
+    int BuildRecursive(std::vector<int>& leaves, std::vector<glm::vec3>& centroids, int begin, int end);
+
+    std::vector<Node> nodes;
+    int root = NULL_NODE;
+    int freeList = NULL_NODE;
+    int proxyCount = 0;
+};
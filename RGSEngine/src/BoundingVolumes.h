@@ -0,0 +1,224 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cfloat>
+#include <cmath>
+
+// Axis Aligned Bounding Box, starts empty (min > max) so any point expands it
+struct AABB
+{
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    bool IsValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+
+    glm::vec3 GetCenter() const { return (min + max) * 0.5f; }
+    glm::vec3 GetExtents() const { return (max - min) * 0.5f; }
+
+    void Reset()
+    {
+        min = glm::vec3(FLT_MAX);
+        max = glm::vec3(-FLT_MAX);
+    }
+
+    void Expand(const glm::vec3& point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void Expand(const AABB& other)
+    {
+        if (!other.IsValid()) return;
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    bool Contains(const AABB& other) const
+    {
+        return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+            max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+    }
+
+    // Used as the cost of a node by the Surface Area Heuristic
+    float GetSurfaceArea() const
+    {
+        if (!IsValid()) return 0.0f;
+        glm::vec3 size = max - min;
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    static AABB Union(const AABB& a, const AABB& b)
+    {
+        AABB result = a;
+        result.Expand(b);
+        return result;
+    }
+
+    // Box that contains this box after the transformation, using the absolute value of the matrix for the extents
+    AABB Transformed(const glm::mat4& matrix) const
+    {
+        if (!IsValid()) return *this;
+
+        glm::vec3 center = glm::vec3(matrix * glm::vec4(GetCenter(), 1.0f));
+        glm::vec3 extents = GetExtents();
+
+        glm::vec3 newExtents(
+            std::abs(matrix[0][0]) * extents.x + std::abs(matrix[1][0]) * extents.y + std::abs(matrix[2][0]) * extents.z,
+            std::abs(matrix[0][1]) * extents.x + std::abs(matrix[1][1]) * extents.y + std::abs(matrix[2][1]) * extents.z,
+            std::abs(matrix[0][2]) * extents.x + std::abs(matrix[1][2]) * extents.y + std::abs(matrix[2][2]) * extents.z);
+
+        AABB result;
+        result.min = center - newExtents;
+        result.max = center + newExtents;
+        return result;
+    }
+};
+
+struct BoundingSphere
+{
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    // Sphere around the box, it's not the minimal one but it's enough for a fast rejection
+    static BoundingSphere FromAABB(const AABB& box)
+    {
+        BoundingSphere sphere;
+        if (!box.IsValid()) return sphere;
+
+        sphere.center = box.GetCenter();
+        sphere.radius = glm::length(box.GetExtents());
+        return sphere;
+    }
+
+    // The radius grows with the biggest scale of the matrix so non uniform scales stay inside
+    BoundingSphere Transformed(const glm::mat4& matrix) const
+    {
+        BoundingSphere result;
+        result.center = glm::vec3(matrix * glm::vec4(center, 1.0f));
+
+        float maxScale = glm::max(glm::max(glm::length(glm::vec3(matrix[0])), glm::length(glm::vec3(matrix[1]))), glm::length(glm::vec3(matrix[2])));
+        result.radius = radius * maxScale;
+        return result;
+    }
+};
+
+struct Ray
+{
+    glm::vec3 origin = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);
+    glm::vec3 invDirection = glm::vec3(0.0f, 0.0f, -1.0f); // Precalculated for the slab test
+
+    Ray() {}
+    Ray(const glm::vec3& origin, const glm::vec3& direction)
+        : origin(origin), direction(direction),
+        invDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z)
+    {
+    }
+
+    glm::vec3 GetPoint(float distance) const { return origin + direction * distance; }
+
+    // Slab test, tEntry is the distance where the ray enters the box (0 if it starts inside)
+    bool Intersects(const AABB& box, float maxDistance, float& tEntry) const
+    {
+        glm::vec3 t0 = (box.min - origin) * invDirection;
+        glm::vec3 t1 = (box.max - origin) * invDirection;
+        glm::vec3 tSmall = glm::min(t0, t1);
+        glm::vec3 tBig = glm::max(t0, t1);
+
+        float tMin = glm::max(glm::max(tSmall.x, tSmall.y), glm::max(tSmall.z, 0.0f));
+        float tMax = glm::min(glm::min(tBig.x, tBig.y), glm::min(tBig.z, maxDistance));
+
+        tEntry = tMin;
+        return tMin <= tMax;
+    }
+};
+
+enum class FrustumTest
+{
+    OUTSIDE,
+    INTERSECTS,
+    INSIDE
+};
+
+// The 6 planes of a camera, with the normals pointing inside
+struct Frustum
+{
+    // Plane ax + by + cz + d = 0 stored as (a, b, c, d)
+    glm::vec4 planes[6];
+
+    // Gribb-Hartmann extraction from the rows of projection * view, the planes end in world space
+    void ExtractFromMatrix(const glm::mat4& viewProjection)
+    {
+        const glm::mat4& m = viewProjection;
+
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        planes[0] = row3 + row0; // Left
+        planes[1] = row3 - row0; // Right
+        planes[2] = row3 + row1; // Bottom
+        planes[3] = row3 - row1; // Top
+        planes[4] = row3 + row2; // Near
+        planes[5] = row3 - row2; // Far
+
+        // Normalized so the distances are in world units
+        for (int i = 0; i < 6; ++i)
+        {
+            float length = glm::length(glm::vec3(planes[i]));
+            if (length > 0.0f) planes[i] /= length;
+        }
+    }
+
+    bool Intersects(const BoundingSphere& sphere) const
+    {
+        for (int i = 0; i < 6; ++i)
+        {
+            if (glm::dot(glm::vec3(planes[i]), sphere.center) + planes[i].w < -sphere.radius)
+                return false;
+        }
+        return true;
+    }
+
+    // Conservative test, only the corner more inside of each plane is checked
+    bool Intersects(const AABB& box) const
+    {
+        for (int i = 0; i < 6; ++i)
+        {
+            glm::vec3 positive(
+                planes[i].x >= 0.0f ? box.max.x : box.min.x,
+                planes[i].y >= 0.0f ? box.max.y : box.min.y,
+                planes[i].z >= 0.0f ? box.max.z : box.min.z);
+
+            if (glm::dot(glm::vec3(planes[i]), positive) + planes[i].w < 0.0f)
+                return false;
+        }
+        return true;
+    }
+
+    // Like Intersects but also tells if the box is completely inside, so a hierarchy can stop testing its childrens
+    FrustumTest Test(const AABB& box) const
+    {
+        FrustumTest result = FrustumTest::INSIDE;
+        for (int i = 0; i < 6; ++i)
+        {
+            glm::vec3 normal(planes[i]);
+            glm::vec3 positive(
+                normal.x >= 0.0f ? box.max.x : box.min.x,
+                normal.y >= 0.0f ? box.max.y : box.min.y,
+                normal.z >= 0.0f ? box.max.z : box.min.z);
+            glm::vec3 negative(
+                normal.x >= 0.0f ? box.min.x : box.max.x,
+                normal.y >= 0.0f ? box.min.y : box.max.y,
+                normal.z >= 0.0f ? box.min.z : box.max.z);
+
+            if (glm::dot(normal, positive) + planes[i].w < 0.0f)
+                return FrustumTest::OUTSIDE;
+            if (glm::dot(normal, negative) + planes[i].w < 0.0f)
+                result = FrustumTest::INTERSECTS;
+        }
+        return result;
+    }
+};
@@ -6,7 +6,9 @@ enum class ComponentType
     TRANSFORM,
     MESH,
     TEXTURE,
-    CAMERA
+    CAMERA,
+
+    COUNT   // Number of types, used to size the component slots of the GameObject
 };
 
 // Forward Declaration to avoid the GameObject and the Component is icluded mutuially and creates a loop
@@ -15,6 +15,9 @@
 class ComponentCamera : public Component
 {
 public:
+    // Type used by GameObject::GetComponent<T>() to find the slot without RTTI
+    static constexpr ComponentType staticType = ComponentType::CAMERA;
+
     ComponentCamera(GameObject* owner)
         : Component(owner, ComponentType::CAMERA),
         frustumVAO(0), frustumVBO(0)
@@ -45,9 +48,9 @@ public:
         }
 
         // The front vector and up vector are obtained applying the rotation, Quaternion, to the vectors of the world 
-        glm::vec3 pos = transform->position;
-        glm::vec3 front = transform->rotation * glm::vec3(0.0f, 0.0f, -1.0f); // Local Front Vector
-        glm::vec3 up = transform->rotation * glm::vec3(0.0f, 1.0f, 0.0f);    // Local Up Vector
+        glm::vec3 pos = transform->GetPosition();
+        glm::vec3 front = transform->GetRotation() * glm::vec3(0.0f, 0.0f, -1.0f); // Local Front Vector
+        glm::vec3 up = transform->GetRotation() * glm::vec3(0.0f, 1.0f, 0.0f);    // Local Up Vector
 
         // lookAt(position, where to look, up vector)
         return glm::lookAt(pos, pos + front, up);
@@ -84,9 +87,9 @@ public:
         float widthFar = heightFar * aspectRatio;
 
         // Orient Vector of the transform
-        glm::vec3 pos = transform->position;
-        glm::vec3 front = transform->rotation * glm::vec3(0.0f, 0.0f, -1.0f);
-        glm::vec3 up = transform->rotation * glm::vec3(0.0f, 1.0f, 0.0f);
+        glm::vec3 pos = transform->GetPosition();
+        glm::vec3 front = transform->GetRotation() * glm::vec3(0.0f, 0.0f, -1.0f);
+        glm::vec3 up = transform->GetRotation() * glm::vec3(0.0f, 1.0f, 0.0f);
         glm::vec3 right = glm::cross(front, up);
 
         // Plane centers
@@ -3,10 +3,15 @@
 #include "Component.h"
 #include <glad/glad.h>
 #include <string>
+#include <memory>
+#include "ResourceTexture.h"
 
 class ComponentTexture : public Component
 {
 public:
+    // Type used by GameObject::GetComponent<T>() to find the slot without RTTI
+    static constexpr ComponentType staticType = ComponentType::TEXTURE;
+
     ComponentTexture(GameObject* owner)
         : Component(owner, ComponentType::TEXTURE),
         textureID(0), width(0), height(0),
@@ -34,17 +39,34 @@ public:
         glBindTexture(GL_TEXTURE_2D, 0);
     }
 
+    // The GL texture is owned by the resource, other components may still be using it
+    void SetResource(std::shared_ptr<ResourceTexture> newResource)
+    {
+        resource = newResource;
+        textureID = (resource != nullptr) ? resource->textureID : 0;
+        width = (resource != nullptr) ? resource->width : 0;
+        height = (resource != nullptr) ? resource->height : 0;
+    }
+
+    // Texture to draw, the placeholder if there is none or the resource is still streaming
+    unsigned int GetDrawTextureID(unsigned int placeholder) const
+    {
+        if (textureID == 0) return placeholder;
+        if (resource != nullptr && textureID == resource->textureID && !resource->IsReady()) return placeholder;
+        return textureID;
+    }
+
     void CleanUp()
     {
-        if (textureID != 0)
-        {
-            glDeleteTextures(1, &textureID);
-            textureID = 0;
-        }
+        resource.reset();
+        textureID = 0;
     }
 
 public:
-    unsigned int textureID;
+    // Shared texture, it's only deleted when the last component releases it
+    std::shared_ptr<ResourceTexture> resource;
+
+    unsigned int textureID; // The one drawn, can be the default checker instead of the resource
     int width;
     int height;
     std::string path; // Keep the path for the Inspector
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Component.h"
+#include "GameObject.h"
+#include "TransformSystem.h"
 
 #define GLM_ENABLE_EXPERIMENTAL
 
@@ -10,57 +12,68 @@
 #include <glm/gtx/matrix_decompose.hpp>
 
 
+// The data of the transform lives on the TransformSystem, the component only keeps its handle
 class ComponentTransform : public Component
 {
 public:
+    // Type used by GameObject::GetComponent<T>() to find the slot without RTTI
+    static constexpr ComponentType staticType = ComponentType::TRANSFORM;
+
     // Constructor
     ComponentTransform(GameObject* owner)
         : Component(owner, ComponentType::TRANSFORM),
-        position(0.0f, 0.0f, 0.0f),
-        rotation(1.0f, 0.0f, 0.0f, 0.0f), // Identity quaternion without rotation
-        scale(1.0f, 1.0f, 1.0f)
+        handle(TransformSystem::GetInstance().Create()) // Starts at the origin, identity rotation and scale 1
     {
     }
 
-    ~ComponentTransform() {}
+    ~ComponentTransform()
+    {
+        TransformSystem::GetInstance().Destroy(handle);
+    }
+
+    // The handle is unique, copying the component would destroy the transform twice
+    ComponentTransform(const ComponentTransform&) = delete;
+    ComponentTransform& operator=(const ComponentTransform&) = delete;
 
     // --- Main methods ---
 
-    // Calculates and retourns the Model Matrix
+    // Returns the Model Matrix (T * R * S), only recalculated when the position, rotation or scale changed
     glm::mat4 GetModelMatrix() const
     {
-        // Creation of the traslation matrix
-        glm::mat4 trans = glm::translate(glm::mat4(1.0f), position);
+        return TransformSystem::GetInstance().GetLocalMatrix(handle);
+    }
+
+    // Returns the World Matrix (parent world * local), updated for all the scene once per frame by the TransformSystem
+    glm::mat4 GetWorldMatrix() const
+    {
+        return TransformSystem::GetInstance().GetWorldMatrix(handle);
+    }
 
-        // Creation of the rotation matrix form the quaternion given
-        glm::mat4 rot = glm::mat4_cast(rotation);
+    TransformHandle GetHandle() const { return handle; }
 
-        // Creation of the matrix of the scaling
-        glm::mat4 sca = glm::scale(glm::mat4(1.0f), scale);
+    // --- Getters ---
 
-        // The final matrix is T * R * S
-        return trans * rot * sca;
-    }
+    const glm::vec3& GetPosition() const { return TransformSystem::GetInstance().GetPosition(handle); }
+    const glm::quat& GetRotation() const { return TransformSystem::GetInstance().GetRotation(handle); } // Used the quaternion to avoid the "Gimbal Lock"
+    const glm::vec3& GetScale() const { return TransformSystem::GetInstance().GetScale(handle); }
 
     // --- Setters (so we can modify them later form the inspector) ---
 
     void SetPosition(const glm::vec3& newPos)
     {
-        position = newPos;
+        TransformSystem::GetInstance().SetPosition(handle, newPos);
     }
 
     void SetRotation(const glm::quat& newRot)
     {
-        rotation = newRot;
+        TransformSystem::GetInstance().SetRotation(handle, newRot);
     }
 
     void SetScale(const glm::vec3& newScale)
     {
-        scale = newScale;
+        TransformSystem::GetInstance().SetScale(handle, newScale);
     }
 
-public:
-    glm::vec3 position;
-    glm::quat rotation; // Used the quaternion to avoid the "Gimbal Lock"
-    glm::vec3 scale;
-};
\ No newline at end of file
+private:
+    TransformHandle handle;
+};
@@ -0,0 +1,91 @@
+#include "DepthPyramid.h"
+
+#include <algorithm>
+#include <cmath>
+
+int DepthPyramid::GetLevelCount(int width, int height)
+{
+    int levels = 1;
+    for (int size = std::max(width, height); size > 1; size >>= 1) ++levels;
+    return levels;
+}
+
+glm::ivec2 DepthPyramid::GetLevelSize(int width, int height, int level)
+{
+    return glm::ivec2(std::max(width >> level, 1), std::max(height >> level, 1));
+}
+
+float DepthPyramid::GetDepth(int level, glm::ivec2 texel) const
+{
+    return levels[level][(size_t)texel.y * GetLevelSize(level).x + texel.x];
+}
+
+void DepthPyramid::Reduce()
+{
+    levels.resize(GetLevelCount(width, height));
+    for (int level = 1; level < (int)levels.size(); ++level)
+    {
+        glm::ivec2 sourceSize = GetLevelSize(level - 1);
+        glm::ivec2 size = GetLevelSize(level);
+        levels[level].assign((size_t)size.x * size.y, 0.0f);
+
+        for (int y = 0; y < size.y; ++y)
+        {
+            for (int x = 0; x < size.x; ++x)
+            {
+                glm::ivec2 texel(x, y);
+                glm::ivec2 first = texel * sourceSize / size;
+                glm::ivec2 last = ((texel + 1) * sourceSize + size - 1) / size - 1;
+
+                float depth = 0.0f;
+                for (int sy = first.y; sy <= last.y; ++sy)
+                {
+                    for (int sx = first.x; sx <= last.x; ++sx) depth = std::max(depth, GetDepth(level - 1, glm::ivec2(sx, sy)));
+                }
+                levels[level][(size_t)y * size.x + x] = depth;
+            }
+        }
+    }
+}
+
+bool DepthPyramid::IsOccluded(const AABB& box) const
+{
+    if (levels.empty()) return false;
+
+    glm::vec2 minUV(1.0f);
+    glm::vec2 maxUV(0.0f);
+    float minDepth = 1.0f;
+    for (int i = 0; i < 8; ++i)
+    {
+        glm::vec3 corner((i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y, (i & 4) ? box.max.z : box.min.z);
+        glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+        if (clip.w <= 0.0f) return false;
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        minUV = glm::min(minUV, glm::vec2(ndc) * 0.5f + 0.5f);
+        maxUV = glm::max(maxUV, glm::vec2(ndc) * 0.5f + 0.5f);
+        minDepth = std::min(minDepth, ndc.z * 0.5f + 0.5f);
+    }
+
+    if (minUV.x < 0.0f || minUV.y < 0.0f || maxUV.x > 1.0f || maxUV.y > 1.0f) return false;
+
+    const int levelCount = (int)levels.size();
+    glm::vec2 size = (maxUV - minUV) * glm::vec2((float)width, (float)height);
+    int level = glm::clamp((int)std::ceil(std::log2(std::max(std::max(size.x, size.y), 1.0f))), 0, levelCount - 1);
+
+    glm::ivec2 minTexel;
+    glm::ivec2 maxTexel;
+    while (true)
+    {
+        glm::ivec2 levelSize = GetLevelSize(level);
+        minTexel = glm::clamp(glm::ivec2(glm::floor(minUV * glm::vec2(levelSize))), glm::ivec2(0), levelSize - 1);
+        maxTexel = glm::clamp(glm::ivec2(glm::floor(maxUV * glm::vec2(levelSize))), glm::ivec2(0), levelSize - 1);
+        if (level == levelCount - 1 || (maxTexel.x - minTexel.x <= 1 && maxTexel.y - minTexel.y <= 1)) break;
+        ++level;
+    }
+
+    float occluderDepth = std::max(
+        std::max(GetDepth(level, minTexel), GetDepth(level, glm::ivec2(maxTexel.x, minTexel.y))),
+        std::max(GetDepth(level, glm::ivec2(minTexel.x, maxTexel.y)), GetDepth(level, maxTexel)));
+    return minDepth > occluderDepth;
+}
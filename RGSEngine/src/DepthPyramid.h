@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "BoundingVolumes.h"
+
+// Depth of a frame reduced with max, each texel of a level covers the texels of the previous one below it
+// Filled from the GPU pyramid or from the software rasterizer, the rows start at the bottom of the screen as in GL
+struct DepthPyramid
+{
+    int width = 0;
+    int height = 0;
+    glm::mat4 viewProjection = glm::mat4(1.0f); // Of the frame the depth comes from
+    std::vector<std::vector<float>> levels;
+
+    static int GetLevelCount(int width, int height);
+    static glm::ivec2 GetLevelSize(int width, int height, int level);
+
+    glm::ivec2 GetLevelSize(int level) const { return GetLevelSize(width, height, level); }
+    float GetDepth(int level, glm::ivec2 texel) const;
+
+    // Fills the levels after the first one, the same reduction the shader does
+    void Reduce();
+
+    // True when the nearest point of the box is behind the depth of every texel under its rectangle on the screen
+    // The test of the culling shader, the boxes that cross the camera plane or the borders of the screen are kept
+    bool IsOccluded(const AABB& box) const;
+};
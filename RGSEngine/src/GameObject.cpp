@@ -37,6 +37,23 @@ void GameObject::Update()
 void GameObject::AddComponent(shared_ptr<Component> component)
 {
     components.push_back(component);
+
+    // Register it on the slot of its type, the first component of a type is the one returned by GetComponent
+    size_t slot = static_cast<size_t>(component->GetType());
+    if (slot < static_cast<size_t>(ComponentType::COUNT) && componentSlots[slot] == nullptr)
+    {
+        componentSlots[slot] = component.get();
+    }
+
+    // A new transform is the new parent of the transforms of all the childrens
+    if (component->GetType() == ComponentType::TRANSFORM)
+    {
+        SyncTransformParent();
+        for (auto& child : children)
+        {
+            child->SyncTransformParent();
+        }
+    }
 }
 
 void GameObject::AddChild(shared_ptr<GameObject> child)
@@ -45,6 +62,9 @@ void GameObject::AddChild(shared_ptr<GameObject> child)
     {
         child->parent = this;
         children.push_back(child);
+
+        // The new parent changes the world matrix of the child
+        child->SyncTransformParent();
     }
 }
 
@@ -60,22 +80,47 @@ void GameObject::RemoveChild(GameObject* child)
     );
 
     child->parent = nullptr; // Break the link with the parent
+    child->SyncTransformParent();
 }
 
 glm::mat4 GameObject::GetGlobalMatrix()
 {
     ComponentTransform* transform = GetComponent<ComponentTransform>();
-    glm::mat4 localMatrix = (transform != nullptr) ? transform->GetModelMatrix() : glm::mat4(1.0f);
+    if (transform != nullptr)
+    {
+        // The TransformSystem already includes the parent global * local
+        return transform->GetWorldMatrix();
+    }
 
-    if (parent != nullptr)
+    // Without transform the local matrix is the identity, so the global is the one of the parent
+    return (parent != nullptr) ? parent->GetGlobalMatrix() : glm::mat4(1.0f);
+}
+
+void GameObject::SyncTransformParent()
+{
+    ComponentTransform* transform = GetComponent<ComponentTransform>();
+    if (transform != nullptr)
     {
-        // Multiply the global matrix of the parent for the local matrix of the object
-        return parent->GetGlobalMatrix() * localMatrix;
+        // The parent transform is the one of the nearest ancestor that has it, objects without transform are skipped
+        TransformHandle parentHandle = INVALID_TRANSFORM;
+        for (GameObject* ancestor = parent; ancestor != nullptr; ancestor = ancestor->parent)
+        {
+            ComponentTransform* parentTransform = ancestor->GetComponent<ComponentTransform>();
+            if (parentTransform != nullptr)
+            {
+                parentHandle = parentTransform->GetHandle();
+                break;
+            }
+        }
+
+        // The childrens still point to this transform, they don't need to change
+        TransformSystem::GetInstance().SetParent(transform->GetHandle(), parentHandle);
+        return;
     }
-    else
+
+    for (auto& child : children)
     {
-        // If theres no parent, its SceneRoot, the local matrix is the global matrix
-        return localMatrix;
+        child->SyncTransformParent();
     }
 }
 
@@ -154,6 +199,7 @@ void GameObject::SetParent(GameObject* newParent)
         {
             newParent->children.push_back(myPtr);
             parent = newParent;
+            SyncTransformParent();
         }
         else
         {
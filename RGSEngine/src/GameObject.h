@@ -33,19 +33,11 @@ public:
     // This GetComponent is used to ask the component his type class
         // GetComponent<ComponentTransform>()
         // Templates must remain in the header file
+    // Each component class declares its staticType, so the lookup is a single load of the slot, no dynamic_cast
     template<typename T>
     T* GetComponent() const
     {
-        for (auto& component : components)
-        {
-            // Converting pointer to type T
-            T* castedComponent = dynamic_cast<T*>(component.get());
-            if (castedComponent != nullptr)
-            {
-                return castedComponent;
-            }
-        }
-        return nullptr;
+        return static_cast<T*>(componentSlots[static_cast<size_t>(T::staticType)]);
     }
 
     // --- Child Management ---
@@ -58,9 +50,13 @@ public:
     // Checks if this object is an ancestor of potentialChild to avoid cycles
     bool IsAncestorOf(GameObject* potentialChild);
 
-    // Calculate the matrix of the transform world
+    // Obtain the matrix of the transform world, calculated by the TransformSystem
     glm::mat4 GetGlobalMatrix();
 
+    // Tells the TransformSystem the new parent of the transforms of this object (or its descendants if it has no transform)
+    // Must be called every time the hierarchy changes
+    void SyncTransformParent();
+
     // ImGuizmo provides the new global matrix, needs to be calculated the local matrix of the object and separate the position, rotation and scale
     void SetLocalFromGlobal(const glm::mat4& newGlobalMatrix);
 
@@ -78,4 +74,8 @@ public:
 
     vector<shared_ptr<Component>> components;
     vector<shared_ptr<GameObject>> children;
+
+private:
+    // First component of each ComponentType, indexed by the type. Owned by the components vector
+    Component* componentSlots[static_cast<size_t>(ComponentType::COUNT)] = {};
 };
\ No newline at end of file
@@ -0,0 +1,224 @@
+#include "GeometryPool.h"
+#include "VertexFormat.h"
+#include "Log.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+
+// Enough for a few medium meshes before the first growth
+static const uint32_t INITIAL_VERTEX_CAPACITY = 1 << 16;
+static const uint32_t INITIAL_INDEX_CAPACITY = 1 << 18;
+
+static const unsigned int VERTEX_BINDING = 0;
+
+uint32_t GeometryPool::GetLayoutKey(uint32_t flags)
+{
+    return flags & (VERTEX_QUANTIZED_POSITIONS | VERTEX_INDEX_16);
+}
+
+GeometryPool::GeometryPool(uint32_t layoutFlags)
+{
+    PackedMeshLayout layout;
+    layout.flags = GetLayoutKey(layoutFlags);
+    stride = layout.GetStride();
+    indexSize = layout.GetIndexSize();
+    indexType = layout.HasFlag(VERTEX_INDEX_16) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+    vertices.Grow(INITIAL_VERTEX_CAPACITY);
+    indices.Grow(INITIAL_INDEX_CAPACITY);
+
+    glGenBuffers(1, &vertexBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, (size_t)vertices.capacity * stride, nullptr, GL_STATIC_DRAW);
+
+    glGenBuffers(1, &indexBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, (size_t)indices.capacity * indexSize, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    // Same attributes as the VAO of each mesh had, all of them read from the one vertex buffer
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+
+    // Attribute 0: positions, [0, 1] inside the bounds when quantized, the dequantize matrix of the mesh brings them back
+    if (layout.HasFlag(VERTEX_QUANTIZED_POSITIONS))
+        glVertexAttribFormat(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, 0);
+    else
+        glVertexAttribFormat(0, 3, GL_FLOAT, GL_FALSE, 0);
+
+    // Attribute 1: UV coordinates as half floats, attribute 2: octahedral normals
+    // The meshes without them have zeros there
+    glVertexAttribFormat(1, 2, GL_HALF_FLOAT, GL_FALSE, layout.GetUVOffset());
+    glVertexAttribFormat(2, 2, GL_SHORT, GL_TRUE, layout.GetNormalOffset());
+
+    for (unsigned int attribute = 0; attribute < 3; ++attribute)
+    {
+        glVertexAttribBinding(attribute, VERTEX_BINDING);
+        glEnableVertexAttribArray(attribute);
+    }
+
+    glBindVertexBuffer(VERTEX_BINDING, vertexBuffer, 0, stride);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBindVertexArray(0);
+
+    LOG("Geometry pool created: %d bytes per vertex, %d bit indices", stride, indexSize * 8);
+}
+
+GeometryPool::~GeometryPool()
+{
+    if (VAO != 0) glDeleteVertexArrays(1, &VAO);
+    if (vertexBuffer != 0) glDeleteBuffers(1, &vertexBuffer);
+    if (indexBuffer != 0) glDeleteBuffers(1, &indexBuffer);
+}
+
+bool GeometryPool::RangeAllocator::Allocate(uint32_t size, uint32_t& offset)
+{
+    for (size_t i = 0; i < freeRanges.size(); ++i)
+    {
+        auto& range = freeRanges[i];
+        if (range.second < size) continue;
+
+        offset = range.first;
+        range.first += size;
+        range.second -= size;
+        if (range.second == 0) freeRanges.erase(freeRanges.begin() + i);
+
+        used += size;
+        return true;
+    }
+    return false;
+}
+
+void GeometryPool::RangeAllocator::Free(uint32_t offset, uint32_t size)
+{
+    if (size == 0) return;
+    used -= size;
+
+    auto next = std::lower_bound(freeRanges.begin(), freeRanges.end(), std::make_pair(offset, 0u));
+    next = freeRanges.insert(next, { offset, size });
+
+    // Merge with the next one and then with the previous one
+    if (next + 1 != freeRanges.end() && next->first + next->second == (next + 1)->first)
+    {
+        next->second += (next + 1)->second;
+        freeRanges.erase(next + 1);
+    }
+    if (next != freeRanges.begin() && (next - 1)->first + (next - 1)->second == next->first)
+    {
+        (next - 1)->second += next->second;
+        freeRanges.erase(next);
+    }
+}
+
+void GeometryPool::RangeAllocator::Grow(uint32_t newCapacity)
+{
+    uint32_t added = newCapacity - capacity;
+    if (!freeRanges.empty() && freeRanges.back().first + freeRanges.back().second == capacity)
+    {
+        freeRanges.back().second += added;
+    }
+    else
+    {
+        freeRanges.push_back({ capacity, added });
+    }
+    capacity = newCapacity;
+}
+
+void GeometryPool::GrowBuffer(unsigned int& buffer, size_t oldBytes, size_t newBytes)
+{
+    // The copy stays on the GPU, the COPY targets don't touch the element buffer of the VAO bound right now
+    unsigned int newBuffer = 0;
+    glGenBuffers(1, &newBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &buffer);
+    buffer = newBuffer;
+
+    glBindVertexArray(VAO);
+    glBindVertexBuffer(VERTEX_BINDING, vertexBuffer, 0, stride);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBindVertexArray(0);
+}
+
+bool GeometryPool::Reserve(RangeAllocator& allocator, unsigned int& buffer, uint32_t elementSize, uint32_t count, uint32_t& offset)
+{
+    if (count == 0)
+    {
+        offset = 0;
+        return true;
+    }
+    if (allocator.Allocate(count, offset)) return true;
+
+    uint64_t newCapacity = std::max<uint64_t>((uint64_t)allocator.capacity * 2, (uint64_t)allocator.capacity + count);
+    if (newCapacity > 0xFFFFFFFFu)
+    {
+        LOG("Error: Geometry pool full, %u elements more don't fit", count);
+        return false;
+    }
+
+    GrowBuffer(buffer, (size_t)allocator.capacity * elementSize, (size_t)newCapacity * elementSize);
+    allocator.Grow((uint32_t)newCapacity);
+    LOG("Geometry pool grown to %u elements of %u bytes", (uint32_t)newCapacity, elementSize);
+
+    return allocator.Allocate(count, offset);
+}
+
+bool GeometryPool::Allocate(const PackedMeshView& packed, GeometryAllocation& allocation)
+{
+    allocation = GeometryAllocation();
+    const uint32_t indexCount = packed.indexCount + packed.lodIndexCount;
+
+    if (!Reserve(vertices, vertexBuffer, stride, packed.vertexCount, allocation.baseVertex)) return false;
+    allocation.vertexCount = packed.vertexCount;
+
+    if (!Reserve(indices, indexBuffer, indexSize, indexCount, allocation.firstIndex))
+    {
+        Free(allocation);
+        allocation = GeometryAllocation();
+        return false;
+    }
+    allocation.indexCount = indexCount;
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (size_t)allocation.baseVertex * stride, packed.GetVertexBytes(), packed.vertices);
+
+    // The indices stay relative to the mesh, the base vertex of the draw moves them to its range
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (size_t)allocation.firstIndex * indexSize, packed.GetIndexBytes(), packed.indices);
+    if (packed.lodIndexCount > 0)
+    {
+        glBufferSubData(GL_COPY_WRITE_BUFFER, ((size_t)allocation.firstIndex + packed.indexCount) * indexSize,
+            (size_t)packed.lodIndexCount * indexSize, packed.lodIndices);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return true;
+}
+
+void GeometryPool::Free(const GeometryAllocation& allocation)
+{
+    vertices.Free(allocation.baseVertex, allocation.vertexCount);
+    indices.Free(allocation.firstIndex, allocation.indexCount);
+}
+
+void GeometryPool::SetupInstanceAttributes(unsigned int bindingIndex)
+{
+    if (instanceAttributesReady) return;
+
+    glBindVertexArray(VAO);
+    for (unsigned int column = 0; column < 4; ++column)
+    {
+        glEnableVertexAttribArray(3 + column);
+        glVertexAttribFormat(3 + column, 4, GL_FLOAT, GL_FALSE, column * sizeof(float) * 4);
+        glVertexAttribBinding(3 + column, bindingIndex);
+    }
+    glVertexBindingDivisor(bindingIndex, 1);
+    glBindVertexArray(0);
+
+    instanceAttributesReady = true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+struct PackedMeshView;
+
+// Range of a GeometryPool used by one mesh, in vertices and in indices
+struct GeometryAllocation
+{
+    uint32_t baseVertex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+};
+
+// Vertex and index buffers shared by all the meshes with the same vertex layout, with one VAO for all of them
+// Each mesh is a range drawn with its base vertex and first index, so going from one mesh to another doesn't change any GL state
+// When a buffer is full it's copied on the GPU to a bigger one, the ranges already given keep their offsets
+class GeometryPool
+{
+public:
+
+    // Only the VERTEX_QUANTIZED_POSITIONS and VERTEX_INDEX_16 flags change the layout of the pool
+    GeometryPool(uint32_t layoutFlags);
+    ~GeometryPool();
+
+    // Uploads the vertices, the indices and the LOD indices after them
+    bool Allocate(const PackedMeshView& packed, GeometryAllocation& allocation);
+    void Free(const GeometryAllocation& allocation);
+
+    // Per instance model matrix on the locations 3 to 6, read from the buffer bound on bindingIndex
+    void SetupInstanceAttributes(unsigned int bindingIndex);
+
+    unsigned int GetVAO() const { return VAO; }
+    unsigned int GetIndexType() const { return indexType; }
+    uint32_t GetIndexSize() const { return indexSize; }
+
+    size_t GetUsedBytes() const { return (size_t)vertices.used * stride + (size_t)indices.used * indexSize; }
+    size_t GetCapacityBytes() const { return (size_t)vertices.capacity * stride + (size_t)indices.capacity * indexSize; }
+
+    static uint32_t GetLayoutKey(uint32_t flags);
+
+private:
+
+    // First fit over the free ranges, sorted by offset, a freed range is merged with its neighbours
+    struct RangeAllocator
+    {
+        uint32_t capacity = 0;
+        uint32_t used = 0;
+        std::vector<std::pair<uint32_t, uint32_t>> freeRanges; // Offset and size
+
+        bool Allocate(uint32_t size, uint32_t& offset);
+        void Free(uint32_t offset, uint32_t size);
+        void Grow(uint32_t newCapacity);
+    };
+
+    // Copies the content to a new buffer of newBytes and deletes the old one
+    void GrowBuffer(unsigned int& buffer, size_t oldBytes, size_t newBytes);
+    bool Reserve(RangeAllocator& allocator, unsigned int& buffer, uint32_t elementSize, uint32_t count, uint32_t& offset);
+
+    uint32_t stride = 0;
+    uint32_t indexSize = 0;
+    unsigned int indexType = 0;
+
+    unsigned int VAO = 0;
+    unsigned int vertexBuffer = 0;
+    unsigned int indexBuffer = 0;
+
+    RangeAllocator vertices;
+    RangeAllocator indices;
+
+    bool instanceAttributesReady = false;
+};
@@ -0,0 +1,521 @@
+#include "GpuCulling.h"
+#include "Shader.h"
+#include "Log.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+
+namespace CullingShaders
+{
+    // One invocation per entry: frustum, then the depth pyramid, the visible ones take an instance slot of their command
+    const char* cull = R"(
+    #version 460 core
+    layout (local_size_x = 64) in;
+
+    struct DrawCommand
+    {
+        uint count;
+        uint instanceCount;
+        uint firstIndex;
+        int baseVertex;
+        uint baseInstance;
+    };
+
+    struct CullEntry
+    {
+        vec4 sphere;
+        uint command;
+        uint object;
+        uint padding0;
+        uint padding1;
+    };
+
+    layout (std430, binding = 2) readonly buffer Entries { CullEntry entries[]; };
+    layout (std430, binding = 3) buffer Commands { DrawCommand commands[]; };
+    layout (std430, binding = 4) writeonly buffer Instances { uint instanceObjects[]; };
+    layout (std430, binding = 5) writeonly buffer Results { uint results[]; };
+    layout (std430, binding = 6) buffer Stats { uint stats[4]; };
+
+    uniform int entryCount;
+    uniform vec4 planes[6];
+    uniform bool occlusion;
+    uniform mat4 pyramidViewProjection;
+    uniform vec2 pyramidSize;
+    uniform int pyramidLevels;
+    layout (binding = 0) uniform sampler2D depthPyramid;
+
+    bool IsOccluded(vec4 sphere)
+    {
+        // Screen rectangle and nearest depth of the box around the sphere, on the frame of the pyramid
+        vec2 minUV = vec2(1.0);
+        vec2 maxUV = vec2(0.0);
+        float minDepth = 1.0;
+        for (int i = 0; i < 8; ++i)
+        {
+            vec3 corner = sphere.xyz + sphere.w * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+            vec4 clip = pyramidViewProjection * vec4(corner, 1.0);
+            if (clip.w <= 0.0) return false;
+
+            vec3 ndc = clip.xyz / clip.w;
+            minUV = min(minUV, ndc.xy * 0.5 + 0.5);
+            maxUV = max(maxUV, ndc.xy * 0.5 + 0.5);
+            minDepth = min(minDepth, ndc.z * 0.5 + 0.5);
+        }
+
+        // What was out of the screen is unknown
+        if (any(lessThan(minUV, vec2(0.0))) || any(greaterThan(maxUV, vec2(1.0)))) return false;
+
+        // The level where the rectangle covers at most 2x2 texels
+        vec2 size = (maxUV - minUV) * pyramidSize;
+        int level = clamp(int(ceil(log2(max(max(size.x, size.y), 1.0)))), 0, pyramidLevels - 1);
+
+        ivec2 minTexel;
+        ivec2 maxTexel;
+        while (true)
+        {
+            ivec2 levelSize = max(ivec2(pyramidSize) >> level, ivec2(1));
+            minTexel = clamp(ivec2(floor(minUV * vec2(levelSize))), ivec2(0), levelSize - 1);
+            maxTexel = clamp(ivec2(floor(maxUV * vec2(levelSize))), ivec2(0), levelSize - 1);
+            if (level == pyramidLevels - 1 || all(lessThanEqual(maxTexel - minTexel, ivec2(1)))) break;
+            ++level;
+        }
+
+        float occluderDepth = max(
+            max(texelFetch(depthPyramid, minTexel, level).r, texelFetch(depthPyramid, ivec2(maxTexel.x, minTexel.y), level).r),
+            max(texelFetch(depthPyramid, ivec2(minTexel.x, maxTexel.y), level).r, texelFetch(depthPyramid, maxTexel, level).r));
+        return minDepth > occluderDepth;
+    }
+
+    void main()
+    {
+        uint i = gl_GlobalInvocationID.x;
+        if (i >= uint(entryCount)) return;
+
+        CullEntry entry = entries[i];
+        uint result = 0u;
+        for (int p = 0; p < 6; ++p)
+        {
+            if (dot(planes[p].xyz, entry.sphere.xyz) + planes[p].w < -entry.sphere.w) result = 1u;
+        }
+        if (result == 0u && occlusion && IsOccluded(entry.sphere)) result = 2u;
+
+        results[i] = result;
+        atomicAdd(stats[result], 1u);
+
+        if (result == 0u)
+        {
+            uint slot = atomicAdd(commands[entry.command].instanceCount, 1u);
+            instanceObjects[commands[entry.command].baseInstance + slot] = entry.object;
+        }
+    }
+    )";
+
+    // One invocation per command, the ones with instances are copied to the next free place of their run
+    const char* compact = R"(
+    #version 460 core
+    layout (local_size_x = 64) in;
+
+    struct DrawCommand
+    {
+        uint count;
+        uint instanceCount;
+        uint firstIndex;
+        int baseVertex;
+        uint baseInstance;
+    };
+
+    layout (std430, binding = 3) readonly buffer Commands { DrawCommand commands[]; };
+    layout (std430, binding = 6) buffer Stats { uint stats[4]; };
+    layout (std430, binding = 7) readonly buffer CommandRuns { uvec2 commandRuns[]; };
+    layout (std430, binding = 8) writeonly buffer DrawCommands { DrawCommand drawCommands[]; };
+    layout (std430, binding = 9) buffer RunCounts { uint runCounts[]; };
+
+    uniform int commandCount;
+
+    void main()
+    {
+        uint c = gl_GlobalInvocationID.x;
+        if (c >= uint(commandCount)) return;
+
+        DrawCommand command = commands[c];
+        if (command.instanceCount == 0u) return;
+
+        uvec2 run = commandRuns[c];
+        uint slot = atomicAdd(runCounts[run.x], 1u);
+        drawCommands[run.y + slot] = command;
+        atomicAdd(stats[3], command.count / 3u * command.instanceCount);
+    }
+    )";
+
+    // Max of the source texels under each texel of the destination, 3 of them on an axis when the source size is odd
+    const char* reduce = R"(
+    #version 460 core
+    layout (local_size_x = 8, local_size_y = 8) in;
+
+    layout (binding = 0) uniform sampler2D source;
+    layout (r32f, binding = 0) writeonly uniform image2D destination;
+    uniform int sourceLevel;
+
+    void main()
+    {
+        ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+        ivec2 destinationSize = imageSize(destination);
+        if (any(greaterThanEqual(texel, destinationSize))) return;
+
+        ivec2 sourceSize = textureSize(source, sourceLevel);
+        ivec2 first = texel * sourceSize / destinationSize;
+        ivec2 last = ((texel + 1) * sourceSize + destinationSize - 1) / destinationSize - 1;
+
+        float depth = 0.0;
+        for (int y = first.y; y <= last.y; ++y)
+        {
+            for (int x = first.x; x <= last.x; ++x) depth = max(depth, texelFetch(source, ivec2(x, y), sourceLevel).r);
+        }
+        imageStore(destination, texel, vec4(depth));
+    }
+    )";
+}
+
+// Same layout as DrawElementsIndirectCommand
+static const size_t COMMAND_SIZE = 5 * sizeof(uint32_t);
+
+static const unsigned int ENTRY_BINDING = 2;
+static const unsigned int COMMAND_BINDING = 3;
+static const unsigned int INSTANCE_BINDING = 4;
+static const unsigned int RESULT_BINDING = 5;
+static const unsigned int STATS_BINDING = 6;
+static const unsigned int RUN_BINDING = 7;
+static const unsigned int DRAW_BINDING = 8;
+static const unsigned int RUN_COUNT_BINDING = 9;
+
+GpuCulling::GpuCulling()
+{
+    cullShader = Shader::Compute(CullingShaders::cull);
+    compactShader = Shader::Compute(CullingShaders::compact);
+    reduceShader = Shader::Compute(CullingShaders::reduce);
+
+    glGenBuffers(1, &entryBuffer);
+    glGenBuffers(1, &runBuffer);
+    glGenBuffers(1, &resultBuffer);
+    glGenBuffers(1, &drawBuffer);
+    glGenBuffers(1, &runCountBuffer);
+    glGenBuffers(STATS_BUFFER_COUNT, statsBuffers);
+
+    // Only depth, the occluders don't write any color
+    glGenFramebuffers(1, &occluderFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, occluderFramebuffer);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // Mapped once, coherent so the values are there as soon as the fence of the buffer is signaled
+    const uint32_t zeros[4] = { 0, 0, 0, 0 };
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    for (unsigned int i = 0; i < STATS_BUFFER_COUNT; ++i)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsBuffers[i]);
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER, sizeof(zeros), zeros, flags);
+        statsData[i] = (const uint32_t*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zeros), flags);
+        if (statsData[i] == nullptr) LOG("GPU culling: Could not map the stats buffer, the counts won't be shown");
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+GpuCulling::~GpuCulling()
+{
+    glDeleteBuffers(1, &entryBuffer);
+    glDeleteBuffers(1, &runBuffer);
+    glDeleteBuffers(1, &resultBuffer);
+    glDeleteBuffers(1, &drawBuffer);
+    glDeleteBuffers(1, &runCountBuffer);
+    for (unsigned int i = 0; i < STATS_BUFFER_COUNT; ++i)
+    {
+        if (statsFences[i] != nullptr) glDeleteSync(statsFences[i]);
+        if (statsData[i] != nullptr)
+        {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsBuffers[i]);
+            glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+        }
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glDeleteBuffers(STATS_BUFFER_COUNT, statsBuffers);
+    if (depthTexture != 0) glDeleteTextures(1, &depthTexture);
+    if (pyramidTexture != 0) glDeleteTextures(1, &pyramidTexture);
+    glDeleteFramebuffers(1, &occluderFramebuffer);
+}
+
+// Orphans the buffer and uploads the data, the capacity doubles when it doesn't fit
+static void UploadStorage(unsigned int buffer, size_t& capacity, const void* data, size_t size)
+{
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    if (size > capacity) capacity = size * 2;
+    glBufferData(GL_SHADER_STORAGE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+    if (data != nullptr && size > 0) glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, data);
+}
+
+void GpuCulling::Cull(const std::vector<CullEntry>& entries, const std::vector<glm::uvec2>& commandRuns, uint32_t runCount,
+    unsigned int commandBuffer, unsigned int instanceBuffer, const Frustum& frustum, bool occlusion)
+{
+    ReadFinishedStats();
+
+    // The counts of this Cull start at zero. If the GPU never finished the last use of the buffer, those counts are dropped
+    if (statsFences[statsFrame] != nullptr)
+    {
+        glDeleteSync(statsFences[statsFrame]);
+        statsFences[statsFrame] = nullptr;
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsBuffers[statsFrame]);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+    if (entries.empty())
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        statsFences[statsFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        statsFrame = (statsFrame + 1) % STATS_BUFFER_COUNT;
+        return;
+    }
+
+    UploadStorage(entryBuffer, entryCapacity, entries.data(), entries.size() * sizeof(CullEntry));
+    UploadStorage(runBuffer, commandCapacity, commandRuns.data(), commandRuns.size() * sizeof(glm::uvec2));
+
+    // Sized as the buffers above, one result per entry and at most every command drawn
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, resultBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, entryCapacity / sizeof(CullEntry) * sizeof(uint32_t), nullptr, GL_STREAM_READ);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, commandCapacity / sizeof(glm::uvec2) * COMMAND_SIZE, nullptr, GL_STREAM_DRAW);
+
+    std::vector<uint32_t> runCounts(runCount, 0);
+    UploadStorage(runCountBuffer, runCapacity, runCounts.data(), runCounts.size() * sizeof(uint32_t));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ENTRY_BINDING, entryBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BINDING, instanceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RESULT_BINDING, resultBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, STATS_BINDING, statsBuffers[statsFrame]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RUN_BINDING, runBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_BINDING, drawBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RUN_COUNT_BINDING, runCountBuffer);
+
+    cullShader->Use();
+    cullShader->SetInt("entryCount", (int)entries.size());
+    cullShader->SetVec4Array("planes", frustum.planes, 6);
+    cullShader->SetBool("occlusion", occlusion && pyramidValid);
+    cullShader->SetMat4("pyramidViewProjection", pyramidViewProjection);
+    cullShader->SetVec2("pyramidSize", glm::vec2((float)pyramidWidth, (float)pyramidHeight));
+    cullShader->SetInt("pyramidLevels", DepthPyramid::GetLevelCount(pyramidWidth, pyramidHeight));
+    cullShader->SetInt("depthPyramid", 0);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+    glDispatchCompute((GLuint)((entries.size() + 63) / 64), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    compactShader->Use();
+    compactShader->SetInt("commandCount", (int)commandRuns.size());
+    glDispatchCompute((GLuint)((commandRuns.size() + 63) / 64), 1, 1);
+
+    // The draws read the compacted commands, their counts and the instance slots, the CPU reads the stats through the mapping
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    statsFences[statsFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    statsFrame = (statsFrame + 1) % STATS_BUFFER_COUNT;
+}
+
+void GpuCulling::ReadFinishedStats()
+{
+    // From the newest Cull to the oldest, the first one the GPU has finished. The others stay as they were
+    for (unsigned int age = 1; age < STATS_BUFFER_COUNT; ++age)
+    {
+        const unsigned int slot = (statsFrame + STATS_BUFFER_COUNT - age) % STATS_BUFFER_COUNT;
+        if (statsFences[slot] == nullptr || statsData[slot] == nullptr) continue;
+        GLenum status = glClientWaitSync(statsFences[slot], 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) continue;
+
+        glDeleteSync(statsFences[slot]);
+        statsFences[slot] = nullptr;
+
+        visibleEntries = statsData[slot][CULL_VISIBLE];
+        frustumCulled = statsData[slot][CULL_FRUSTUM];
+        occluded = statsData[slot][CULL_OCCLUDED];
+        triangles = statsData[slot][3];
+        return;
+    }
+}
+
+void GpuCulling::ResizePyramid(int width, int height)
+{
+    if (depthTexture != 0) glDeleteTextures(1, &depthTexture);
+    if (pyramidTexture != 0) glDeleteTextures(1, &pyramidTexture);
+
+    glGenTextures(1, &depthTexture);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenTextures(1, &pyramidTexture);
+    glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+    glTexStorage2D(GL_TEXTURE_2D, DepthPyramid::GetLevelCount(width, height), GL_R32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    pyramidWidth = width;
+    pyramidHeight = height;
+    pyramidValid = false;
+
+    LOG("Depth pyramid created: %dx%d, %d levels", width, height, DepthPyramid::GetLevelCount(width, height));
+}
+
+void GpuCulling::BuildDepthPyramid(int width, int height, const glm::mat4& viewProjection)
+{
+    if (width <= 0 || height <= 0) return;
+    if (width != pyramidWidth || height != pyramidHeight) ResizePyramid(width, height);
+
+    // The depth buffer of the default framebuffer can't be sampled, a copy can
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+    ReduceDepth(viewProjection);
+}
+
+void GpuCulling::BeginOccluderPass(int width, int height)
+{
+    width = std::max(width, 1);
+    height = std::max(height, 1);
+    if (width != pyramidWidth || height != pyramidHeight) ResizePyramid(width, height);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, occluderFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+    glViewport(0, 0, width, height);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void GpuCulling::EndOccluderPass(const glm::mat4& viewProjection, int viewportWidth, int viewportHeight)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, viewportWidth, viewportHeight);
+
+    glActiveTexture(GL_TEXTURE0);
+    ReduceDepth(viewProjection);
+}
+
+bool GpuCulling::ReadDepthPyramid(DepthPyramid& pyramid, int maxWidth)
+{
+    if (!pyramidValid) return false;
+
+    // The first level narrower than maxWidth, the CPU reduces the rest
+    int level = 0;
+    while (level + 1 < DepthPyramid::GetLevelCount(pyramidWidth, pyramidHeight) &&
+        DepthPyramid::GetLevelSize(pyramidWidth, pyramidHeight, level).x > maxWidth) ++level;
+
+    glm::ivec2 size = DepthPyramid::GetLevelSize(pyramidWidth, pyramidHeight, level);
+    pyramid.width = size.x;
+    pyramid.height = size.y;
+    pyramid.viewProjection = pyramidViewProjection;
+    pyramid.levels.resize(1);
+    pyramid.levels[0].resize((size_t)size.x * size.y);
+
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+    glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+    glGetTexImage(GL_TEXTURE_2D, level, GL_RED, GL_FLOAT, pyramid.levels[0].data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    pyramid.Reduce();
+    return true;
+}
+
+void GpuCulling::ReduceDepth(const glm::mat4& viewProjection)
+{
+    const int width = pyramidWidth;
+    const int height = pyramidHeight;
+
+    reduceShader->Use();
+    reduceShader->SetInt("source", 0);
+
+    // The first level is the copy as it is, each next one reads the level before
+    const int levels = DepthPyramid::GetLevelCount(width, height);
+    for (int level = 0; level < levels; ++level)
+    {
+        glBindTexture(GL_TEXTURE_2D, (level == 0) ? depthTexture : pyramidTexture);
+        reduceShader->SetInt("sourceLevel", (level == 0) ? 0 : level - 1);
+        glBindImageTexture(0, pyramidTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+        glm::ivec2 size = DepthPyramid::GetLevelSize(width, height, level);
+        glDispatchCompute((GLuint)((size.x + 7) / 8), (GLuint)((size.y + 7) / 8), 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    pyramidViewProjection = viewProjection;
+    pyramidValid = true;
+}
+
+unsigned int GpuCulling::Validate(const std::vector<CullEntry>& entries, const Frustum& frustum, bool occlusion)
+{
+    unsigned int mismatches = 0;
+
+    DepthPyramid pyramid;
+    const bool usePyramid = occlusion && pyramidValid;
+    if (usePyramid)
+    {
+        pyramid.width = pyramidWidth;
+        pyramid.height = pyramidHeight;
+        pyramid.viewProjection = pyramidViewProjection;
+        pyramid.levels.resize(DepthPyramid::GetLevelCount(pyramidWidth, pyramidHeight));
+
+        glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+        for (int level = 0; level < (int)pyramid.levels.size(); ++level)
+        {
+            glm::ivec2 size = pyramid.GetLevelSize(level);
+            pyramid.levels[level].resize((size_t)size.x * size.y);
+            glGetTexImage(GL_TEXTURE_2D, level, GL_RED, GL_FLOAT, pyramid.levels[level].data());
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // The first level is the input, the rest have to be the same reduction
+        DepthPyramid reference = pyramid;
+        reference.Reduce();
+        for (size_t level = 1; level < pyramid.levels.size(); ++level)
+        {
+            for (size_t i = 0; i < pyramid.levels[level].size(); ++i)
+            {
+                if (pyramid.levels[level][i] != reference.levels[level][i]) ++mismatches;
+            }
+        }
+    }
+
+    std::vector<uint32_t> results(entries.size(), CULL_VISIBLE);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, resultBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, results.size() * sizeof(uint32_t), results.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (CullReference(entries[i], frustum, usePyramid ? &pyramid : nullptr) != results[i]) ++mismatches;
+    }
+    return mismatches;
+}
+
+CullResult GpuCulling::CullReference(const CullEntry& entry, const Frustum& frustum, const DepthPyramid* pyramid)
+{
+    BoundingSphere sphere;
+    sphere.center = glm::vec3(entry.sphere);
+    sphere.radius = entry.sphere.w;
+
+    if (!frustum.Intersects(sphere)) return CULL_FRUSTUM;
+    if (pyramid != nullptr)
+    {
+        AABB box;
+        box.min = sphere.center - glm::vec3(sphere.radius);
+        box.max = sphere.center + glm::vec3(sphere.radius);
+        if (pyramid->IsOccluded(box)) return CULL_OCCLUDED;
+    }
+    return CULL_VISIBLE;
+}
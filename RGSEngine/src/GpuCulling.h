@@ -0,0 +1,115 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include "BoundingVolumes.h"
+#include "DepthPyramid.h"
+
+class Shader;
+
+// One instance of a draw command to test, read by the culling shader with the std430 layout
+struct CullEntry
+{
+    glm::vec4 sphere = glm::vec4(0.0f); // World space center and radius
+    uint32_t command = 0;               // Index on the command buffer, its instanceCount is the visible count
+    uint32_t object = 0;                // Written to the instance slot of the command when visible
+    uint32_t padding[2] = { 0, 0 };
+};
+
+static_assert(sizeof(CullEntry) == 32, "Same layout as the CullEntry of the culling shader");
+
+// Result of each entry, the same codes on the GPU and on the CPU reference
+enum CullResult : uint32_t
+{
+    CULL_VISIBLE = 0,
+    CULL_FRUSTUM = 1,
+    CULL_OCCLUDED = 2
+};
+
+// Frustum and occlusion culling of the indirect commands on a compute shader
+// The depth pyramid comes from the previous frame, so an object that appears from behind another one shows one frame late,
+// or from a depth pass of the occluders of the current frame
+class GpuCulling
+{
+public:
+
+    GpuCulling();
+    ~GpuCulling();
+
+    // Tests the entries, counts the visible instances on the commands of commandBuffer (uploaded with instanceCount 0)
+    // and writes their objects on instanceBuffer, from the baseInstance of each command
+    // Then the commands with instances are copied to the start of their run, commandRuns has the run and its first command
+    void Cull(const std::vector<CullEntry>& entries, const std::vector<glm::uvec2>& commandRuns, uint32_t runCount,
+        unsigned int commandBuffer, unsigned int instanceBuffer, const Frustum& frustum, bool occlusion);
+
+    // Compacted commands and the count of each run, for glMultiDrawElementsIndirectCount
+    unsigned int GetDrawBuffer() const { return drawBuffer; }
+    unsigned int GetRunCountBuffer() const { return runCountBuffer; }
+
+    // Copies the depth buffer of the frame just drawn and reduces it for the culling of the next one
+    void BuildDepthPyramid(int width, int height, const glm::mat4& viewProjection);
+    bool HasDepthPyramid() const { return pyramidValid; }
+
+    // Depth only pass at width x height, the caller draws the occluders between Begin and End
+    // End reduces their depth to the pyramid and goes back to the default framebuffer with the viewport given
+    void BeginOccluderPass(int width, int height);
+    void EndOccluderPass(const glm::mat4& viewProjection, int viewportWidth, int viewportHeight);
+
+    // Copies the pyramid to the CPU from the first level not wider than maxWidth, waits for the GPU
+    bool ReadDepthPyramid(DepthPyramid& pyramid, int maxWidth);
+
+    // Reads back the results of the last Cull and the pyramid and checks them against the CPU reference
+    // Slow, the GPU has to finish first. Returns the entries and pyramid texels that don't match
+    unsigned int Validate(const std::vector<CullEntry>& entries, const Frustum& frustum, bool occlusion);
+
+    // Same tests as the shader, the occlusion one with the box around the sphere
+    static CullResult CullReference(const CullEntry& entry, const Frustum& frustum, const DepthPyramid* pyramid);
+
+    // Counts of the newest Cull the GPU has finished, usually the one of the frame before. Read without waiting for the GPU
+    uint32_t visibleEntries = 0;
+    uint32_t frustumCulled = 0;
+    uint32_t occluded = 0;
+    uint32_t triangles = 0;
+
+private:
+
+    void ResizePyramid(int width, int height);
+
+    // Builds the levels of the pyramid from depthTexture
+    void ReduceDepth(const glm::mat4& viewProjection);
+
+    std::unique_ptr<Shader> cullShader;
+    std::unique_ptr<Shader> compactShader;
+    std::unique_ptr<Shader> reduceShader;
+
+    unsigned int entryBuffer = 0;
+    unsigned int runBuffer = 0;      // Run and first command of each command
+    unsigned int resultBuffer = 0;   // CullResult of each entry
+    unsigned int drawBuffer = 0;
+    unsigned int runCountBuffer = 0;
+    size_t entryCapacity = 0;
+    size_t commandCapacity = 0;
+    size_t runCapacity = 0;
+
+    // Visible, frustum culled, occluded and triangles. A ring of persistently mapped buffers, each Cull writes the next one
+    // and signals its fence, the stats are only read from a buffer whose fence is already signaled
+    static const unsigned int STATS_BUFFER_COUNT = 3;
+    unsigned int statsBuffers[STATS_BUFFER_COUNT] = {};
+    const uint32_t* statsData[STATS_BUFFER_COUNT] = {};
+    GLsync statsFences[STATS_BUFFER_COUNT] = {};
+    unsigned int statsFrame = 0;
+
+    void ReadFinishedStats();
+
+    unsigned int depthTexture = 0;   // Copy of the depth buffer or the target of the occluder pass
+    unsigned int occluderFramebuffer = 0;
+    unsigned int pyramidTexture = 0;
+    int pyramidWidth = 0;
+    int pyramidHeight = 0;
+    glm::mat4 pyramidViewProjection = glm::mat4(1.0f);
+    bool pyramidValid = false;
+};
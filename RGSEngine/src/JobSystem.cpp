@@ -0,0 +1,139 @@
+#include "JobSystem.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <memory>
+
+JobSystem& JobSystem::GetInstance()
+{
+    static JobSystem instance;
+    return instance;
+}
+
+JobSystem::~JobSystem()
+{
+    Shutdown();
+}
+
+void JobSystem::Init()
+{
+    if (!workers.empty()) return;
+
+    unsigned int cores = std::thread::hardware_concurrency();
+    unsigned int workerCount = (cores > 1) ? cores - 1 : 1;
+
+    stopping = false;
+    for (unsigned int i = 0; i < workerCount; ++i)
+    {
+        workers.emplace_back(&JobSystem::WorkerLoop, this);
+    }
+
+    LOG("Job System initialized with %d worker threads", workerCount);
+}
+
+void JobSystem::Shutdown()
+{
+    if (workers.empty()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+
+    for (auto& worker : workers)
+    {
+        if (worker.joinable()) worker.join();
+    }
+    workers.clear();
+    jobs.clear();
+}
+
+void JobSystem::Submit(std::function<void()> job)
+{
+    // Without workers the job runs right away on the calling thread
+    if (workers.empty())
+    {
+        job();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        jobs.push_back(std::move(job));
+    }
+    queueCondition.notify_one();
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t minBatchSize, const std::function<void(uint32_t begin, uint32_t end)>& function)
+{
+    if (count == 0) return;
+
+    // Batches big enough so each thread gets a few of them
+    uint32_t threads = GetWorkerCount() + 1;
+    uint32_t batchSize = std::max(minBatchSize, (count + threads * 4 - 1) / (threads * 4));
+
+    if (workers.empty() || batchSize >= count)
+    {
+        function(0, count);
+        return;
+    }
+
+    uint32_t batchCount = (count + batchSize - 1) / batchSize;
+
+    // Batches are taken from a counter instead of the queue. The state is shared with the helper jobs:
+    // one that starts after the loop is done finds no batch left and never touches function
+    struct ParallelState
+    {
+        std::atomic<uint32_t> nextBatch{ 0 };
+        std::atomic<uint32_t> remaining{ 0 };
+    };
+    auto state = std::make_shared<ParallelState>();
+    state->remaining.store(batchCount, std::memory_order_relaxed);
+
+    auto RunBatches = [state, &function, batchSize, batchCount, count]()
+        {
+            uint32_t b;
+            while ((b = state->nextBatch.fetch_add(1, std::memory_order_relaxed)) < batchCount)
+            {
+                uint32_t begin = b * batchSize;
+                uint32_t end = std::min(begin + batchSize, count);
+                function(begin, end);
+                state->remaining.fetch_sub(1, std::memory_order_release);
+            }
+        };
+
+    // The helpers go before the background jobs (imports, texture decodes) already queued
+    uint32_t helpers = std::min(GetWorkerCount(), batchCount - 1);
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        for (uint32_t i = 0; i < helpers; ++i) jobs.push_front(RunBatches);
+    }
+    queueCondition.notify_all();
+
+    // The calling thread only runs batches of this loop, never a queued job, so a long import can't end up on the main thread
+    RunBatches();
+    while (state->remaining.load(std::memory_order_acquire) > 0)
+    {
+        std::this_thread::yield();
+    }
+}
+
+void JobSystem::WorkerLoop()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+
+            if (stopping && jobs.empty()) return;
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        job();
+    }
+}
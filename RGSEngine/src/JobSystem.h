@@ -0,0 +1,50 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+// Small pool of worker threads shared by the engine systems
+// Jobs must not touch OpenGL, the context only lives on the main thread
+class JobSystem
+{
+public:
+
+    // Public method to get the instance of the Singleton
+    static JobSystem& GetInstance();
+
+    // Creates the workers, one less than the logical cores because the main thread also works
+    void Init();
+    // Waits the pending jobs and joins the workers
+    void Shutdown();
+
+    // Queue a job and return immediately
+    void Submit(std::function<void()> job);
+
+    // Splits [0, count) in batches of at least minBatchSize and runs them on the workers
+    // The calling thread also runs batches, only of this loop, and returns when all of them are done
+    void ParallelFor(uint32_t count, uint32_t minBatchSize, const std::function<void(uint32_t begin, uint32_t end)>& function);
+
+    unsigned int GetWorkerCount() const { return (unsigned int)workers.size(); }
+
+private:
+
+    // Private constructor to prevent instantiation
+    JobSystem() = default;
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    void WorkerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopping = false;
+};
@@ -6,7 +6,15 @@
 #include "ComponentTransform.h"
 #include "ComponentTexture.h"
 #include "ModuleScene.h"
+#include "ModuleResources.h"
+#include "ResourceMesh.h"
+#include "ResourceTexture.h"
 #include "Log.h"
+#include "JobSystem.h"
+#include "TextureStreamer.h"
+#include "TextureFormat.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
 
 #include <IL/il.h>
 #include <IL/ilu.h>
@@ -17,8 +25,202 @@
 #include <algorithm>
 #include <cfloat> 
 #include <fstream>
+#include <chrono>
 
 #include <filesystem>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+static const unsigned int FBX_IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenNormals | aiProcess_JoinIdenticalVertices | aiProcess_CalcTangentSpace;
+
+// Everything that changes the artifacts of a source, so they are imported again when one of them changes
+static uint64_t GetMeshSettingsHash()
+{
+    uint32_t settings[5] = { FBX_IMPORT_FLAGS, ResourceMesh::quantizePositions ? 1u : 0u, ResourceMesh::optimizeVertexCache ? 1u : 0u,
+        ResourceMesh::generateLods ? 1u : 0u, MESH_FILE_VERSION };
+    return AssetDatabase::Hash(settings, sizeof(settings));
+}
+
+static uint64_t GetTextureSettingsHash()
+{
+    uint32_t settings[2] = { ResourceTexture::compressOnImport ? 1u : 0u, TEXTURE_FILE_VERSION };
+    return AssetDatabase::Hash(settings, sizeof(settings));
+}
+
+// The C API of assimp keeps the last error and the log streams in globals, so the imports from the workers and from the main thread go one at a time
+static std::mutex assimpMutex;
+
+static const aiScene* ImportScene(const char* path, std::string& error)
+{
+    std::lock_guard<std::mutex> lock(assimpMutex);
+
+    const aiScene* scene = aiImportFile(path, FBX_IMPORT_FLAGS);
+    if (scene == nullptr || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    {
+        error = aiGetErrorString();
+        if (scene != nullptr) aiReleaseImport(scene);
+        return nullptr;
+    }
+    return scene;
+}
+
+static glm::mat4 ToGlmMatrix(const aiMatrix4x4& m)
+{
+    // Assimp is Row-Major, GLM is Column-Major -> Transpose
+    glm::mat4 result;
+    result[0][0] = m.a1; result[0][1] = m.b1; result[0][2] = m.c1; result[0][3] = m.d1;
+    result[1][0] = m.a2; result[1][1] = m.b2; result[1][2] = m.c2; result[1][3] = m.d2;
+    result[2][0] = m.a3; result[2][1] = m.b3; result[2][2] = m.c3; result[2][3] = m.d3;
+    result[3][0] = m.a4; result[3][1] = m.b4; result[3][2] = m.c4; result[3][3] = m.d4;
+    return result;
+}
+
+// Same box CalculateBoundingBox gives for the hierarchy of the scene, but from the assimp data so it can run on a worker
+// meshBounds are the local bounds of each mesh, every node only transforms the box of its meshes
+static void CalculateSceneBounds(const aiNode* node, const std::vector<AABB>& meshBounds, const glm::mat4& parentTransform, AABB& bounds)
+{
+    glm::mat4 worldTransform = parentTransform * ToGlmMatrix(node->mTransformation);
+
+    for (unsigned int i = 0; i < node->mNumMeshes; ++i)
+    {
+        bounds.Expand(meshBounds[node->mMeshes[i]].Transformed(worldTransform));
+    }
+
+    for (unsigned int i = 0; i < node->mNumChildren; ++i)
+    {
+        CalculateSceneBounds(node->mChildren[i], meshBounds, worldTransform, bounds);
+    }
+}
+
+static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "The assimp positions are read as float3");
+
+static void RemapStream(float*& stream, unsigned int components, const std::vector<unsigned int>& remap, unsigned int vertexCount)
+{
+    if (stream == nullptr) return;
+
+    float* remapped = new float[(size_t)vertexCount * components];
+    MeshOptimizer::RemapVertices(remapped, stream, components, remap);
+    delete[] stream;
+    stream = remapped;
+}
+
+// Triangles for the post-transform cache, grouped in meshlets and then the vertices in the order they are used, before the mesh is packed
+// The meshlets are always built, the cache and fetch steps only when optimizeVertexCache is on
+static std::vector<Meshlet> OptimizeMeshOrder(MeshData& meshData)
+{
+    if (meshData.num_indices < 3) return {};
+    for (unsigned int i = 0; i < meshData.num_indices; ++i)
+    {
+        if (meshData.indices[i] >= meshData.num_vertices) return {};
+    }
+
+    if (!ResourceMesh::optimizeVertexCache)
+    {
+        return MeshletBuilder::Build(meshData.indices, meshData.num_indices, meshData.vertices, meshData.num_vertices);
+    }
+
+    MeshOptimizer::CacheStats before = MeshOptimizer::AnalyzeVertexCache(meshData.indices, meshData.num_indices, meshData.num_vertices);
+
+    MeshOptimizer::OptimizeVertexCache(meshData.indices, meshData.num_indices, meshData.num_vertices);
+
+    // Only moves whole triangles, the fetch order below is still valid for the meshlets
+    std::vector<Meshlet> meshlets = MeshletBuilder::Build(meshData.indices, meshData.num_indices, meshData.vertices, meshData.num_vertices);
+
+    unsigned int vertexCount = 0;
+    std::vector<unsigned int> remap = MeshOptimizer::OptimizeVertexFetch(meshData.indices, meshData.num_indices, meshData.num_vertices, vertexCount);
+    RemapStream(meshData.vertices, 3, remap, vertexCount);
+    RemapStream(meshData.normals, 3, remap, vertexCount);
+    RemapStream(meshData.texCoords, 2, remap, vertexCount);
+    meshData.num_vertices = vertexCount;
+
+    MeshOptimizer::CacheStats after = MeshOptimizer::AnalyzeVertexCache(meshData.indices, meshData.num_indices, meshData.num_vertices);
+    LOG("Resources: Vertex cache optimized, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (%d triangles, %d meshlets)",
+        before.acmr, after.acmr, before.atvr, after.atvr, (int)(meshData.num_indices / 3), (int)meshlets.size());
+    return meshlets;
+}
+
+// Smaller meshes are cheap enough at any distance
+static const unsigned int LOD_MIN_TRIANGLES = 256;
+
+// Error allowed on the first simplified level as a fraction of the diagonal of the mesh, it doubles on each next one
+static const float LOD_BASE_ERROR = 0.01f;
+
+// A level that keeps more than this of the previous one is not worth drawing
+static const float LOD_MIN_REDUCTION = 0.8f;
+
+// Each level is simplified from the previous one to half of its triangles, after the mesh is packed so the indices use its size
+static void BuildMeshLods(MeshData& meshData)
+{
+    PackedMesh& packed = meshData.packed;
+    if (!ResourceMesh::generateLods || meshData.num_indices < LOD_MIN_TRIANGLES * 3 || !packed.bounds.IsValid()) return;
+
+    const float diagonal = glm::length(packed.bounds.max - packed.bounds.min);
+    std::vector<unsigned int> previous(meshData.indices, meshData.indices + meshData.num_indices);
+    uint32_t firstIndex = packed.indexCount;
+    float error = 0.0f;
+
+    for (uint32_t level = 1; level < MESH_MAX_LODS; ++level)
+    {
+        float levelError = 0.0f;
+        std::vector<unsigned int> lod = MeshOptimizer::Simplify(previous.data(), previous.size(), meshData.vertices, meshData.num_vertices,
+            previous.size() / 2, diagonal * LOD_BASE_ERROR * (float)(1u << (level - 1)), levelError);
+
+        if (lod.empty() || lod.size() > previous.size() * LOD_MIN_REDUCTION) break;
+
+        MeshOptimizer::OptimizeVertexCache(lod.data(), lod.size(), meshData.num_vertices);
+
+        MeshLod entry;
+        entry.firstIndex = firstIndex;
+        entry.indexCount = (uint32_t)lod.size();
+        entry.error = error += levelError;
+        packed.lods.push_back(entry);
+
+        VertexFormat::AppendIndices(packed.lodIndices, lod.data(), lod.size(), packed.HasFlag(VERTEX_INDEX_16));
+        firstIndex += entry.indexCount;
+        previous = std::move(lod);
+    }
+
+    if (!packed.lods.empty())
+    {
+        LOG("Resources: %d LODs generated, %d -> %d triangles", (int)packed.lods.size(),
+            (int)(meshData.num_indices / 3), (int)(packed.lods.back().indexCount / 3));
+    }
+}
+
+// Highest RAM used by the process since it started, to compare the memory of the imports
+static size_t GetPeakMemoryMB()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+    {
+        return pmc.PeakWorkingSetSize / (1024 * 1024);
+    }
+#else
+    // Peak resident set size, in kilobytes on Linux and in bytes on macOS
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+#ifdef __APPLE__
+        return (size_t)usage.ru_maxrss / (1024 * 1024);
+#else
+        return (size_t)usage.ru_maxrss / 1024;
+#endif
+    }
+#endif
+    return 0;
+}
 
 LoadFiles::LoadFiles()
 {
@@ -46,6 +248,11 @@ bool LoadFiles::Awake()
     if (!std::filesystem::exists("Library/Textures"))
         std::filesystem::create_directory("Library/Textures");
 
+    if (!std::filesystem::exists("Library/Prefabs"))
+        std::filesystem::create_directory("Library/Prefabs");
+
+    assetDatabase.Load("Library/AssetDatabase.json");
+
     if (!std::filesystem::exists("Assets"))
         std::filesystem::create_directory("Assets");
 
@@ -77,6 +284,7 @@ bool LoadFiles::Awake()
 bool LoadFiles::Start()
 {
     LOG("Starting LoadFiles module");
+    textureStreamer.Init();
 
     return true;
 }
@@ -88,6 +296,11 @@ bool LoadFiles::PreUpdate()
 
 bool LoadFiles::Update(float dt)
 {
+    // The imports and the textures share the time of the frame
+    auto deadline = std::chrono::high_resolution_clock::now() + std::chrono::microseconds((long long)(importBudgetMs * 1000.0f));
+
+    UpdateImports(deadline);
+    UpdateTextureRequests(deadline);
     return true;
 }
 
@@ -99,6 +312,24 @@ bool LoadFiles::PostUpdate()
 bool LoadFiles::CleanUp()
 {
     LOG("Cleaning up LoadFiles module");
+
+    // The jobs of the imports still running use this module, wait for them before releasing anything
+    for (auto& import : imports) import->cancelled = true;
+    for (auto& import : imports)
+    {
+        while (import->runningJobs.load(std::memory_order_acquire) > 0) std::this_thread::yield();
+        ReleaseImport(*import);
+    }
+    imports.clear();
+
+    for (auto& request : textureRequests)
+    {
+        while (!request->decoded.load(std::memory_order_acquire)) std::this_thread::yield();
+    }
+    textureRequests.clear();
+    textureStreamer.CleanUp();
+    assetDatabase.Save();
+
     ilShutDown();
     return true;
 }
@@ -122,295 +353,773 @@ void LoadFiles::HandleDropFile(const char* file_path)
 
     if (extension == "fbx")
     {
-        LOG("Detected FBX file, loading...");
-        std::shared_ptr<GameObject> newObject = LoadFBX(file_path);
-        if (newObject != nullptr)
+        LOG("Detected FBX file, importing in the background...");
+        LoadFBXAsync(file_path);
+    }
+    else if (extension == "dds" || extension == "png" || extension == "jpg" || extension == "jpeg")
+    {
+        LOG("Detected texture file (%s), loading...", extension.c_str());
+
+        GameObject* selected = Application::GetInstance().editor->GetSelectedGameObject();
+
+        if (selected != nullptr)
+        {
+            LoadTexture(file_path, selected);
+        }
+        else
+        {
+            LOG("WARNING: No GameObject selected. Please select an object in the Hierarchy to apply the texture.");
+        }
+    }
+}
+
+std::shared_ptr<GameObject> LoadFiles::LoadFBX(const char* file_path)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    std::string sourceKey = assetDatabase.GetSourceKey(file_path, GetMeshSettingsHash());
+    if (sourceKey.empty())
+    {
+        LOG("Error loading FBX %s: can't read the file", file_path);
+        return nullptr;
+    }
+
+    // Get FBX directory for relative textures
+    std::string fbxPath(file_path);
+    size_t lastSlash = fbxPath.find_last_of("/\\");
+    std::string fbxDirectory = (lastSlash != std::string::npos) ? fbxPath.substr(0, lastSlash + 1) : "";
+
+    // Get file name
+    std::string fileName = (lastSlash != std::string::npos) ? fbxPath.substr(lastSlash + 1) : fbxPath;
+    size_t lastDot = fileName.find_last_of(".");
+    if (lastDot != std::string::npos)
+        fileName = fileName.substr(0, lastDot);
+
+    // With the prefab on the Library assimp is not used at all
+    Prefab prefab;
+    const aiScene* scene = nullptr;
+    std::string prefabPath = GetPrefabLibraryPath(sourceKey);
+
+    if (LoadPrefab(prefabPath.c_str(), sourceKey, prefab))
+    {
+        LOG("Loaded FBX hierarchy from Library (FAST): %s", prefabPath.c_str());
+    }
+    else
+    {
+        std::string error;
+        scene = ImportScene(file_path, error);
+        if (scene == nullptr)
         {
-            LOG("FBX loaded successfully and added to scene");
-            Application::GetInstance().scene->AddGameObject(newObject);
+            LOG("Error loading FBX %s: %s", file_path, error.c_str());
+            return nullptr;
+        }
 
-            LOG("========================================");
-            LOG("FBX LOADING SUMMARY:");
-            LOG("Name: %s", newObject->name.c_str());
-            LOG("Active: %s", newObject->active ? "YES" : "NO");
-            LOG("Components:");
+        LOG("Successfully loaded FBX: %s", file_path);
+        LOG("Number of meshes: %d", scene->mNumMeshes);
+        LOG("Number of materials: %d", scene->mNumMaterials);
 
-            if (newObject->GetComponent<ComponentTransform>())
-            {
-                auto t = newObject->GetComponent<ComponentTransform>();
-                LOG("  - Transform: pos(%.2f,%.2f,%.2f) scale(%.2f,%.2f,%.2f)",
-                    t->position.x, t->position.y, t->position.z,
-                    t->scale.x, t->scale.y, t->scale.z);
-            }
+        BuildPrefab(scene, fbxDirectory, fileName, prefab);
+        if (SavePrefab(prefabPath.c_str(), prefab)) assetDatabase.AddArtifact(file_path, prefabPath);
+    }
 
-            if (newObject->GetComponent<ComponentMesh>())
-            {
-                auto m = newObject->GetComponent<ComponentMesh>();
-                LOG("  - Mesh: VAO=%d, VBO=%d, IBO=%d, Indices=%d",
-                    m->VAO, m->VBO, m->IBO, m->indexCount);
-            }
+    std::vector<std::shared_ptr<ResourceMesh>> sceneMeshes = ImportSceneMeshes(scene, prefab.meshCount, file_path, sourceKey);
+    std::shared_ptr<GameObject> rootObject = InstantiatePrefab(prefab, sceneMeshes, file_path, sourceKey);
 
-            if (newObject->GetComponent<ComponentTexture>())
-            {
-                auto tex = newObject->GetComponent<ComponentTexture>();
-                LOG("  - Texture: ID=%d, Path='%s'",
-                    tex->textureID, tex->path.c_str());
-            }
-            else
-            {
-                LOG("  - Texture: NONE (will use default checkers)");
-            }
+    if (scene != nullptr) aiReleaseImport(scene);
+    assetDatabase.Save();
 
-            LOG("Children: %d", (int)newObject->GetChildren().size());
-            LOG("========================================"); if (newObject->GetComponent<ComponentTransform>())
-            {
-                auto t = newObject->GetComponent<ComponentTransform>();
-                LOG("  - Transform: pos(%.2f,%.2f,%.2f) scale(%.2f,%.2f,%.2f)",
-                    t->position.x, t->position.y, t->position.z,
-                    t->scale.x, t->scale.y, t->scale.z);
-            }
+    auto endTime = std::chrono::high_resolution_clock::now();
+    LOG("Import time: %.2f ms, peak memory: %d MB", std::chrono::duration<float, std::milli>(endTime - startTime).count(), (int)GetPeakMemoryMB());
+
+    if (rootObject != nullptr)
+    {
+        if (prefab.hasBounds) ApplyModelScale(rootObject, prefab.minBounds, prefab.maxBounds, 5.0f);
+
+        LOG("=== FBX LOADED SUCCESSFULLY ===");
+        LOG("GameObject name: %s", rootObject->name.c_str());
+        LOG("Has Transform: %s", rootObject->GetComponent<ComponentTransform>() ? "YES" : "NO");
+        LOG("Has Mesh: %s", rootObject->GetComponent<ComponentMesh>() ? "YES" : "NO");
+        LOG("Has Texture: %s", rootObject->GetComponent<ComponentTexture>() ? "YES" : "NO");
+        LOG("Number of children: %d", (int)rootObject->GetChildren().size());
+
+        // Verify that the mesh has data
+        ComponentMesh* mesh = rootObject->GetComponent<ComponentMesh>();
+        if (mesh && mesh->resource)
+        {
+            LOG("Mesh VAO: %d, BaseVertex: %d, FirstIndex: %d, IndexCount: %d",
+                mesh->resource->VAO, mesh->resource->allocation.baseVertex, mesh->resource->allocation.firstIndex, mesh->resource->indexCount);
+        }
+    }
+
+    return rootObject;
+}
 
-            if (newObject->GetComponent<ComponentMesh>())
+float FBXImport::GetProgress() const
+{
+    State current = state.load();
+    if (current == State::FINISHED) return 1.0f;
+    if (current != State::PROCESSING_MESHES && current != State::LOADING_TEXTURES) return 0.0f;
+
+    // 10% the scene, 70% processing and uploading the meshes and 20% the textures
+    float meshes = jobMeshes.empty() ? 1.0f : (processedMeshes.load() + uploadedMeshes) / (2.0f * jobMeshes.size());
+    float textures = 0.0f;
+    if (current == State::LOADING_TEXTURES)
+    {
+        textures = pendingMaterials.empty() ? 1.0f : (float)loadedMaterials / pendingMaterials.size();
+    }
+    return 0.1f + 0.7f * meshes + 0.2f * textures;
+}
+
+const char* FBXImport::GetStateName() const
+{
+    switch (state.load())
+    {
+    case State::LOADING_SCENE: return "Reading file";
+    case State::SCENE_LOADED: return "Creating hierarchy";
+    case State::PROCESSING_MESHES: return "Meshes";
+    case State::LOADING_TEXTURES: return "Textures";
+    case State::FINISHED: return "Finished";
+    case State::FAILED: return "Failed";
+    }
+    return "";
+}
+
+std::shared_ptr<GameObject> LoadFiles::LoadFBXAsync(const char* file_path)
+{
+    auto import = std::make_shared<FBXImport>();
+    import->path = file_path;
+    import->startTime = std::chrono::high_resolution_clock::now();
+
+    // Same names as LoadFBX
+    size_t lastSlash = import->path.find_last_of("/\\");
+    import->fbxDirectory = (lastSlash != std::string::npos) ? import->path.substr(0, lastSlash + 1) : "";
+    import->name = (lastSlash != std::string::npos) ? import->path.substr(lastSlash + 1) : import->path;
+    size_t lastDot = import->name.find_last_of(".");
+    if (lastDot != std::string::npos) import->name = import->name.substr(0, lastDot);
+
+    auto placeholder = std::make_shared<GameObject>(import->name);
+    placeholder->AddComponent(std::make_shared<ComponentTransform>(placeholder.get()));
+    Application::GetInstance().scene->AddGameObject(placeholder);
+    import->placeholder = placeholder;
+
+    import->runningJobs = 1;
+    JobSystem::GetInstance().Submit([this, import]()
+        {
+            bool loaded = false;
+            if (!import->cancelled)
             {
-                auto m = newObject->GetComponent<ComponentMesh>();
-                LOG("  - Mesh: VAO=%d, VBO=%d, IBO=%d, Indices=%d",
-                    m->VAO, m->VBO, m->IBO, m->indexCount);
+                std::string error = "can't read the file";
+                import->sourceKey = assetDatabase.GetSourceKey(import->path, GetMeshSettingsHash());
+
+                if (!import->sourceKey.empty())
+                {
+                    std::string prefabPath = GetPrefabLibraryPath(import->sourceKey);
+                    if (LoadPrefab(prefabPath.c_str(), import->sourceKey, import->prefab))
+                    {
+                        loaded = true;
+                    }
+                    else
+                    {
+                        import->scene = ImportScene(import->path.c_str(), error);
+                        if (import->scene != nullptr)
+                        {
+                            BuildPrefab(import->scene, import->fbxDirectory, import->name, import->prefab);
+                            if (SavePrefab(prefabPath.c_str(), import->prefab)) assetDatabase.AddArtifact(import->path, prefabPath);
+                            loaded = true;
+                        }
+                    }
+                }
+
+                if (!loaded) LOG("Error loading FBX %s: %s", import->path.c_str(), error.c_str());
             }
 
-            if (newObject->GetComponent<ComponentTexture>())
+            import->state = loaded ? FBXImport::State::SCENE_LOADED : FBXImport::State::FAILED;
+            import->runningJobs.fetch_sub(1, std::memory_order_release);
+        });
+
+    imports.push_back(import);
+    LOG("Importing %s in the background", file_path);
+    return placeholder;
+}
+
+void LoadFiles::CancelImport(FBXImport* import)
+{
+    if (import == nullptr || import->cancelled) return;
+
+    import->cancelled = true;
+
+    // What was already created is removed with the placeholder
+    std::shared_ptr<GameObject> placeholder = import->placeholder.lock();
+    if (placeholder != nullptr && placeholder->GetParent() != nullptr)
+    {
+        placeholder->GetParent()->RemoveChild(placeholder.get());
+    }
+
+    LOG("Import of %s cancelled", import->path.c_str());
+}
+
+void LoadFiles::UpdateImports(std::chrono::high_resolution_clock::time_point deadline)
+{
+    if (imports.empty()) return;
+
+    for (size_t i = 0; i < imports.size();)
+    {
+        std::shared_ptr<FBXImport> import = imports[i];
+        std::shared_ptr<GameObject> placeholder = import->placeholder.lock();
+
+        if (placeholder == nullptr && !import->cancelled)
+        {
+            LOG("Import of %s cancelled, its GameObject was deleted", import->path.c_str());
+            import->cancelled = true;
+        }
+
+        bool finished = import->cancelled;
+        if (!finished)
+        {
+            switch (import->state.load())
             {
-                auto tex = newObject->GetComponent<ComponentTexture>();
-                LOG("  - Texture: ID=%d, Path='%s'",
-                    tex->textureID, tex->path.c_str());
+            case FBXImport::State::LOADING_SCENE:
+                break;
+
+            case FBXImport::State::SCENE_LOADED:
+                StartImportMeshes(import, placeholder);
+                break;
+
+            case FBXImport::State::PROCESSING_MESHES:
+                UploadImportMeshes(*import, deadline);
+                if (import->uploadedMeshes == import->jobMeshes.size()) import->state = FBXImport::State::LOADING_TEXTURES;
+                break;
+
+            case FBXImport::State::LOADING_TEXTURES:
+                if (LoadImportTextures(*import, deadline))
+                {
+                    import->state = FBXImport::State::FINISHED;
+                    Application::GetInstance().scene->RebuildBVH();
+                    assetDatabase.Save();
+
+                    auto endTime = std::chrono::high_resolution_clock::now();
+                    LOG("=== FBX LOADED SUCCESSFULLY ===");
+                    LOG("GameObject name: %s, meshes: %d, import time: %.2f ms, peak memory: %d MB", import->name.c_str(), (int)import->prefab.meshCount,
+                        std::chrono::duration<float, std::milli>(endTime - import->startTime).count(), (int)GetPeakMemoryMB());
+                }
+                break;
+
+            case FBXImport::State::FAILED:
+                if (placeholder->GetParent() != nullptr) placeholder->GetParent()->RemoveChild(placeholder.get());
+                break;
+
+            case FBXImport::State::FINISHED:
+                break;
             }
-            else
+
+            FBXImport::State current = import->state.load();
+            finished = (current == FBXImport::State::FINISHED || current == FBXImport::State::FAILED);
+        }
+
+        // Cancelled imports wait here until their jobs are done with the scene
+        if (finished && import->runningJobs.load(std::memory_order_acquire) == 0)
+        {
+            ReleaseImport(*import);
+            imports.erase(imports.begin() + i);
+            continue;
+        }
+        ++i;
+    }
+}
+
+static void CollectMeshTargets(const std::shared_ptr<GameObject>& gameObject, const std::unordered_map<std::string, int>& pathJobs, FBXImport& import)
+{
+    ComponentMesh* mesh = gameObject->GetComponent<ComponentMesh>();
+    if (mesh != nullptr && mesh->resource == nullptr)
+    {
+        auto it = pathJobs.find(mesh->libraryPath);
+        if (it != pathJobs.end()) import.jobTargets[it->second].push_back(gameObject);
+    }
+
+    for (const auto& child : gameObject->GetChildren())
+    {
+        CollectMeshTargets(child, pathJobs, import);
+    }
+}
+
+void LoadFiles::StartImportMeshes(std::shared_ptr<FBXImport> import, std::shared_ptr<GameObject> placeholder)
+{
+    const Prefab& prefab = import->prefab;
+    ModuleResources* resources = Application::GetInstance().resources.get();
+
+    // The meshes already on the GPU are used right away, the rest get a job per library path
+    std::vector<std::shared_ptr<ResourceMesh>> sceneMeshes(prefab.meshCount);
+    std::unordered_map<std::string, int> pathJobs;
+
+    for (unsigned int i = 0; i < prefab.meshCount; ++i)
+    {
+        std::string libraryPath = GetMeshLibraryPath(import->sourceKey, i);
+        assetDatabase.AddArtifact(import->path, libraryPath);
+        sceneMeshes[i] = resources->FindMesh(libraryPath);
+
+        if (sceneMeshes[i] == nullptr && pathJobs.find(libraryPath) == pathJobs.end())
+        {
+            pathJobs.emplace(libraryPath, (int)import->jobMeshes.size());
+            import->jobMeshes.push_back(i);
+        }
+    }
+
+    // The hierarchy is created now with the meshes that aren't loaded empty, and the textures for later
+    std::shared_ptr<GameObject> rootObject = InstantiatePrefab(prefab, sceneMeshes, import->path.c_str(), import->sourceKey, &import->pendingMaterials);
+
+    if (rootObject != nullptr) placeholder->AddChild(rootObject);
+    if (prefab.hasBounds) ApplyModelScale(placeholder, prefab.minBounds, prefab.maxBounds, 5.0f);
+
+    const size_t jobCount = import->jobMeshes.size();
+    import->jobData.resize(jobCount);
+    import->jobReady.reset(new std::atomic<bool>[jobCount]());
+    import->jobUploaded.assign(jobCount, false);
+    import->jobTargets.resize(jobCount);
+    CollectMeshTargets(placeholder, pathJobs, *import);
+
+    import->state = FBXImport::State::PROCESSING_MESHES;
+    import->runningJobs.fetch_add((uint32_t)jobCount);
+
+    // Same CPU work as ImportSceneMeshes, but each mesh is uploaded on the first frame after its job ends
+    for (size_t j = 0; j < jobCount; ++j)
+    {
+        JobSystem::GetInstance().Submit([this, import, j]()
             {
-                LOG("  - Texture: NONE (will use default checkers)");
-            }
+                if (!import->cancelled)
+                {
+                    unsigned int meshIndex = import->jobMeshes[j];
+                    aiMesh* mesh = (import->scene != nullptr) ? import->scene->mMeshes[meshIndex] : nullptr;
+                    ProcessMesh(mesh, GetMeshLibraryPath(import->sourceKey, meshIndex), import->jobData[j]);
+                }
+
+                import->processedMeshes.fetch_add(1);
+                import->jobReady[j].store(true, std::memory_order_release);
+                import->runningJobs.fetch_sub(1, std::memory_order_release);
+            });
+    }
+}
+
+void LoadFiles::UploadImportMeshes(FBXImport& import, std::chrono::high_resolution_clock::time_point deadline)
+{
+    ModuleResources* resources = Application::GetInstance().resources.get();
+    int uploaded = 0;
+
+    for (size_t j = 0; j < import.jobMeshes.size(); ++j)
+    {
+        if (import.jobUploaded[j] || !import.jobReady[j].load(std::memory_order_acquire)) continue;
 
-            LOG("Children: %d", (int)newObject->GetChildren().size());
-            LOG("========================================");
+        // At least one per frame, so the import advances even if the budget is too small
+        if (uploaded > 0 && std::chrono::high_resolution_clock::now() >= deadline) break;
 
-            //Application::GetInstance().render->FocusOnGameObject(newObject.get());
+        MeshData& meshData = import.jobData[j];
+        std::shared_ptr<ResourceMesh> resource;
+        if (meshData.view.vertexCount > 0) resource = resources->LoadMesh(meshData.libraryPath, meshData.view);
+        MeshFile::ReleaseStreams(meshData);
+        meshData = MeshData();
+
+        for (const auto& target : import.jobTargets[j])
+        {
+            std::shared_ptr<GameObject> gameObject = target.lock();
+            ComponentMesh* mesh = (gameObject != nullptr) ? gameObject->GetComponent<ComponentMesh>() : nullptr;
+            if (mesh != nullptr && mesh->resource == nullptr) mesh->SetResource(resource);
         }
+
+        import.jobUploaded[j] = true;
+        ++import.uploadedMeshes;
+        ++uploaded;
     }
-    else if (extension == "dds" || extension == "png" || extension == "jpg" || extension == "jpeg")
+}
+
+bool LoadFiles::LoadImportTextures(FBXImport& import, std::chrono::high_resolution_clock::time_point deadline)
+{
+    int loaded = 0;
+
+    while (import.loadedMaterials < import.pendingMaterials.size())
     {
-        LOG("Detected texture file (%s), loading...", extension.c_str());
+        if (loaded > 0 && std::chrono::high_resolution_clock::now() >= deadline) return false;
 
-        GameObject* selected = Application::GetInstance().editor->GetSelectedGameObject();
+        const FBXImport::PendingMaterial& material = import.pendingMaterials[import.loadedMaterials++];
+        std::shared_ptr<GameObject> gameObject = material.gameObject.lock();
+        if (gameObject != nullptr) ApplyMaterialTexture(gameObject, material.texturePath);
+        ++loaded;
+    }
 
-        if (selected != nullptr)
+    return true;
+}
+
+void LoadFiles::ReleaseImport(FBXImport& import)
+{
+    for (MeshData& meshData : import.jobData)
+    {
+        MeshFile::ReleaseStreams(meshData);
+    }
+    import.jobData.clear();
+
+    if (import.scene != nullptr)
+    {
+        aiReleaseImport(import.scene);
+        import.scene = nullptr;
+    }
+}
+
+void LoadFiles::BuildPrefab(const aiScene* scene, const std::string& fbxDirectory, const std::string& name, Prefab& prefab)
+{
+    prefab = Prefab();
+    prefab.meshCount = scene->mNumMeshes;
+
+    // Each mesh is reduced once, the instances of the nodes only transform its box
+    std::vector<AABB> meshBounds(scene->mNumMeshes);
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+    {
+        meshBounds[i] = VertexFormat::ComputeBounds(&scene->mMeshes[i]->mVertices[0].x, scene->mMeshes[i]->mNumVertices);
+    }
+
+    // A single mesh becomes one object without the node transforms, so its own local box is the one it ends with
+    AABB bounds;
+    if (scene->mNumMeshes == 1)
+        bounds = meshBounds[0];
+    else
+        CalculateSceneBounds(scene->mRootNode, meshBounds, glm::mat4(1.0f), bounds);
+
+    prefab.hasBounds = bounds.IsValid();
+    prefab.minBounds = bounds.min;
+    prefab.maxBounds = bounds.max;
+
+    if (scene->mNumMeshes == 1)
+    {
+        // One mesh is one object, without the nodes
+        PrefabNode node;
+        node.name = name;
+        node.meshIndex = 0;
+        node.texturePath = FindMaterialTexture(scene, scene->mMeshes[0], fbxDirectory);
+        prefab.nodes.push_back(node);
+        return;
+    }
+
+    BuildPrefabNodes(scene->mRootNode, scene, fbxDirectory, -1, glm::mat4(1.0f), prefab);
+    if (!prefab.nodes.empty()) prefab.nodes[0].name = name;
+}
+
+void LoadFiles::BuildPrefabNodes(const aiNode* node, const aiScene* scene, const std::string& fbxDirectory, int parent, glm::mat4 accumulatedTransform, Prefab& prefab)
+{
+    // Convert the transformation of the current node to GLM
+    glm::mat4 nodeTransform = ToGlmMatrix(node->mTransformation);
+
+    // Accumulate the transformation,matrix of the parent * matrix of this node
+    glm::mat4 localTransform = accumulatedTransform * nodeTransform;
+
+    // DETECT IF IT IS AN ASSIMP TRASH NODE $AssimpFbx$, the root is always kept so the prefab has one
+    std::string nodeName = node->mName.C_Str();
+    if (parent >= 0 && nodeName.find("$AssimpFbx$") != std::string::npos)
+    {
+        // Its a dummy node, skipped visually, dont create a node but process childrens giving the transformation accumulated so they dont lose the positiona and rotation
+        for (unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            LoadTexture(file_path, selected);
+            BuildPrefabNodes(node->mChildren[i], scene, fbxDirectory, parent, localTransform, prefab);
         }
-        else
+        return;
+    }
+
+    // Its a normal node so we create a GameObject for it
+    const int index = (int)prefab.nodes.size();
+    prefab.nodes.emplace_back();
+    prefab.nodes[index].name = nodeName;
+    prefab.nodes[index].parent = parent;
+
+    // Decompose the accumulated matrix to apply it to the transform
+    glm::vec3 position, scale, skew;
+    glm::quat rotation;
+    glm::vec4 perspective;
+
+    if (glm::decompose(localTransform, scale, rotation, position, skew, perspective))
+    {
+        prefab.nodes[index].position = position;
+        prefab.nodes[index].rotation = rotation;
+        prefab.nodes[index].scale = scale;
+    }
+    else
+    {
+        LOG("Failed to decompose transformation matrix for node: %s", node->mName.C_Str());
+    }
+
+    // Process Mesh
+    for (unsigned int i = 0; i < node->mNumMeshes; i++)
+    {
+        int meshNode = index;
+        if (node->mNumMeshes > 1)
         {
-            LOG("WARNING: No GameObject selected. Please select an object in the Hierarchy to apply the texture.");
+            // More than one mesh on the node, each one on a child
+            meshNode = (int)prefab.nodes.size();
+            prefab.nodes.emplace_back();
+            prefab.nodes[meshNode].name = nodeName + "_SubMesh_" + std::to_string(i);
+            prefab.nodes[meshNode].parent = index;
         }
+
+        prefab.nodes[meshNode].meshIndex = (int)node->mMeshes[i];
+        prefab.nodes[meshNode].texturePath = FindMaterialTexture(scene, scene->mMeshes[node->mMeshes[i]], fbxDirectory);
+    }
+
+    // Process all the childrens
+    for (unsigned int i = 0; i < node->mNumChildren; i++)
+    {
+        // As a real node is created, needs to reset the accumulation for the childrens because the local transformation will already be relative to it
+        BuildPrefabNodes(node->mChildren[i], scene, fbxDirectory, index, glm::mat4(1.0f), prefab);
     }
 }
 
-std::shared_ptr<GameObject> LoadFiles::LoadFBX(const char* file_path)
+std::shared_ptr<GameObject> LoadFiles::InstantiatePrefab(const Prefab& prefab, const std::vector<std::shared_ptr<ResourceMesh>>& sceneMeshes, const char* assetPath, const std::string& sourceKey, std::vector<FBXImport::PendingMaterial>* pendingMaterials)
 {
-    const aiScene* scene = aiImportFile(file_path,
-        aiProcess_Triangulate |
-        aiProcess_FlipUVs |
-        aiProcess_GenNormals |
-        aiProcess_JoinIdenticalVertices |
-        aiProcess_CalcTangentSpace);
+    std::vector<std::shared_ptr<GameObject>> gameObjects(prefab.nodes.size());
 
-    if (scene == nullptr || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    for (size_t i = 0; i < prefab.nodes.size(); ++i)
     {
-        const char* error = aiGetErrorString();
-        LOG("Error loading FBX %s: %s", file_path, error);
-        return nullptr;
+        const PrefabNode& node = prefab.nodes[i];
+
+        std::shared_ptr<GameObject> gameObject = std::make_shared<GameObject>(node.name);
+        auto transform = std::make_shared<ComponentTransform>(gameObject.get());
+        transform->SetPosition(node.position);
+        transform->SetRotation(node.rotation);
+        transform->SetScale(node.scale);
+        gameObject->AddComponent(transform);
+
+        if (node.parent >= 0) gameObjects[node.parent]->AddChild(gameObject);
+        gameObjects[i] = gameObject;
+
+        if (node.meshIndex >= 0)
+        {
+            // On the async imports the resource is still null, it's set when the mesh is uploaded
+            auto compMesh = std::make_shared<ComponentMesh>(gameObject.get());
+            compMesh->path = assetPath;
+            compMesh->libraryPath = GetMeshLibraryPath(sourceKey, node.meshIndex);
+            compMesh->SetResource(sceneMeshes[node.meshIndex]);
+            gameObject->AddComponent(compMesh);
+        }
+
+        if (node.texturePath.empty()) continue;
+
+        if (pendingMaterials != nullptr)
+        {
+            pendingMaterials->push_back({ gameObject, node.texturePath });
+        }
+        else
+        {
+            ApplyMaterialTexture(gameObject, node.texturePath);
+        }
     }
 
-    LOG("Successfully loaded FBX: %s", file_path);
-    LOG("Number of meshes: %d", scene->mNumMeshes);
-    LOG("Number of materials: %d", scene->mNumMaterials);
+    return gameObjects.empty() ? nullptr : gameObjects[0];
+}
 
-    // Get FBX directory for relative textures
-    std::string fbxPath(file_path);
-    size_t lastSlash = fbxPath.find_last_of("/\\");
-    std::string fbxDirectory = (lastSlash != std::string::npos) ? fbxPath.substr(0, lastSlash + 1) : "";
+bool LoadFiles::SavePrefab(const char* path, const Prefab& prefab)
+{
+    std::vector<PrefabFileNode> nodes(prefab.nodes.size());
+    std::string strings;
+
+    for (size_t i = 0; i < prefab.nodes.size(); ++i)
+    {
+        const PrefabNode& node = prefab.nodes[i];
+        PrefabFileNode& fileNode = nodes[i];
+
+        fileNode.parent = node.parent;
+        fileNode.meshIndex = node.meshIndex;
+        fileNode.nameOffset = (uint32_t)strings.size();
+        fileNode.nameSize = (uint32_t)node.name.size();
+        strings += node.name;
+        fileNode.textureOffset = (uint32_t)strings.size();
+        fileNode.textureSize = (uint32_t)node.texturePath.size();
+        strings += node.texturePath;
+
+        memcpy(fileNode.position, &node.position.x, sizeof(fileNode.position));
+        fileNode.rotation[0] = node.rotation.x;
+        fileNode.rotation[1] = node.rotation.y;
+        fileNode.rotation[2] = node.rotation.z;
+        fileNode.rotation[3] = node.rotation.w;
+        memcpy(fileNode.scale, &node.scale.x, sizeof(fileNode.scale));
+    }
 
-    // Get file name
-    std::string fileName = (lastSlash != std::string::npos) ? fbxPath.substr(lastSlash + 1) : fbxPath;
-    size_t lastDot = fileName.find_last_of(".");
-    if (lastDot != std::string::npos)
-        fileName = fileName.substr(0, lastDot);
+    PrefabFileHeader header;
+    header.nodeCount = (uint32_t)nodes.size();
+    header.meshCount = prefab.meshCount;
+    header.hasBounds = prefab.hasBounds ? 1 : 0;
+    memcpy(header.minBounds, &prefab.minBounds.x, sizeof(header.minBounds));
+    memcpy(header.maxBounds, &prefab.maxBounds.x, sizeof(header.maxBounds));
+    header.stringBytes = (uint32_t)strings.size();
 
-    std::shared_ptr<GameObject> rootObject = nullptr;
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)nodes.data(), nodes.size() * sizeof(PrefabFileNode));
+    file.write(strings.data(), strings.size());
 
-    if (scene->mNumMeshes == 1)
+    if (!file)
     {
-        MeshData meshData;
-        ProcessMesh(scene->mMeshes[0], meshData);
-        rootObject = CreateGameObjectFromMesh(meshData, fileName.c_str(), file_path);
+        LOG("Error saving prefab: %s", path);
+        return false;
+    }
+
+    LOG("Prefab saved to Library: %s (%d nodes)", path, (int)nodes.size());
+    return true;
+}
 
-        
-        LoadMaterialTextures(scene, scene->mMeshes[0], rootObject, fbxDirectory);
+bool LoadFiles::LoadPrefab(const char* path, const std::string& sourceKey, Prefab& prefab)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
 
-        // Release temporary data
-        delete[] meshData.vertices;
-        delete[] meshData.indices;
-        if (meshData.texCoords) delete[] meshData.texCoords;
-        if (meshData.normals) delete[] meshData.normals;
-        if (meshData.colors) delete[] meshData.colors;
+    PrefabFileHeader header;
+    file.read((char*)&header, sizeof(header));
+    if (!file || header.magic != PREFAB_FILE_MAGIC || header.version != PREFAB_FILE_VERSION)
+    {
+        LOG("Error: Invalid prefab file: %s", path);
+        return false;
     }
-    else
+
+    std::vector<PrefabFileNode> nodes(header.nodeCount);
+    std::string strings(header.stringBytes, '\0');
+    file.read((char*)nodes.data(), nodes.size() * sizeof(PrefabFileNode));
+    file.read(&strings[0], strings.size());
+    if (!file)
     {
-        rootObject = ProcessNode(scene->mRootNode, scene, nullptr, fbxDirectory, file_path, glm::mat4(1.0f));
-        if (rootObject)
-            rootObject->name = fileName;
+        LOG("Error: Truncated prefab file: %s", path);
+        return false;
     }
 
-    aiReleaseImport(scene);
+    prefab = Prefab();
+    prefab.meshCount = header.meshCount;
+    prefab.hasBounds = header.hasBounds != 0;
+    prefab.minBounds = glm::vec3(header.minBounds[0], header.minBounds[1], header.minBounds[2]);
+    prefab.maxBounds = glm::vec3(header.maxBounds[0], header.maxBounds[1], header.maxBounds[2]);
+    prefab.nodes.resize(nodes.size());
 
-    if (rootObject != nullptr)
+    for (size_t i = 0; i < nodes.size(); ++i)
     {
-        NormalizeModelScale(rootObject, 5.0f);
+        const PrefabFileNode& fileNode = nodes[i];
+        PrefabNode& node = prefab.nodes[i];
 
-        LOG("=== FBX LOADED SUCCESSFULLY ===");
-        LOG("GameObject name: %s", rootObject->name.c_str());
-        LOG("Has Transform: %s", rootObject->GetComponent<ComponentTransform>() ? "YES" : "NO");
-        LOG("Has Mesh: %s", rootObject->GetComponent<ComponentMesh>() ? "YES" : "NO");
-        LOG("Has Texture: %s", rootObject->GetComponent<ComponentTexture>() ? "YES" : "NO");
-        LOG("Number of children: %d", (int)rootObject->GetChildren().size());
+        // Parents before their children and everything inside the file, so the instantiation doesn't need more checks
+        if (fileNode.parent >= (int32_t)i || (i > 0 && fileNode.parent < 0) || fileNode.meshIndex >= (int32_t)header.meshCount ||
+            fileNode.nameOffset > strings.size() || fileNode.nameSize > strings.size() - fileNode.nameOffset ||
+            fileNode.textureOffset > strings.size() || fileNode.textureSize > strings.size() - fileNode.textureOffset)
+        {
+            LOG("Error: Invalid prefab file: %s", path);
+            return false;
+        }
 
-        // Verify that the mesh has data
-        ComponentMesh* mesh = rootObject->GetComponent<ComponentMesh>();
-        if (mesh)
+        node.parent = fileNode.parent;
+        node.meshIndex = fileNode.meshIndex;
+        node.name = strings.substr(fileNode.nameOffset, fileNode.nameSize);
+        node.texturePath = strings.substr(fileNode.textureOffset, fileNode.textureSize);
+        node.position = glm::vec3(fileNode.position[0], fileNode.position[1], fileNode.position[2]);
+        node.rotation = glm::quat(fileNode.rotation[3], fileNode.rotation[0], fileNode.rotation[1], fileNode.rotation[2]);
+        node.scale = glm::vec3(fileNode.scale[0], fileNode.scale[1], fileNode.scale[2]);
+    }
+
+    // Without the FBX a missing mesh can't be created again
+    for (uint32_t i = 0; i < prefab.meshCount; ++i)
+    {
+        if (!std::filesystem::exists(GetMeshLibraryPath(sourceKey, i)))
         {
-            LOG("Mesh VAO: %d, VBO: %d, IBO: %d, IndexCount: %d",
-                mesh->VAO, mesh->VBO, mesh->IBO, mesh->indexCount);
+            LOG("Prefab mesh missing from Library, importing the FBX again: %s", GetMeshLibraryPath(sourceKey, i).c_str());
+            return false;
         }
     }
 
-    return rootObject;
+    return true;
 }
 
-std::shared_ptr<GameObject> LoadFiles::ProcessNode(aiNode* node, const aiScene* scene, std::shared_ptr<GameObject> parent, const std::string& fbxDirectory, const char* assetPath, glm::mat4 accumulatedTransform)
+std::string LoadFiles::GetMeshLibraryPath(const std::string& sourceKey, unsigned int meshIndex)
 {
-    // Convert the transformation of the current node to GLM
-    aiMatrix4x4 transformMatrix = node->mTransformation;
-    glm::mat4 nodeTransform;
-    // Assimp is Row-Major, GLM is Column-Major -> Transpose
-    nodeTransform[0][0] = transformMatrix.a1; nodeTransform[0][1] = transformMatrix.b1; nodeTransform[0][2] = transformMatrix.c1; nodeTransform[0][3] = transformMatrix.d1;
-    nodeTransform[1][0] = transformMatrix.a2; nodeTransform[1][1] = transformMatrix.b2; nodeTransform[1][2] = transformMatrix.c2; nodeTransform[1][3] = transformMatrix.d2;
-    nodeTransform[2][0] = transformMatrix.a3; nodeTransform[2][1] = transformMatrix.b3; nodeTransform[2][2] = transformMatrix.c3; nodeTransform[2][3] = transformMatrix.d3;
-    nodeTransform[3][0] = transformMatrix.a4; nodeTransform[3][1] = transformMatrix.b4; nodeTransform[3][2] = transformMatrix.c4; nodeTransform[3][3] = transformMatrix.d4;
+    // The index in the scene is stable while the key is the same, the names of the meshes can repeat
+    return "Library/Meshes/" + sourceKey + "_" + std::to_string(meshIndex) + ".rgs";
+}
 
-    // Accumulate the transformation,matrix of the parent * matrix of this node
-    glm::mat4 localTransform = accumulatedTransform * nodeTransform;
+std::string LoadFiles::GetPrefabLibraryPath(const std::string& sourceKey)
+{
+    return "Library/Prefabs/" + sourceKey + ".rgsp";
+}
 
-    // DETECT IF IT IS AN ASSIMP TRASH NODE $AssimpFbx$
-    std::string nodeName = node->mName.C_Str();
-    if (nodeName.find("$AssimpFbx$") != std::string::npos)
+std::shared_ptr<ResourceMesh> LoadFiles::ImportMesh(aiMesh* aiMesh, const std::string& libraryPath)
+{
+    // If the mesh is already on the GPU the file is not read again
+    std::shared_ptr<ResourceMesh> resource = Application::GetInstance().resources->FindMesh(libraryPath);
+    if (resource != nullptr)
     {
-        // Its a dummy node, skipped visually, dont create GameObject but process childrens giving the transformation accumulated so they dont lose the positiona and rotation
-        for (unsigned int i = 0; i < node->mNumChildren; i++)
-        {
-            // Pass the information
-            ProcessNode(node->mChildren[i], scene, parent, fbxDirectory, assetPath, localTransform);
-        }
-        // Dont return anything because this node does not exist in our hierarchy
-        return nullptr;
+        LOG("Resources: Mesh already loaded, sharing it: %s", libraryPath.c_str());
+        return resource;
     }
 
-    // Its a normal node so we create a GameObject
-    std::shared_ptr<GameObject> gameObject = std::make_shared<GameObject>(nodeName);
-    auto transform = std::make_shared<ComponentTransform>(gameObject.get());
+    MeshData meshData;
+    ProcessMesh(aiMesh, libraryPath, meshData);
 
-    // Decompose the accumulated matrix to apply it to the transform
-    glm::vec3 position, scale, skew;
-    glm::quat rotation;
-    glm::vec4 perspective;
+    resource = Application::GetInstance().resources->LoadMesh(meshData.libraryPath, meshData.view);
 
-    // Break down the local matrix of the node
-    if (glm::decompose(localTransform, scale, rotation, position, skew, perspective))
-    {
-        transform->SetPosition(position);
-        transform->SetRotation(rotation);
-        transform->SetScale(scale);
-    }
-    else
-    {
-        LOG("Failed to decompose transformation matrix for node: %s", node->mName.C_Str());
-        transform->SetPosition(glm::vec3(0, 0, 0));
-        transform->SetRotation(glm::quat(1, 0, 0, 0));
-        transform->SetScale(glm::vec3(1, 1, 1));
-    }
+    // Release temporary data, the resource has its own copy and the mapped file is closed with meshData
+    MeshFile::ReleaseStreams(meshData);
 
-    gameObject->AddComponent(transform);
+    return resource;
+}
+
+std::vector<std::shared_ptr<ResourceMesh>> LoadFiles::ImportSceneMeshes(const aiScene* scene, unsigned int meshCount, const char* sourcePath, const std::string& sourceKey)
+{
+    ModuleResources* resources = Application::GetInstance().resources.get();
+    std::vector<std::shared_ptr<ResourceMesh>> sceneMeshes(meshCount);
+
+    // One job per mesh that isn't on the GPU yet, the same FBX loaded again shares all of them
+    std::vector<unsigned int> jobMeshes;
+    std::vector<int> meshJob(meshCount, -1);
 
-    // Add the parent, if exists
-    if (parent)
+    for (unsigned int i = 0; i < meshCount; ++i)
     {
-        parent->AddChild(gameObject);
+        std::string libraryPath = GetMeshLibraryPath(sourceKey, i);
+        assetDatabase.AddArtifact(sourcePath, libraryPath);
+
+        sceneMeshes[i] = resources->FindMesh(libraryPath);
+        if (sceneMeshes[i] != nullptr) continue;
+
+        meshJob[i] = (int)jobMeshes.size();
+        jobMeshes.push_back(i);
     }
 
-    // Process Mesh
-    for (unsigned int i = 0; i < node->mNumMeshes; i++)
-    {
-        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        MeshData meshData;
-        ProcessMesh(mesh, meshData);
+    if (jobMeshes.empty()) return sceneMeshes;
 
-        std::shared_ptr<GameObject> meshObject;
+    auto startTime = std::chrono::high_resolution_clock::now();
 
-        if (node->mNumMeshes == 1)
-        {
-            // If 1 node = 1 mesh, use the same object
-            meshObject = gameObject;
-        }
-        else
+    std::vector<MeshData> jobData(jobMeshes.size());
+    JobSystem::GetInstance().ParallelFor((uint32_t)jobMeshes.size(), 1, [this, scene, &sourceKey, &jobMeshes, &jobData](uint32_t begin, uint32_t end)
         {
-            std::string meshName = nodeName + "_SubMesh_" + std::to_string(i);
-            meshObject = std::make_shared<GameObject>(meshName);
-            auto meshTransform = std::make_shared<ComponentTransform>(meshObject.get());
-            meshObject->AddComponent(meshTransform);
-            gameObject->AddChild(meshObject);
-        }
-
-        auto compMesh = std::make_shared<ComponentMesh>(meshObject.get());
-        compMesh->path = assetPath;
-        compMesh->libraryPath = meshData.libraryPath;
-        compMesh->LoadMesh(meshData.vertices, meshData.num_vertices,
-            meshData.indices, meshData.num_indices,
-            meshData.texCoords, meshData.normals);
-        meshObject->AddComponent(compMesh);
+            for (uint32_t j = begin; j < end; ++j)
+            {
+                aiMesh* mesh = (scene != nullptr) ? scene->mMeshes[jobMeshes[j]] : nullptr;
+                ProcessMesh(mesh, GetMeshLibraryPath(sourceKey, jobMeshes[j]), jobData[j]);
+            }
+        });
 
-        LoadMaterialTextures(scene, mesh, meshObject, fbxDirectory);
+    auto processTime = std::chrono::high_resolution_clock::now();
 
-        // CleanUP
-        delete[] meshData.vertices;
-        delete[] meshData.indices;
-        if (meshData.texCoords) delete[] meshData.texCoords;
-        if (meshData.normals) delete[] meshData.normals;
-        if (meshData.colors) delete[] meshData.colors;
+    // The GL buffers can only be created on the main thread
+    std::vector<std::shared_ptr<ResourceMesh>> jobResources(jobMeshes.size());
+    for (size_t j = 0; j < jobData.size(); ++j)
+    {
+        if (jobData[j].view.vertexCount > 0) jobResources[j] = resources->LoadMesh(jobData[j].libraryPath, jobData[j].view);
+        MeshFile::ReleaseStreams(jobData[j]);
+        jobData[j] = MeshData();
     }
 
-    // Process all the childrens
-    for (unsigned int i = 0; i < node->mNumChildren; i++)
+    for (unsigned int i = 0; i < meshCount; ++i)
     {
-        // As a real node is created, needs to reset the accumulation for the childrens because the local transformation will already be relative to the GameObject
-        ProcessNode(node->mChildren[i], scene, gameObject, fbxDirectory, assetPath, glm::mat4(1.0f));
+        if (meshJob[i] >= 0) sceneMeshes[i] = jobResources[meshJob[i]];
     }
 
-    return gameObject;
+    auto endTime = std::chrono::high_resolution_clock::now();
+    LOG("Resources: %d meshes processed on %d threads in %.2f ms, uploaded in %.2f ms", (int)jobMeshes.size(),
+        (int)JobSystem::GetInstance().GetWorkerCount() + 1,
+        std::chrono::duration<float, std::milli>(processTime - startTime).count(),
+        std::chrono::duration<float, std::milli>(endTime - processTime).count());
+
+    return sceneMeshes;
 }
 
-void LoadFiles::ProcessMesh(aiMesh* aiMesh, MeshData& meshData)
+void LoadFiles::ProcessMesh(aiMesh* aiMesh, const std::string& libraryPath, MeshData& meshData)
 {
-    // Generate file name in library
-    std::string meshName = aiMesh->mName.C_Str();
-    if (meshName.empty()) meshName = "generated_mesh_" + std::to_string(aiMesh->mNumVertices);
-
-    std::string libraryPath = "Library/Meshes/" + meshName + ".rgs";
-
     meshData.libraryPath = libraryPath;
 
     // Check if the file exists, if exists, load the file and skip assimp
@@ -424,6 +1133,17 @@ void LoadFiles::ProcessMesh(aiMesh* aiMesh, MeshData& meshData)
             LOG("Resources: Loaded mesh from Library (FAST): %s", libraryPath.c_str());
             return;
         }
+        // Broken file, discard what was read and import it again
+        MeshFile::ReleaseStreams(meshData);
+        meshData = MeshData();
+        meshData.libraryPath = libraryPath;
+    }
+
+    // Loaded from a prefab, without the FBX there is nothing else to try
+    if (aiMesh == nullptr)
+    {
+        LOG("Error: Mesh can't be read from Library and the FBX is not loaded: %s", libraryPath.c_str());
+        return;
     }
 
     // If not, the file didnt exist on Library, so slow version with assimp
@@ -463,121 +1183,115 @@ void LoadFiles::ProcessMesh(aiMesh* aiMesh, MeshData& meshData)
         }
     }
 
-    SaveMeshToCustomFormat(libraryPath.c_str(), meshData);
+    std::vector<Meshlet> meshlets = OptimizeMeshOrder(meshData);
+
+    meshData.packed = VertexFormat::Pack(meshData.vertices, meshData.num_vertices, meshData.indices, meshData.num_indices,
+        meshData.texCoords, meshData.normals, ResourceMesh::quantizePositions);
+    meshData.packed.meshlets = std::move(meshlets);
+    BuildMeshLods(meshData);
+    meshData.view = meshData.packed.GetView();
+
+    MeshFile::Save(libraryPath.c_str(), meshData);
     LOG("Resources: Saved mesh to Library: %s", libraryPath.c_str());
 }
 
-std::shared_ptr<GameObject> LoadFiles::CreateGameObjectFromMesh(const MeshData& meshData, const char* name, const char* assetPath)
+std::string LoadFiles::FindMaterialTexture(const aiScene* scene, const aiMesh* mesh, const std::string& fbxDirectory)
 {
-    auto gameObject = std::make_shared<GameObject>(name);
-
-    auto transform = std::make_shared<ComponentTransform>(gameObject.get());
-    gameObject->AddComponent(transform);
+    if (mesh->mMaterialIndex >= scene->mNumMaterials)
+    {
+        LOG("Mesh has no material assigned");
+        return std::string();
+    }
 
-    auto compMesh = std::make_shared<ComponentMesh>(gameObject.get());
-    compMesh->path = assetPath;
-    compMesh->libraryPath = meshData.libraryPath;
-    compMesh->LoadMesh(meshData.vertices, meshData.num_vertices,
-        meshData.indices, meshData.num_indices,
-        meshData.texCoords, meshData.normals);
-    gameObject->AddComponent(compMesh);
+    aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
 
-    return gameObject;
-}
+    LOG("=== MATERIAL INFO ===");
+    LOG("Material index: %d", mesh->mMaterialIndex);
 
-void LoadFiles::LoadMaterialTextures(const aiScene* scene, aiMesh* mesh, std::shared_ptr<GameObject> gameObject, const std::string& fbxDirectory)
-{
-    if (mesh->mMaterialIndex >= 0)
+    // Material information
+    aiString materialName;
+    if (material->Get(AI_MATKEY_NAME, materialName) == AI_SUCCESS)
     {
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-
-        LOG("=== MATERIAL INFO ===");
-        LOG("Material index: %d", mesh->mMaterialIndex);
+        LOG("Material name: %s", materialName.C_Str());
+    }
 
-        // Material information
-        aiString materialName;
-        if (material->Get(AI_MATKEY_NAME, materialName) == AI_SUCCESS)
-        {
-            LOG("Material name: %s", materialName.C_Str());
-        }
+    // Count textures of each type
+    int diffuseCount = material->GetTextureCount(aiTextureType_DIFFUSE);
+    int specularCount = material->GetTextureCount(aiTextureType_SPECULAR);
+    int normalCount = material->GetTextureCount(aiTextureType_NORMALS);
 
-        // Count textures of each type
-        int diffuseCount = material->GetTextureCount(aiTextureType_DIFFUSE);
-        int specularCount = material->GetTextureCount(aiTextureType_SPECULAR);
-        int normalCount = material->GetTextureCount(aiTextureType_NORMALS);
+    LOG("Texture counts - Diffuse: %d, Specular: %d, Normal: %d",
+        diffuseCount, specularCount, normalCount);
 
-        LOG("Texture counts - Diffuse: %d, Specular: %d, Normal: %d",
-            diffuseCount, specularCount, normalCount);
+    // Search for diffuse texture
+    if (diffuseCount == 0)
+    {
+        LOG("Material has NO diffuse texture");
+        return std::string();
+    }
 
-        // Search for diffuse texture
-        if (diffuseCount > 0)
-        {
-            aiString texturePath;
-            if (material->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath) == AI_SUCCESS)
-            {
-                std::string textureFile(texturePath.C_Str());
-                LOG("Texture path from FBX: '%s'", textureFile.c_str());
+    aiString texturePath;
+    if (material->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath) != AI_SUCCESS)
+    {
+        LOG("Failed to get texture path from material");
+        return std::string();
+    }
 
-                // Clean path
-                if (textureFile.find("./") == 0)
-                    textureFile = textureFile.substr(2);
+    std::string textureFile(texturePath.C_Str());
+    LOG("Texture path from FBX: '%s'", textureFile.c_str());
 
-                std::replace(textureFile.begin(), textureFile.end(), '\\', '/');
+    // Clean path
+    if (textureFile.find("./") == 0)
+        textureFile = textureFile.substr(2);
 
-                // Try multiple routes
-                std::vector<std::string> possiblePaths;
-                possiblePaths.push_back(fbxDirectory + textureFile); // Relative
-                possiblePaths.push_back(textureFile); // Absolute
+    std::replace(textureFile.begin(), textureFile.end(), '\\', '/');
 
-                // Extract the file name
-                size_t lastSlash = textureFile.find_last_of("/\\");
-                if (lastSlash != std::string::npos)
-                {
-                    std::string fileName = textureFile.substr(lastSlash + 1);
-                    possiblePaths.push_back(fbxDirectory + fileName);
-                }
+    // Try multiple routes
+    std::vector<std::string> possiblePaths;
+    possiblePaths.push_back(fbxDirectory + textureFile); // Relative
+    possiblePaths.push_back(textureFile); // Absolute
 
-                unsigned int textureID = 0;
-                std::string loadedPath;
+    // Extract the file name
+    size_t lastSlash = textureFile.find_last_of("/\\");
+    if (lastSlash != std::string::npos)
+    {
+        std::string fileName = textureFile.substr(lastSlash + 1);
+        possiblePaths.push_back(fbxDirectory + fileName);
+    }
 
-                LOG("Trying to load texture from possible paths:");
-                for (const auto& path : possiblePaths)
-                {
-                    LOG("  - Trying: %s", path.c_str());
-                    textureID = LoadTexture(path.c_str());
-                    if (textureID != 0)
-                    {
-                        loadedPath = path;
-                        LOG("SUCCESS!");
-                        break;
-                    }
-                }
+    LOG("Trying to find texture on possible paths:");
+    for (const auto& path : possiblePaths)
+    {
+        LOG("  - Trying: %s", path.c_str());
+        if (std::filesystem::exists(path))
+        {
+            LOG("SUCCESS!");
+            return path;
+        }
+    }
 
-                if (textureID != 0)
-                {
-                    auto texComponent = std::make_shared<ComponentTexture>(gameObject.get());
-                    texComponent->textureID = textureID;
-                    texComponent->path = loadedPath;
+    LOG("TEXTURE NOT FOUND - Will use default checkers");
+    return std::string();
+}
 
-                    std::string pathString(loadedPath);
-                    std::string filename = pathString.substr(pathString.find_last_of("/\\") + 1);
-                    size_t lastDot = filename.find_last_of(".");
-                    if (lastDot != std::string::npos) filename = filename.substr(0, lastDot);
+void LoadFiles::ApplyMaterialTexture(std::shared_ptr<GameObject> gameObject, const std::string& texturePath)
+{
+    std::shared_ptr<ResourceTexture> texture = LoadTexture(texturePath.c_str());
+    if (texture == nullptr)
+    {
+        LOG("FAILED TO LOAD TEXTURE - Will use default checkers: %s", texturePath.c_str());
+        return;
+    }
 
-                    texComponent->libraryPath = "Library/Textures/" + filename + ".rgst";
+    auto texComponent = std::make_shared<ComponentTexture>(gameObject.get());
+    texComponent->SetResource(texture);
+    texComponent->path = texturePath;
+    texComponent->libraryPath = texture->libraryPath;
 
-                    gameObject->AddComponent(texComponent);
+    gameObject->AddComponent(texComponent);
 
-                    LOG("TEXTURE LOADED AND APPLIED: %s (OpenGL ID: %d)",
-                        loadedPath.c_str(), textureID);
-                }
-                else{ LOG("FAILED TO LOAD TEXTURE - Will use default checkers"); }
-            }
-            else{ LOG("Failed to get texture path from material"); }
-        }
-        else{ LOG("Material has NO diffuse texture"); }
-    }
-    else{ LOG("Mesh has no material assigned"); }
+    LOG("TEXTURE LOADED AND APPLIED: %s (OpenGL ID: %d)",
+        texturePath.c_str(), texture->textureID);
 }
 
 bool LoadFiles::LoadTexture(const char* file_path, GameObject* target)
@@ -590,21 +1304,16 @@ bool LoadFiles::LoadTexture(const char* file_path, GameObject* target)
         return false;
     }
 
-    std::string pathString(file_path);
-    std::string filename = pathString.substr(pathString.find_last_of("/\\") + 1);
-    size_t lastDot = filename.find_last_of(".");
-    if (lastDot != std::string::npos) filename = filename.substr(0, lastDot);
-    std::string internalPath = "Library/Textures/" + filename + ".rgst";
-
-    unsigned int textureID = LoadTexture(file_path);
+    std::shared_ptr<ResourceTexture> texture = LoadTexture(file_path);
 
-    if (textureID == 0)
+    if (texture == nullptr)
     {
         LOG("Failed to load texture");
         return false;
     }
 
-    LOG("Texture loaded successfully (ID: %d)", textureID);
+    std::string internalPath = texture->libraryPath;
+    LOG("Texture loaded successfully (ID: %d)", texture->textureID);
 
 // Check if the Component has a Mesh to apply the texture
 if (target->GetComponent<ComponentMesh>() != nullptr)
@@ -612,8 +1321,8 @@ if (target->GetComponent<ComponentMesh>() != nullptr)
     auto textureComp = target->GetComponent<ComponentTexture>();
     if (textureComp)
     {
-        // If has a component, update the data
-        textureComp->textureID = textureID;
+        // If has a component, update the data, the previous texture is released if no one else uses it
+        textureComp->SetResource(texture);
         // Save the original path by reference, Asset
         textureComp->path = file_path;
         textureComp->libraryPath = internalPath;
@@ -625,7 +1334,7 @@ if (target->GetComponent<ComponentMesh>() != nullptr)
     {
         // If doesn't have a component, assign a new one
         auto newTex = std::make_shared<ComponentTexture>(target);
-        newTex->textureID = textureID;
+        newTex->SetResource(texture);
         newTex->path = file_path;
         newTex->libraryPath = internalPath;
         target->AddComponent(newTex);
@@ -637,7 +1346,7 @@ if (target->GetComponent<ComponentMesh>() != nullptr)
 return false;
 }
 
-void LoadFiles::ApplyTextureToAllChildren(std::shared_ptr<GameObject> go, unsigned int textureID, const char* path)
+void LoadFiles::ApplyTextureToAllChildren(std::shared_ptr<GameObject> go, std::shared_ptr<ResourceTexture> texture, const char* path)
 {
     if (go == nullptr)
         return;
@@ -649,7 +1358,7 @@ void LoadFiles::ApplyTextureToAllChildren(std::shared_ptr<GameObject> go, unsign
         auto oldTex = go->GetComponent<ComponentTexture>();
         if (oldTex)
         {
-            oldTex->textureID = textureID;
+            oldTex->SetResource(texture);
             oldTex->path = path;
             LOG("Texture updated on: %s", go->name.c_str());
         }
@@ -657,7 +1366,7 @@ void LoadFiles::ApplyTextureToAllChildren(std::shared_ptr<GameObject> go, unsign
         {
             // Create new texture
             auto newTex = std::make_shared<ComponentTexture>(go.get());
-            newTex->textureID = textureID;
+            newTex->SetResource(texture);
             newTex->path = path;
             go->AddComponent(newTex);
             LOG("Texture applied to: %s", go->name.c_str());
@@ -667,7 +1376,7 @@ void LoadFiles::ApplyTextureToAllChildren(std::shared_ptr<GameObject> go, unsign
     // Recursive to children
     for (const auto& child : go->GetChildren())
     {
-        ApplyTextureToAllChildren(child, textureID, path);
+        ApplyTextureToAllChildren(child, texture, path);
     }
 }
 
@@ -687,6 +1396,11 @@ void LoadFiles::NormalizeModelScale(std::shared_ptr<GameObject> rootObject, floa
     // If no geometry was found, return
     if (minBounds.x == std::numeric_limits<float>::max()) return;
 
+    ApplyModelScale(rootObject, minBounds, maxBounds, targetSize);
+}
+
+void LoadFiles::ApplyModelScale(std::shared_ptr<GameObject> rootObject, const glm::vec3& minBounds, const glm::vec3& maxBounds, float targetSize)
+{
     // Calculate dimensions
     glm::vec3 size = maxBounds - minBounds;
     float maxDimension = std::max({ size.x, size.y, size.z });
@@ -703,7 +1417,7 @@ void LoadFiles::NormalizeModelScale(std::shared_ptr<GameObject> rootObject, floa
         if (t != nullptr)
         {
             // We multiply the current scale by the new factor, to respect previous scales
-            glm::vec3 currentScale = t->scale;
+            glm::vec3 currentScale = t->GetScale();
             t->SetScale(currentScale * scale);
         }
 
@@ -729,43 +1443,13 @@ void LoadFiles::CalculateBoundingBox(std::shared_ptr<GameObject> obj,
     // Calculate Cumulative Global Transformation
     glm::mat4 worldTransform = parentTransform * localTransform;
 
-    // Process the mesh
+    // The local box comes from the .rgs header, computed once when the mesh was imported
     ComponentMesh* meshComp = obj->GetComponent<ComponentMesh>();
-    if (meshComp != nullptr && meshComp->VAO != 0 && meshComp->VBO != 0)
+    if (meshComp != nullptr && meshComp->HasGeometry() && meshComp->resource->localAABB.IsValid())
     {
-        // Read the vertex of the GPU
-        glBindBuffer(GL_ARRAY_BUFFER, meshComp->VBO);
-
-        GLint bufferSize;
-        glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &bufferSize);
-        int numVertices = bufferSize / (3 * sizeof(float));
-
-        if (numVertices > 0)
-        {
-            // Temporary buffer
-            std::vector<float> vertices(numVertices * 3);
-            glGetBufferSubData(GL_ARRAY_BUFFER, 0, bufferSize, vertices.data());
-
-            for (int i = 0; i < numVertices; ++i)
-            {
-                // Get local position
-                glm::vec4 localVertex(vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2], 1.0f);
-
-                // Transforming the world with the accumulated matrix
-                glm::vec4 worldVertex = worldTransform * localVertex;
-
-                // Expand limits (Min/Max)
-                minBounds.x = std::min(minBounds.x, worldVertex.x);
-                minBounds.y = std::min(minBounds.y, worldVertex.y);
-                minBounds.z = std::min(minBounds.z, worldVertex.z);
-
-                maxBounds.x = std::max(maxBounds.x, worldVertex.x);
-                maxBounds.y = std::max(maxBounds.y, worldVertex.y);
-                maxBounds.z = std::max(maxBounds.z, worldVertex.z);
-            }
-        }
-        // Unlink
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        AABB worldBox = meshComp->resource->localAABB.Transformed(worldTransform);
+        minBounds = glm::min(minBounds, worldBox.min);
+        maxBounds = glm::max(maxBounds, worldBox.max);
     }
 
     for (const auto& child : obj->GetChildren())
@@ -785,197 +1469,207 @@ bool LoadFiles::LoadMeshFromFile(const char* file_path, GameObject* target)
         return false;
     }
 
-    const aiScene* scene = aiImportFile(file_path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenNormals | aiProcess_JoinIdenticalVertices | aiProcess_CalcTangentSpace);
-
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode || scene->mNumMeshes == 0)
+    std::string error;
+    const aiScene* scene = ImportScene(file_path, error);
+    if (scene == nullptr || scene->mNumMeshes == 0)
     {
-        LOG("Error loading mesh: %s", aiGetErrorString());
+        LOG("Error loading mesh: %s", scene ? "No meshes" : error.c_str());
+        if (scene != nullptr) aiReleaseImport(scene);
         return false;
     }
 
     // Get the first mesh from the file
     aiMesh* aiMesh = scene->mMeshes[0];
 
-    MeshData meshData;
-    // Reuse your ProcessMesh function
-    ProcessMesh(aiMesh, meshData);
+    std::string libraryPath = GetMeshLibraryPath(assetDatabase.GetSourceKey(file_path, GetMeshSettingsHash()), 0);
+    assetDatabase.AddArtifact(file_path, libraryPath);
+    std::shared_ptr<ResourceMesh> resource = ImportMesh(aiMesh, libraryPath);
 
     currentMesh->path = file_path;
-    currentMesh->libraryPath = meshData.libraryPath;
-
-    // Load the data into the existing component, clearing the previous one
-    currentMesh->LoadMesh(meshData.vertices, meshData.num_vertices,
-        meshData.indices, meshData.num_indices,
-        meshData.texCoords, meshData.normals);
+    currentMesh->libraryPath = resource->libraryPath;
 
-    // CleanUp
-    delete[] meshData.vertices;
-    delete[] meshData.indices;
-    if (meshData.texCoords) delete[] meshData.texCoords;
-    if (meshData.normals) delete[] meshData.normals;
-    if (meshData.colors) delete[] meshData.colors;
+    // Replace the geometry of the existing component, the previous one is released
+    currentMesh->SetResource(resource);
 
     aiReleaseImport(scene);
     LOG("Mesh replaced from: %s", file_path);
     return true;
 }
 
-bool LoadFiles::SaveMeshToCustomFormat(const char* path, const MeshData& meshData)
+bool LoadFiles::LoadMeshFromCustomFormat(const char* path, MeshData& meshData)
 {
-    // Open the file in binary mode and truncate, and overwrite
-    std::ofstream file(path, std::ios::binary | std::ios::trunc);
-
-    if (!file.is_open())
+    auto mappedFile = std::make_unique<MappedFile>();
+    if (!mappedFile->Open(path))
     {
-        LOG("Error: Could not open file for writing: %s", path);
+        LOG("Error: Could not open custom mesh file: %s", path);
         return false;
     }
 
-    // Prepare and write the header
-    MeshFileHeader header;
-    header.numVertices = meshData.num_vertices;
-    header.numIndices = meshData.num_indices;
-    header.hasNormals = meshData.hasNormals;
-    header.hasTexCoords = meshData.hasTexCoords;
-    header.hasColors = meshData.hasColors;
+    uint32_t magic = 0;
+    if (mappedFile->GetSize() >= sizeof(magic)) memcpy(&magic, mappedFile->GetData(), sizeof(magic));
 
-    // Write the header structure as it is in memory
-    file.write((char*)&header, sizeof(MeshFileHeader));
+    if (magic == MESH_FILE_MAGIC)
+    {
+        meshData.mappedFile = std::move(mappedFile);
+        return MeshFile::ReadMapped(path, meshData);
+    }
 
-    // Write the array data
+    // Older format, closed before reading it with the streams because it's written again
+    mappedFile.reset();
 
-    // Vertexs -> 3 floats each vertex
-    file.write((char*)meshData.vertices, sizeof(float) * header.numVertices * 3);
+    if (!LoadOldMeshFormat(path, meshData)) return false;
 
-    // Index
-    file.write((char*)meshData.indices, sizeof(unsigned int) * header.numIndices);
+    meshData.view = meshData.packed.GetView();
 
-    // Normals, optional
-    if (header.hasNormals)
+    if (MeshFile::Save(path, meshData))
     {
-        file.write((char*)meshData.normals, sizeof(float) * header.numVertices * 3);
+        LOG("Resources: Converted mesh to the .rgs v%d format: %s", MESH_FILE_VERSION, path);
     }
+    return true;
+}
 
-    // UVs, optional
-    if (header.hasTexCoords)
-    {
-        file.write((char*)meshData.texCoords, sizeof(float) * header.numVertices * 2);
-    }
+bool LoadFiles::LoadOldMeshFormat(const char* path, MeshData& meshData)
+{
+    if (!MeshFile::ReadOld(path, meshData)) return false;
 
-    // Colors, optional
-    if (header.hasColors)
+    // The compact files are already packed
+    if (meshData.vertices != nullptr)
     {
-        file.write((char*)meshData.colors, sizeof(float) * header.numVertices * 4);
+        std::vector<Meshlet> meshlets = OptimizeMeshOrder(meshData);
+
+        meshData.packed = VertexFormat::Pack(meshData.vertices, meshData.num_vertices, meshData.indices, meshData.num_indices,
+            meshData.texCoords, meshData.normals, ResourceMesh::quantizePositions);
+        meshData.packed.meshlets = std::move(meshlets);
+        BuildMeshLods(meshData);
     }
 
-    file.close();
-    LOG("Success: Mesh saved to custom format: %s", path);
+    LOG("Success: Mesh loaded from custom format: %s", path);
     return true;
 }
 
-bool LoadFiles::LoadMeshFromCustomFormat(const char* path, MeshData& meshData)
+std::shared_ptr<ResourceTexture> LoadFiles::LoadTexture(const char* file_path)
 {
-    // Open binary mode
-    std::ifstream file(path, std::ios::binary);
-    if (!file.is_open())
+    // The same image is only uploaded once, the rest of the users share the resource
+    std::string key = ModuleResources::GetTextureKey(file_path);
+    std::shared_ptr<ResourceTexture> texture = Application::GetInstance().resources->FindTexture(key);
+    if (texture != nullptr)
     {
-        LOG("Error: Could not open custom mesh file: %s", path);
-        return nullptr;
+        LOG("Texture already loaded, sharing it: %s (ID: %d)", key.c_str(), texture->textureID);
+        return texture;
     }
 
-    // Read header
-    MeshFileHeader header;
-    file.read((char*)&header, sizeof(MeshFileHeader));
-
-    // Reserve temporary memory to read the data
-    // Creation of a local MeshData to send later to the ComponentMesh
-    meshData.num_vertices = header.numVertices;
-    meshData.num_indices = header.numIndices;
-    meshData.hasNormals = header.hasNormals;
-    meshData.hasTexCoords = header.hasTexCoords;
-    meshData.hasColors = header.hasColors;
-
-    // Vertex
-    meshData.vertices = new float[header.numVertices * 3];
-    file.read((char*)meshData.vertices, sizeof(float) * header.numVertices * 3);
-
-    // Index
-    meshData.indices = new unsigned int[header.numIndices];
-    file.read((char*)meshData.indices, sizeof(unsigned int) * header.numIndices);
-
-    // Normals
-    if (header.hasNormals)
+    // The missing files fail now, the ones DevIL can't read stay with the checker
+    if (!std::filesystem::exists(file_path))
     {
-        meshData.normals = new float[header.numVertices * 3];
-        file.read((char*)meshData.normals, sizeof(float) * header.numVertices * 3);
+        LOG("Texture file not found: %s", file_path);
+        return nullptr;
     }
 
-    // UVs
-    if (header.hasTexCoords)
+    // Named by the content of the image, so two files with the same name don't share the Library copy
+    std::string sourceKey = assetDatabase.GetSourceKey(file_path, GetTextureSettingsHash());
+    if (sourceKey.empty())
     {
-        meshData.texCoords = new float[header.numVertices * 2];
-        file.read((char*)meshData.texCoords, sizeof(float) * header.numVertices * 2);
+        LOG("Texture file can't be read: %s", file_path);
+        return nullptr;
     }
 
-    // Colors
-    if (header.hasColors)
-    {
-        meshData.colors = new float[header.numVertices * 4];
-        file.read((char*)meshData.colors, sizeof(float) * header.numVertices * 4);
-    }
+    std::string libraryPath = "Library/Textures/" + sourceKey + ".rgst";
+    assetDatabase.AddArtifact(file_path, libraryPath);
 
-    file.close();
-    LOG("Success: Mesh loaded from custom format: %s", path);
-    return true;
-}
+    // The name is reserved now so the components can keep it, the storage is created when the pixels arrive
+    GLuint textureID = 0;
+    glGenTextures(1, &textureID);
 
-unsigned int LoadFiles::LoadTexture(const char* file_path)
-{
-    // Generate the destination path in Library
-    std::string pathString(file_path);
-    std::string filename = pathString.substr(pathString.find_last_of("/\\") + 1);
+    texture = std::make_shared<ResourceTexture>(key);
+    texture->libraryPath = libraryPath;
+    texture->Reserve(textureID);
+    Application::GetInstance().resources->AddTexture(texture);
 
-    // Remove the original extension and replace it with our own .rgst
-    size_t lastDot = filename.find_last_of(".");
-    if (lastDot != std::string::npos) filename = filename.substr(0, lastDot);
-    std::string libraryPath = "Library/Textures/" + filename + ".rgst";
+    auto request = std::make_shared<TextureRequest>();
+    request->texture = texture;
+    request->sourcePath = file_path;
+    request->libraryPath = libraryPath;
+    textureRequests.push_back(request);
 
-    TextureHeader header;
-    char* buffer = nullptr;
-    unsigned int textureID = 0;
+    JobSystem::GetInstance().Submit([this, request]()
+        {
+            request->failed = !DecodeTexture(request->sourcePath, request->libraryPath, request->packed);
+            request->decoded.store(true, std::memory_order_release);
+        });
+
+    return texture;
+}
 
+bool LoadFiles::DecodeTexture(const std::string& sourcePath, const std::string& libraryPath, PackedTexture& texture)
+{
     // Check if it already exists in Library
     std::ifstream f(libraryPath.c_str());
     if (f.good())
     {
         f.close();
         LOG("Texture found in Library, loading custom format: %s", libraryPath.c_str());
-        if (LoadTextureFromCustomFormat(libraryPath.c_str(), header, buffer))
-        {
-            textureID = CreateTextureFromBuffer(header, buffer);
-            // Clean RAM memory, is already in VRAM
-            delete[] buffer;
-            return textureID;
-        }
+        if (LoadTextureFromCustomFormat(libraryPath.c_str(), texture)) return true;
     }
 
     // If it does not exist or failed to load, we import with DevIL slow path to load
-    LOG("Texture NOT found in Library, importing with DevIL: %s", file_path);
-    if (ImportTextureWithDevIL(file_path, buffer, header))
+    LOG("Texture NOT found in Library, importing with DevIL: %s", sourcePath.c_str());
+    TextureHeader header;
+    char* buffer = nullptr;
+    if (!ImportTextureWithDevIL(sourcePath.c_str(), buffer, header)) return false;
+
+    // The mips and the compression are done once here, the loads only upload the levels
+    texture = TextureFormat::Pack((const uint8_t*)buffer, header.width, header.height, ResourceTexture::compressOnImport);
+    delete[] buffer;
+
+    // Save it in Library for next time
+    SaveTextureToCustomFormat(libraryPath.c_str(), texture);
+    return true;
+}
+
+void LoadFiles::UpdateTextureRequests(std::chrono::high_resolution_clock::time_point deadline)
+{
+    int uploaded = 0;
+
+    for (size_t i = 0; i < textureRequests.size();)
     {
-        // Save it in Library for next time
-        SaveTextureToCustomFormat(libraryPath.c_str(), header, buffer);
+        TextureRequest& request = *textureRequests[i];
+        if (!request.decoded.load(std::memory_order_acquire))
+        {
+            ++i;
+            continue;
+        }
 
-        // Create the texture in OpenGL
-        textureID = CreateTextureFromBuffer(header, buffer);
-        delete[] buffer;
-    }
+        // At least one per frame, so the textures advance even if the budget is too small
+        if (uploaded > 0 && std::chrono::high_resolution_clock::now() >= deadline) break;
+
+        std::shared_ptr<ResourceTexture> texture = request.texture.lock();
+        if (request.failed)
+        {
+            LOG("Failed to decode texture, keeping the default checker: %s", request.sourcePath.c_str());
+        }
+        else if (texture != nullptr)
+        {
+            // All the slots of the ring are still being read by the GPU, try again the next frame
+            if (!textureStreamer.Upload(*texture, request.packed)) break;
+
+            size_t uncompressedBytes = (size_t)request.packed.width * request.packed.height * 4 * 4 / 3;
+            LOG("Texture streamed to OpenGL (ID: %d, %s, %d levels, %.1f KB instead of %.1f KB): %s", texture->textureID,
+                TextureFormat::GetEncodingName(request.packed.encoding), (int)request.packed.levels.size(),
+                texture->GetGPUBytes() / 1024.0f, uncompressedBytes / 1024.0f, request.sourcePath.c_str());
+            ++uploaded;
+        }
 
-    return textureID;
+        textureRequests.erase(textureRequests.begin() + i);
+    }
 }
 
+// DevIL keeps the bound image in a global, the decodes from different workers go one at a time
+static std::mutex devilMutex;
+
 bool LoadFiles::ImportTextureWithDevIL(const char* path, char*& buffer, TextureHeader& header)
 {
+    std::lock_guard<std::mutex> lock(devilMutex);
+
     ILuint imageID;
     ilGenImages(1, &imageID);
     ilBindImage(imageID);
@@ -1011,59 +1705,135 @@ bool LoadFiles::ImportTextureWithDevIL(const char* path, char*& buffer, TextureH
     return true;
 }
 
-bool LoadFiles::SaveTextureToCustomFormat(const char* path, const TextureHeader& header, const char* buffer)
+bool LoadFiles::SaveTextureToCustomFormat(const char* path, const PackedTexture& texture)
 {
-    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    // Two sources with the same content share the file and their decodes can save it at the same time,
+    // each one writes its own temporary file and renames it, so the readers only see whole files
+    static std::atomic<uint32_t> tempCounter{ 0 };
+    std::string tempPath = std::string(path) + ".tmp" + std::to_string(tempCounter.fetch_add(1));
+
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
     if (!file.is_open())
     {
         LOG("Error saving custom texture: %s", path);
         return false;
     }
 
-    // Write header
-    file.write((const char*)&header, sizeof(TextureHeader));
+    TextureFileHeader header;
+    header.encoding = texture.encoding;
+    header.width = texture.width;
+    header.height = texture.height;
+    header.levelCount = (uint32_t)texture.levels.size();
+    header.dataOffset = MeshFile::AlignStream(sizeof(TextureFileHeader) + texture.levels.size() * sizeof(TextureLevel));
+    header.dataSize = texture.data.size();
+
+    static const char padding[MESH_STREAM_ALIGNMENT] = {};
+    size_t written = sizeof(TextureFileHeader) + texture.levels.size() * sizeof(TextureLevel);
+
+    // Write header and levels
+    file.write((const char*)&header, sizeof(TextureFileHeader));
+    file.write((const char*)texture.levels.data(), texture.levels.size() * sizeof(TextureLevel));
 
     // Write Pixel Data
-    file.write(buffer, header.dataSize);
+    file.write(padding, header.dataOffset - written);
+    file.write((const char*)texture.data.data(), texture.data.size());
 
     file.close();
-    LOG("Texture saved to Library: %s", path);
+
+    std::error_code error;
+    if (!file)
+    {
+        LOG("Error saving custom texture: %s", path);
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    // Fails on Windows if a reader has the file open, what it reads is the same texture
+    std::filesystem::rename(tempPath, path, error);
+    if (error)
+    {
+        LOG("Error replacing custom texture: %s (%s)", path, error.message().c_str());
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    LOG("Texture saved to Library: %s (%s, %d levels)", path, TextureFormat::GetEncodingName(texture.encoding), header.levelCount);
     return true;
 }
 
-bool LoadFiles::LoadTextureFromCustomFormat(const char* path, TextureHeader& header, char*& buffer)
+bool LoadFiles::LoadTextureFromCustomFormat(const char* path, PackedTexture& texture)
 {
     std::ifstream file(path, std::ios::binary);
     if (!file.is_open()) return false;
 
-    // Read header
+    uint32_t magic = 0;
+    file.read((char*)&magic, sizeof(magic));
+    file.seekg(0);
+
+    if (magic == TEXTURE_FILE_MAGIC)
+    {
+        TextureFileHeader header;
+        file.read((char*)&header, sizeof(TextureFileHeader));
+
+        if (!file || header.version != TEXTURE_FILE_VERSION || header.levelCount == 0 || header.levelCount > 32 || header.encoding > TEXTURE_BC3)
+        {
+            LOG("Error: Invalid custom texture file: %s", path);
+            return false;
+        }
+
+        texture.encoding = header.encoding;
+        texture.width = header.width;
+        texture.height = header.height;
+        texture.levels.resize(header.levelCount);
+        file.read((char*)texture.levels.data(), header.levelCount * sizeof(TextureLevel));
+
+        // Every level has to be inside the data and with the size of its format
+        for (const TextureLevel& level : texture.levels)
+        {
+            if (!file || level.offset > header.dataSize || level.size > header.dataSize - level.offset ||
+                level.size != TextureFormat::GetLevelSize(header.encoding, level.width, level.height))
+            {
+                LOG("Error: Invalid custom texture file: %s", path);
+                return false;
+            }
+        }
+
+        texture.data.resize((size_t)header.dataSize);
+        file.seekg((std::streamoff)header.dataOffset);
+        file.read((char*)texture.data.data(), texture.data.size());
+
+        if (!file)
+        {
+            LOG("Error: Truncated custom texture file: %s", path);
+            return false;
+        }
+        return true;
+    }
+
+    // Old file with one RGBA8 level, packed and written again
+    TextureHeader header;
     file.read((char*)&header, sizeof(TextureHeader));
 
-    // Reserve memory and read data
-    buffer = new char[header.dataSize];
-    file.read(buffer, header.dataSize);
+    if (!file || header.width == 0 || header.height == 0 || header.dataSize != header.width * header.height * 4)
+    {
+        LOG("Error: Invalid custom texture file: %s", path);
+        return false;
+    }
 
+    std::vector<uint8_t> pixels(header.dataSize);
+    file.read((char*)pixels.data(), pixels.size());
+
+    if (!file)
+    {
+        LOG("Error: Truncated custom texture file: %s", path);
+        return false;
+    }
     file.close();
+
+    texture = TextureFormat::Pack(pixels.data(), header.width, header.height, ResourceTexture::compressOnImport);
+    if (SaveTextureToCustomFormat(path, texture))
+    {
+        LOG("Converted texture to the .rgst v%d format: %s", TEXTURE_FILE_VERSION, path);
+    }
     return true;
 }
-
-unsigned int LoadFiles::CreateTextureFromBuffer(const TextureHeader& header, const char* buffer)
-{
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-
-    // Basic parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // Upload data to the GPU
-    glTexImage2D(GL_TEXTURE_2D, 0, header.format, header.width, header.height, 0, header.format, GL_UNSIGNED_BYTE, buffer);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    glBindTexture(GL_TEXTURE_2D, 0);
-    LOG("Texture created in OpenGL (ID: %d) from buffer", textureID);
-    return textureID;
-}
\ No newline at end of file
@@ -4,52 +4,181 @@
 #include "assimp/scene.h"
 #include "assimp/postprocess.h"
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "MeshFile.h"
+#include "TextureStreamer.h"
+#include "TextureFormat.h"
+#include "AssetDatabase.h"
 #include <vector>
 #include <memory>
 #include <string>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
 
 class GameObject;
 class ComponentMesh;
+class ResourceMesh;
+class ResourceTexture;
 
-struct MeshData
+// Header of the first .rgst files, one RGBA8 level after it
+struct TextureHeader {
+    unsigned int width = 0;
+    unsigned int height = 0;
+    unsigned int format = 0;
+    unsigned int dataSize = 0;
+};
+
+// Current .rgst format: header, one entry per mip level and the levels from a multiple of 16 bytes, ready for the upload
+// The older files are converted the first time they are loaded
+static const uint32_t TEXTURE_FILE_MAGIC = 0x54534752; // "RGST"
+static const uint32_t TEXTURE_FILE_VERSION = 2;
+
+struct TextureFileHeader
 {
-    unsigned int num_vertices = 0;
-    unsigned int num_indices = 0;
-    float* vertices = nullptr;
-    unsigned int* indices = nullptr;
-    float* normals = nullptr;
-    float* texCoords = nullptr;
-    float* colors = nullptr;
-
-    bool hasNormals = false;
-    bool hasTexCoords = false;
-    bool hasColors = false;
+    uint32_t magic = TEXTURE_FILE_MAGIC;
+    uint32_t version = TEXTURE_FILE_VERSION;
+    uint32_t encoding = TEXTURE_RGBA8; // TextureEncoding
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t levelCount = 0;
+    uint64_t dataOffset = 0; // Level offsets are relative to it
+    uint64_t dataSize = 0;
+};
 
+static_assert(sizeof(TextureFileHeader) == 40, "The .rgst header is read directly from the file");
+static_assert(sizeof(TextureLevel) == 24, "The .rgst levels are read directly from the file");
+
+// Texture decoded on a worker, uploaded by the main thread when it's ready
+struct TextureRequest
+{
+    std::weak_ptr<ResourceTexture> texture;
+    std::string sourcePath;
     std::string libraryPath;
+
+    // Written by the job before decoded is set
+    PackedTexture packed;
+    bool failed = false;
+
+    std::atomic<bool> decoded{ false };
+};
+
+// Hierarchy of an FBX as it's created on the scene, built once from the assimp nodes and saved as Library/Prefabs/<key>.rgsp
+// The warm loads create the GameObjects from it and read the meshes from the Library, without opening the FBX
+struct PrefabNode
+{
+    std::string name;
+    int parent = -1;   // Always before the node on the list, -1 for the root
+    int meshIndex = -1; // Index of the mesh on the FBX, its Library path comes from the key of the FBX
+    std::string texturePath; // Diffuse texture found when the FBX was imported, empty if it has none
+
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
 };
 
-// Own format file header .rgs
-struct MeshFileHeader
+struct Prefab
 {
-    unsigned int numVertices = 0;
-    unsigned int numIndices = 0;
+    std::vector<PrefabNode> nodes;
+    uint32_t meshCount = 0;
 
-    // Flags with the data included
-    bool hasNormals = false;
-    bool hasTexCoords = false;
-    bool hasColors = false;
+    // Of all the meshes with the node transforms (only the local box with a single mesh), to normalize the scale without reading them back
+    bool hasBounds = false;
+    glm::vec3 minBounds = glm::vec3(0.0f);
+    glm::vec3 maxBounds = glm::vec3(0.0f);
+};
 
-    // Bounding box, material index, etc...
+static const uint32_t PREFAB_FILE_MAGIC = 0x50534752; // "RGSP"
+// 2: single mesh prefabs store the local box of the mesh, the ones before have the node transforms in it
+static const uint32_t PREFAB_FILE_VERSION = 2;
+
+// Header, the nodes and the names and texture paths together at the end
+struct PrefabFileHeader
+{
+    uint32_t magic = PREFAB_FILE_MAGIC;
+    uint32_t version = PREFAB_FILE_VERSION;
+    uint32_t nodeCount = 0;
+    uint32_t meshCount = 0;
+    uint32_t hasBounds = 0;
+    float minBounds[3] = {};
+    float maxBounds[3] = {};
+    uint32_t stringBytes = 0;
 };
 
-struct TextureHeader {
-    unsigned int width = 0;
-    unsigned int height = 0;
-    unsigned int format = 0;
-    unsigned int dataSize = 0;
+struct PrefabFileNode
+{
+    int32_t parent = -1;
+    int32_t meshIndex = -1;
+    uint32_t nameOffset = 0;
+    uint32_t nameSize = 0;
+    uint32_t textureOffset = 0;
+    uint32_t textureSize = 0;
+    float position[3] = {};
+    float rotation[4] = {}; // x, y, z, w
+    float scale[3] = {};
 };
 
-class GameObject;
+static_assert(sizeof(PrefabFileHeader) == 48, "The .rgsp header is read directly from the file");
+static_assert(sizeof(PrefabFileNode) == 64, "The .rgsp nodes are read directly from the file");
+
+// FBX dropped on the editor, loaded on the JobSystem while the frames keep running
+// The hierarchy is created under the placeholder as soon as assimp finishes and the meshes and textures fill it over the next frames
+struct FBXImport
+{
+    enum class State
+    {
+        LOADING_SCENE,    // The prefab or aiImportFile on a worker
+        SCENE_LOADED,     // Waiting for the main thread to create the hierarchy
+        PROCESSING_MESHES,
+        LOADING_TEXTURES,
+        FINISHED,
+        FAILED
+    };
+
+    struct PendingMaterial
+    {
+        std::weak_ptr<GameObject> gameObject;
+        std::string texturePath;
+    };
+
+    std::string path;
+    std::string name;
+    std::string fbxDirectory;
+
+    // Asset database key of the FBX, set by the job that reads the scene
+    std::string sourceKey;
+
+    // Empty object added to the scene at the start, if it's deleted the import is cancelled
+    std::weak_ptr<GameObject> placeholder;
+
+    std::atomic<State> state{ State::LOADING_SCENE };
+    std::atomic<bool> cancelled{ false };
+
+    // Jobs submitted and not finished yet, the scene can't be released until it's 0
+    std::atomic<uint32_t> runningJobs{ 0 };
+
+    // Written by the loading job before the state goes to SCENE_LOADED, the scene stays null if the prefab was on the Library
+    Prefab prefab;
+    const aiScene* scene = nullptr;
+
+    // One job per library path, with the mesh components waiting for it
+    std::vector<unsigned int> jobMeshes;
+    std::vector<MeshData> jobData;
+    std::unique_ptr<std::atomic<bool>[]> jobReady;
+    std::vector<bool> jobUploaded;
+    std::vector<std::vector<std::weak_ptr<GameObject>>> jobTargets;
+    uint32_t uploadedMeshes = 0;
+    std::atomic<uint32_t> processedMeshes{ 0 };
+
+    std::vector<PendingMaterial> pendingMaterials;
+    size_t loadedMaterials = 0;
+
+    std::chrono::high_resolution_clock::time_point startTime;
+
+    // From 0 to 1, the meshes are most of the work
+    float GetProgress() const;
+    const char* GetStateName() const;
+};
 
 class LoadFiles : public Module
 {
@@ -65,26 +194,81 @@ public:
     bool CleanUp();
 
     std::shared_ptr<GameObject> LoadFBX(const char* file_path);
+
+    // Returns the placeholder right away, the rest of the FBX is loaded on the next frames
+    std::shared_ptr<GameObject> LoadFBXAsync(const char* file_path);
+    void CancelImport(FBXImport* import);
+    const std::vector<std::shared_ptr<FBXImport>>& GetImports() const { return imports; }
+
+    // Time per frame for the GL uploads of the async imports and the streamed textures
+    float importBudgetMs = 4.0f;
+
+    size_t GetPendingTextureCount() const { return textureRequests.size(); }
+
+    // Library artifacts of each source, keyed by their content and the import settings
+    AssetDatabase assetDatabase;
+
     bool LoadTexture(const char* file_path, GameObject* target);
-    unsigned int LoadTexture(const char* file_path);
+    // Shared texture of the file, only read and uploaded if it's not already on the resources cache
+    // Returned right away, the file is decoded on a worker and uploaded on a later frame, until then it's drawn with the checker
+    std::shared_ptr<ResourceTexture> LoadTexture(const char* file_path);
     bool LoadMeshFromFile(const char* file_path, GameObject* target);
     void HandleDropFile(const char* file_path);
 
-    bool SaveMeshToCustomFormat(const char* path, const MeshData& meshData);
+    // Maps the versioned files and points meshData.view to them, the older ones are read, packed and saved again in the current version
     bool LoadMeshFromCustomFormat(const char* path, MeshData& meshData);
 
 private:
 
-    void ProcessMesh(aiMesh* aiMesh, MeshData& meshData);
-    std::shared_ptr<GameObject> CreateGameObjectFromMesh(const MeshData& meshData, const char* name, const char* assetPath);
-    std::shared_ptr<GameObject> ProcessNode(aiNode* node, const aiScene* scene, std::shared_ptr<GameObject> parent, const std::string& fbxDirectory, const char* assetPath, glm::mat4 accumulatedTransform = glm::mat4(1.0f));
+    // Path of the mesh on the Library, also its key on the resources cache
+    // sourceKey comes from the asset database, so it changes when the FBX or the import settings change
+    std::string GetMeshLibraryPath(const std::string& sourceKey, unsigned int meshIndex);
+
+    std::string GetPrefabLibraryPath(const std::string& sourceKey);
+
+    // Shared mesh from the resources cache, only read from the Library (or assimp) if it's not loaded yet
+    std::shared_ptr<ResourceMesh> ImportMesh(aiMesh* aiMesh, const std::string& libraryPath);
+
+    // Same for all the meshes of the FBX, the ones not loaded are processed in parallel on the JobSystem
+    // and uploaded on the main thread when all of them are ready. The result is indexed like scene->mMeshes
+    // scene is null on the warm loads, then all the meshes come from the Library
+    std::vector<std::shared_ptr<ResourceMesh>> ImportSceneMeshes(const aiScene* scene, unsigned int meshCount, const char* sourcePath, const std::string& sourceKey);
 
-    void LoadMaterialTextures(const aiScene* scene, aiMesh* mesh, std::shared_ptr<GameObject> gameObject, const std::string& fbxDirectory);
+    // Only CPU work (reading or converting the mesh and saving the .rgs), so it can run on the workers
+    // aiMesh can be null if the mesh is on the Library, the view stays empty if it can't be read
+    void ProcessMesh(aiMesh* aiMesh, const std::string& libraryPath, MeshData& meshData);
 
-    void ApplyTextureToAllChildren(std::shared_ptr<GameObject> go, unsigned int textureID, const char* path);
+    // MeshFile::ReadOld, then the float streams of the first files are optimized and packed like a new import
+    bool LoadOldMeshFormat(const char* path, MeshData& meshData);
+
+    // Only reads assimp and the file system, so the async imports build it on a worker
+    void BuildPrefab(const aiScene* scene, const std::string& fbxDirectory, const std::string& name, Prefab& prefab);
+    void BuildPrefabNodes(const aiNode* node, const aiScene* scene, const std::string& fbxDirectory, int parent, glm::mat4 accumulatedTransform, Prefab& prefab);
+    bool SavePrefab(const char* path, const Prefab& prefab);
+    // Also fails if one of the meshes is missing from the Library, so the FBX is imported again
+    bool LoadPrefab(const char* path, const std::string& sourceKey, Prefab& prefab);
+
+    // Creates the GameObjects, sceneMeshes is indexed like the FBX meshes and can have nulls that are set later
+    // The textures are added to pendingMaterials instead of loaded when it's not null
+    std::shared_ptr<GameObject> InstantiatePrefab(const Prefab& prefab, const std::vector<std::shared_ptr<ResourceMesh>>& sceneMeshes, const char* assetPath, const std::string& sourceKey, std::vector<FBXImport::PendingMaterial>* pendingMaterials = nullptr);
+
+    // Steps of the async imports, called from Update
+    void UpdateImports(std::chrono::high_resolution_clock::time_point deadline);
+    void UpdateTextureRequests(std::chrono::high_resolution_clock::time_point deadline);
+    void StartImportMeshes(std::shared_ptr<FBXImport> import, std::shared_ptr<GameObject> placeholder);
+    void UploadImportMeshes(FBXImport& import, std::chrono::high_resolution_clock::time_point deadline);
+    bool LoadImportTextures(FBXImport& import, std::chrono::high_resolution_clock::time_point deadline);
+    void ReleaseImport(FBXImport& import);
+
+    // Path of the diffuse texture of the mesh that exists on disk, empty if there isn't one
+    std::string FindMaterialTexture(const aiScene* scene, const aiMesh* mesh, const std::string& fbxDirectory);
+    void ApplyMaterialTexture(std::shared_ptr<GameObject> gameObject, const std::string& texturePath);
+
+    void ApplyTextureToAllChildren(std::shared_ptr<GameObject> go, std::shared_ptr<ResourceTexture> texture, const char* path);
 
     // Scale the root object so its largest dimension is the targetSize
     void NormalizeModelScale(std::shared_ptr<GameObject> rootObject, float targetSize = 5.0f);
+    void ApplyModelScale(std::shared_ptr<GameObject> rootObject, const glm::vec3& minBounds, const glm::vec3& maxBounds, float targetSize);
 
     // Recursively calculates bounds (AABB) in world space
     void CalculateBoundingBox(std::shared_ptr<GameObject> obj,
@@ -93,8 +277,15 @@ private:
 
     aiLogStream stream;
 
+    std::vector<std::shared_ptr<FBXImport>> imports;
+
     bool ImportTextureWithDevIL(const char* path, char*& buffer, TextureHeader& header);
-    bool SaveTextureToCustomFormat(const char* path, const TextureHeader& header, const char* buffer);
-    bool LoadTextureFromCustomFormat(const char* path, TextureHeader& header, char*& buffer);
-    unsigned int CreateTextureFromBuffer(const TextureHeader& header, const char* buffer);
+    bool SaveTextureToCustomFormat(const char* path, const PackedTexture& texture);
+    // Reads the versioned files, the older ones are packed and saved again in the current version
+    bool LoadTextureFromCustomFormat(const char* path, PackedTexture& texture);
+    // Reads the Library copy or imports the source with DevIL (and saves the copy), runs on the workers
+    bool DecodeTexture(const std::string& sourcePath, const std::string& libraryPath, PackedTexture& texture);
+
+    std::vector<std::shared_ptr<TextureRequest>> textureRequests;
+    TextureStreamer textureStreamer;
 };
\ No newline at end of file
@@ -4,10 +4,16 @@
 #include <cstdio>
 #include <string>
 
+std::mutex& GetLogMutex()
+{
+    static std::mutex logMutex;
+    return logMutex;
+}
+
 void Log(const char file[], int line, const char* format, ...)
 {
-    static char tmpString1[4096];
-    static va_list ap;
+    char tmpString1[4096];
+    va_list ap;
 
     // Construct the string from variable arguments
     va_start(ap, format);
@@ -18,5 +24,6 @@ void Log(const char file[], int line, const char* format, ...)
     std::string logMessage = std::string("\n") + file + "(" + std::to_string(line) + ") : " + tmpString1;
 
     // Print the formatted string to the standard error stream
+    std::lock_guard<std::mutex> lock(GetLogMutex());
     std::cerr << logMessage << std::endl;
 }
\ No newline at end of file
@@ -3,9 +3,14 @@
 
 #include <cstdio>
 #include <cstdarg>
+#include <mutex>
 
 #define LOG(format, ...) Log(__FILE__, __LINE__, format, ##__VA_ARGS__)
 
+// Can be called from the JobSystem workers, the messages are written one at a time
 void Log(const char file[], int line, const char* format, ...);
 
+// Held while a message is written, lock it to read the stream that receives std::cerr
+std::mutex& GetLogMutex();
+
 #endif  // __LOG_H__
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char* path)
+{
+    Close();
+
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = (const uint8_t*)view;
+    size = (size_t)fileSize.QuadPart;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (data != nullptr) UnmapViewOfFile(data);
+    if (mappingHandle != nullptr) CloseHandle((HANDLE)mappingHandle);
+    if (fileHandle != nullptr) CloseHandle((HANDLE)fileHandle);
+
+    data = nullptr;
+    size = 0;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const char* path)
+{
+    Close();
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED)
+    {
+        close(fd);
+        return false;
+    }
+
+    fileDescriptor = fd;
+    data = (const uint8_t*)view;
+    size = (size_t)info.st_size;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (data != nullptr) munmap((void*)data, size);
+    if (fileDescriptor >= 0) close(fileDescriptor);
+
+    data = nullptr;
+    size = 0;
+    fileDescriptor = -1;
+}
+
+#endif
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Read only view of a whole file mapped in memory, the pages are read by the OS when they are touched
+// The pointer is valid until Close() or the destructor
+class MappedFile
+{
+public:
+
+    MappedFile() {}
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const char* path);
+    void Close();
+
+    bool IsOpen() const { return data != nullptr; }
+    const uint8_t* GetData() const { return data; }
+    size_t GetSize() const { return size; }
+
+private:
+
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+};
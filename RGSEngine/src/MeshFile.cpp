@@ -0,0 +1,340 @@
+#include "MeshFile.h"
+#include "Log.h"
+
+#include <fstream>
+#include <cstring>
+
+static uint32_t ComputeChecksum(const uint8_t* data, size_t size)
+{
+    // FNV-1a, enough to find truncated or corrupted files
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool MeshFile::Save(const char* path, const MeshData& meshData)
+{
+    // Open the file in binary mode and truncate, and overwrite
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+    if (!file.is_open())
+    {
+        LOG("Error: Could not open file for writing: %s", path);
+        return false;
+    }
+
+    // The streams are written as they are on the GPU, so the load doesn't need to convert anything
+    const PackedMesh& packed = meshData.packed;
+
+    MeshFileHeaderV2 header;
+    header.flags = packed.flags;
+    header.vertexCount = packed.vertexCount;
+    header.indexCount = packed.indexCount;
+    if (packed.bounds.IsValid())
+    {
+        memcpy(header.boundsMin, &packed.bounds.min.x, sizeof(header.boundsMin));
+        memcpy(header.boundsMax, &packed.bounds.max.x, sizeof(header.boundsMax));
+    }
+
+    // The optional sections are only written when the mesh has them
+    MeshFileSection sections[5];
+    const uint8_t* streams[5];
+    auto AddSection = [&](MeshSectionType type, const void* stream, size_t size)
+        {
+            if (size == 0 && type != MESH_SECTION_VERTICES && type != MESH_SECTION_INDICES) return;
+            sections[header.sectionCount].type = type;
+            sections[header.sectionCount].size = size;
+            streams[header.sectionCount] = (const uint8_t*)stream;
+            ++header.sectionCount;
+        };
+
+    AddSection(MESH_SECTION_VERTICES, packed.vertices.data(), packed.vertices.size());
+    AddSection(MESH_SECTION_INDICES, packed.indices.data(), packed.indices.size());
+    AddSection(MESH_SECTION_MESHLETS, packed.meshlets.data(), packed.meshlets.size() * sizeof(Meshlet));
+    AddSection(MESH_SECTION_LODS, packed.lods.data(), packed.lods.size() * sizeof(MeshLod));
+    AddSection(MESH_SECTION_LOD_INDICES, packed.lodIndices.data(), packed.lodIndices.size());
+
+    uint64_t offset = sizeof(MeshFileHeaderV2) + header.sectionCount * sizeof(MeshFileSection);
+    for (uint32_t i = 0; i < header.sectionCount; ++i)
+    {
+        sections[i].offset = AlignStream(offset);
+        sections[i].checksum = ComputeChecksum(streams[i], (size_t)sections[i].size);
+        offset = sections[i].offset + sections[i].size;
+    }
+
+    static const char padding[MESH_STREAM_ALIGNMENT] = {};
+    uint64_t written = sizeof(MeshFileHeaderV2) + header.sectionCount * sizeof(MeshFileSection);
+
+    file.write((const char*)&header, sizeof(MeshFileHeaderV2));
+    file.write((const char*)sections, header.sectionCount * sizeof(MeshFileSection));
+
+    for (uint32_t i = 0; i < header.sectionCount; ++i)
+    {
+        file.write(padding, sections[i].offset - written);
+        file.write((const char*)streams[i], sections[i].size);
+        written = sections[i].offset + sections[i].size;
+    }
+
+    if (!file)
+    {
+        LOG("Error: Could not write custom mesh file: %s", path);
+        return false;
+    }
+
+    file.close();
+    LOG("Success: Mesh saved to custom format v%d: %s (%d bytes per vertex)", MESH_FILE_VERSION, path, packed.GetStride());
+    return true;
+}
+
+bool MeshFile::ReadMapped(const char* path, MeshData& meshData)
+{
+    const uint8_t* data = meshData.mappedFile->GetData();
+    const size_t size = meshData.mappedFile->GetSize();
+
+    if (size < sizeof(MeshFileHeaderV2))
+    {
+        LOG("Error: Truncated custom mesh file: %s", path);
+        return false;
+    }
+
+    MeshFileHeaderV2 header;
+    memcpy(&header, data, sizeof(MeshFileHeaderV2));
+
+    if (header.version < 2 || header.version > MESH_FILE_VERSION)
+    {
+        LOG("Error: Unsupported custom mesh version %d: %s", header.version, path);
+        return false;
+    }
+
+    if (size < sizeof(MeshFileHeaderV2) + (uint64_t)header.sectionCount * sizeof(MeshFileSection))
+    {
+        LOG("Error: Truncated custom mesh file: %s", path);
+        return false;
+    }
+
+    PackedMeshView& view = meshData.view;
+    view.flags = header.flags;
+    view.vertexCount = header.vertexCount;
+    view.indexCount = header.indexCount;
+    if (view.vertexCount > 0)
+    {
+        view.bounds.min = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+        view.bounds.max = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    }
+
+    // Unknown sections are skipped, so newer files with more data can still be read
+    const uint8_t* sectionTable = data + sizeof(MeshFileHeaderV2);
+    for (uint32_t i = 0; i < header.sectionCount; ++i)
+    {
+        MeshFileSection section;
+        memcpy(&section, sectionTable + (size_t)i * sizeof(MeshFileSection), sizeof(MeshFileSection));
+
+        if (section.offset > size || section.size > size - section.offset)
+        {
+            LOG("Error: Section %d out of the custom mesh file: %s", i, path);
+            return false;
+        }
+
+        const uint8_t* stream = data + section.offset;
+        if (section.type == MESH_SECTION_VERTICES)
+        {
+            if (section.size != view.GetVertexBytes()) return false;
+            view.vertices = stream;
+        }
+        else if (section.type == MESH_SECTION_INDICES)
+        {
+            if (section.size != view.GetIndexBytes()) return false;
+            view.indices = stream;
+        }
+        else if (section.type == MESH_SECTION_MESHLETS)
+        {
+            if (section.size % sizeof(Meshlet) != 0) return false;
+            view.meshlets = (const Meshlet*)stream;
+            view.meshletCount = (uint32_t)(section.size / sizeof(Meshlet));
+        }
+        else if (section.type == MESH_SECTION_LODS)
+        {
+            if (section.size % sizeof(MeshLod) != 0) return false;
+            view.lods = (const MeshLod*)stream;
+            view.lodCount = (uint32_t)(section.size / sizeof(MeshLod));
+        }
+        else if (section.type == MESH_SECTION_LOD_INDICES)
+        {
+            if (section.size % view.GetIndexSize() != 0) return false;
+            view.lodIndices = stream;
+            view.lodIndexCount = (uint32_t)(section.size / view.GetIndexSize());
+        }
+        else
+        {
+            continue;
+        }
+
+        if (ComputeChecksum(stream, (size_t)section.size) != section.checksum)
+        {
+            LOG("Error: Wrong checksum on section %d of the custom mesh file: %s", i, path);
+            return false;
+        }
+    }
+
+    if (view.vertices == nullptr || view.indices == nullptr)
+    {
+        LOG("Error: Missing streams on the custom mesh file: %s", path);
+        return false;
+    }
+
+    // The mesh is still drawn whole if the meshlets don't match the indices
+    for (uint32_t i = 0; i < view.meshletCount; ++i)
+    {
+        const Meshlet& meshlet = view.meshlets[i];
+        if (meshlet.firstIndex > view.indexCount || meshlet.indexCount > view.indexCount - meshlet.firstIndex)
+        {
+            LOG("Error: Meshlet %d out of the indices of the custom mesh file: %s", i, path);
+            view.meshlets = nullptr;
+            view.meshletCount = 0;
+            break;
+        }
+    }
+
+    // Same for the LODs, they must be after the indices of the full mesh
+    for (uint32_t i = 0; i < view.lodCount; ++i)
+    {
+        const MeshLod& lod = view.lods[i];
+        if (view.lodIndices == nullptr || lod.firstIndex < view.indexCount || lod.firstIndex > view.indexCount + view.lodIndexCount ||
+            lod.indexCount > view.indexCount + view.lodIndexCount - lod.firstIndex)
+        {
+            LOG("Error: LOD %d out of the indices of the custom mesh file: %s", i, path);
+            view.lods = nullptr;
+            view.lodCount = 0;
+            break;
+        }
+    }
+
+    meshData.num_vertices = view.vertexCount;
+    meshData.num_indices = view.indexCount;
+    meshData.hasNormals = view.HasFlag(VERTEX_HAS_NORMALS);
+    meshData.hasTexCoords = view.HasFlag(VERTEX_HAS_UVS);
+
+    LOG("Success: Mesh mapped from custom format: %s", path);
+    return true;
+}
+
+bool MeshFile::ReadOld(const char* path, MeshData& meshData)
+{
+    // Open binary mode
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        LOG("Error: Could not open custom mesh file: %s", path);
+        return false;
+    }
+
+    uint32_t magic = 0;
+    file.read((char*)&magic, sizeof(magic));
+    file.seekg(0);
+
+    if (magic == MESH_COMPACT_MAGIC)
+    {
+        CompactMeshHeader header;
+        file.read((char*)&header, sizeof(CompactMeshHeader));
+
+        PackedMesh& packed = meshData.packed;
+        packed.flags = header.flags;
+        packed.vertexCount = header.vertexCount;
+        packed.indexCount = header.indexCount;
+        if (packed.vertexCount > 0)
+        {
+            packed.bounds.min = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+            packed.bounds.max = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+        }
+
+        packed.vertices.resize((size_t)packed.vertexCount * packed.GetStride());
+        packed.indices.resize((size_t)packed.indexCount * packed.GetIndexSize());
+        file.read((char*)packed.vertices.data(), packed.vertices.size());
+        file.read((char*)packed.indices.data(), packed.indices.size());
+
+        if (!file)
+        {
+            LOG("Error: Truncated custom mesh file: %s", path);
+            return false;
+        }
+
+        meshData.num_vertices = packed.vertexCount;
+        meshData.num_indices = packed.indexCount;
+        meshData.hasNormals = packed.HasFlag(VERTEX_HAS_NORMALS);
+        meshData.hasTexCoords = packed.HasFlag(VERTEX_HAS_UVS);
+
+        file.close();
+        return true;
+    }
+
+    // Old file with the float streams, LoadFiles packs them after reading them
+
+    // Read header
+    MeshFileHeader header;
+    file.read((char*)&header, sizeof(MeshFileHeader));
+
+    // Reserve temporary memory to read the data
+    // Creation of a local MeshData to send later to the ComponentMesh
+    meshData.num_vertices = header.numVertices;
+    meshData.num_indices = header.numIndices;
+    meshData.hasNormals = header.hasNormals;
+    meshData.hasTexCoords = header.hasTexCoords;
+    meshData.hasColors = header.hasColors;
+
+    // Vertex
+    meshData.vertices = new float[header.numVertices * 3];
+    file.read((char*)meshData.vertices, sizeof(float) * header.numVertices * 3);
+
+    // Index
+    meshData.indices = new unsigned int[header.numIndices];
+    file.read((char*)meshData.indices, sizeof(unsigned int) * header.numIndices);
+
+    // Normals
+    if (header.hasNormals)
+    {
+        meshData.normals = new float[header.numVertices * 3];
+        file.read((char*)meshData.normals, sizeof(float) * header.numVertices * 3);
+    }
+
+    // UVs
+    if (header.hasTexCoords)
+    {
+        meshData.texCoords = new float[header.numVertices * 2];
+        file.read((char*)meshData.texCoords, sizeof(float) * header.numVertices * 2);
+    }
+
+    // Colors
+    if (header.hasColors)
+    {
+        meshData.colors = new float[header.numVertices * 4];
+        file.read((char*)meshData.colors, sizeof(float) * header.numVertices * 4);
+    }
+
+    if (!file)
+    {
+        LOG("Error: Truncated custom mesh file: %s", path);
+        return false;
+    }
+
+    file.close();
+    return true;
+}
+
+void MeshFile::ReleaseStreams(MeshData& meshData)
+{
+    delete[] meshData.vertices;
+    delete[] meshData.indices;
+    delete[] meshData.texCoords;
+    delete[] meshData.normals;
+    delete[] meshData.colors;
+
+    meshData.vertices = nullptr;
+    meshData.indices = nullptr;
+    meshData.texCoords = nullptr;
+    meshData.normals = nullptr;
+    meshData.colors = nullptr;
+}
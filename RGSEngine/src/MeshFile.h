@@ -0,0 +1,126 @@
+#pragma once
+
+#include "VertexFormat.h"
+#include "MappedFile.h"
+
+#include <memory>
+#include <string>
+#include <cstdint>
+
+struct MeshData
+{
+    unsigned int num_vertices = 0;
+    unsigned int num_indices = 0;
+    float* vertices = nullptr;
+    unsigned int* indices = nullptr;
+    float* normals = nullptr;
+    float* texCoords = nullptr;
+    float* colors = nullptr;
+
+    bool hasNormals = false;
+    bool hasTexCoords = false;
+    bool hasColors = false;
+
+    std::string libraryPath;
+
+    // Interleaved and quantized form, the one uploaded to the GPU and saved to the Library
+    PackedMesh packed;
+
+    // The versioned .rgs files are mapped and uploaded from the mapping, without copying the streams to the heap
+    std::unique_ptr<MappedFile> mappedFile;
+
+    // What is uploaded, points to the mapped file or to packed
+    PackedMeshView view;
+};
+
+// Header of the first .rgs files, the float streams go after it without any padding
+struct MeshFileHeader
+{
+    unsigned int numVertices = 0;
+    unsigned int numIndices = 0;
+
+    // Flags with the data included
+    bool hasNormals = false;
+    bool hasTexCoords = false;
+    bool hasColors = false;
+
+    // Bounding box, material index, etc...
+};
+
+// Header of the .rgs files with the compact vertices before the section table
+// After it: vertexCount * stride bytes of vertices and indexCount * index size bytes of indices
+static const uint32_t MESH_COMPACT_MAGIC = 0x43534752; // "RGSC"
+
+struct CompactMeshHeader
+{
+    uint32_t magic = MESH_COMPACT_MAGIC;
+    uint32_t flags = 0; // VertexFlags
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+    float boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+};
+
+// Current .rgs format: header, section table and the streams, each one starting at a multiple of 16 bytes
+// The streams are stored as the GPU reads them, so the loader maps the file and uploads from the mapping
+// The older files are converted to this one the first time they are loaded
+// v3 added the meshlet section and v4 the LOD ones, the older files are still read without them
+static const uint32_t MESH_FILE_MAGIC = 0x4D534752; // "RGSM"
+static const uint32_t MESH_FILE_VERSION = 4;
+static const uint32_t MESH_STREAM_ALIGNMENT = 16;
+
+enum MeshSectionType : uint32_t
+{
+    MESH_SECTION_VERTICES = 1,
+    MESH_SECTION_INDICES = 2,
+    MESH_SECTION_MESHLETS = 3,
+    MESH_SECTION_LODS = 4,
+    MESH_SECTION_LOD_INDICES = 5
+};
+
+struct MeshFileHeaderV2
+{
+    uint32_t magic = MESH_FILE_MAGIC;
+    uint32_t version = MESH_FILE_VERSION;
+    uint32_t flags = 0; // VertexFlags
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    uint32_t sectionCount = 0;
+    float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+    float boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+};
+
+// Offsets are from the start of the file, the checksum is the FNV-1a of the section bytes
+struct MeshFileSection
+{
+    uint32_t type = 0; // MeshSectionType
+    uint32_t checksum = 0;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+};
+
+static_assert(sizeof(MeshFileHeaderV2) == 48, "The .rgs header is read directly from the file");
+static_assert(sizeof(MeshFileSection) == 24, "The .rgs sections are read directly from the file");
+
+// Reading and writing of the .rgs files, apart from LoadFiles so the benchmarks can load meshes without assimp or OpenGL
+namespace MeshFile
+{
+    // Next offset at MESH_STREAM_ALIGNMENT, the .rgst files align their levels the same way
+    inline uint64_t AlignStream(uint64_t offset)
+    {
+        return (offset + MESH_STREAM_ALIGNMENT - 1) & ~(uint64_t)(MESH_STREAM_ALIGNMENT - 1);
+    }
+
+    // Writes meshData.packed in the current version
+    bool Save(const char* path, const MeshData& meshData);
+
+    // Points meshData.view to the versioned file mapped on meshData.mappedFile, the streams are checked but not copied
+    bool ReadMapped(const char* path, MeshData& meshData);
+
+    // Files from before the versioned format: the compact ones are read to meshData.packed,
+    // the first ones to the float streams, still to be packed
+    bool ReadOld(const char* path, MeshData& meshData);
+
+    // Frees the float streams, the packed ones and the mapped file are released with the MeshData
+    void ReleaseStreams(MeshData& meshData);
+}
@@ -0,0 +1,426 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+// Bigger than the real caches on purpose, the order is good for any size below it
+static const int SIMULATED_CACHE_SIZE = 32;
+static const int MAX_VALENCE_SCORES = 32;
+
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+// A collapse can't turn a triangle more than about 75 degrees
+static const float MIN_NORMAL_DOT = 0.25f;
+
+struct ScoreTables
+{
+    float cache[SIMULATED_CACHE_SIZE];
+    float valence[MAX_VALENCE_SCORES];
+
+    ScoreTables()
+    {
+        for (int i = 0; i < SIMULATED_CACHE_SIZE; ++i)
+        {
+            // The 3 vertices of the last triangle get a fixed score, so the next one doesn't just reuse its edge
+            if (i < 3)
+            {
+                cache[i] = LAST_TRIANGLE_SCORE;
+            }
+            else
+            {
+                float scaler = 1.0f / (SIMULATED_CACHE_SIZE - 3);
+                cache[i] = std::pow(1.0f - (i - 3) * scaler, CACHE_DECAY_POWER);
+            }
+        }
+
+        // Vertices with few triangles left are finished first, so they don't stay alone at the end
+        valence[0] = 0.0f;
+        for (int i = 1; i < MAX_VALENCE_SCORES; ++i)
+        {
+            valence[i] = VALENCE_BOOST_SCALE * std::pow((float)i, -VALENCE_BOOST_POWER);
+        }
+    }
+};
+
+static float GetVertexScore(const ScoreTables& tables, int cachePosition, unsigned int remainingTriangles)
+{
+    if (remainingTriangles == 0) return -1.0f;
+
+    float score = (cachePosition >= 0) ? tables.cache[cachePosition] : 0.0f;
+    score += tables.valence[std::min(remainingTriangles, (unsigned int)MAX_VALENCE_SCORES - 1)];
+    return score;
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, unsigned int vertexCount, unsigned int cacheSize)
+{
+    CacheStats stats;
+    if (indexCount < 3 || vertexCount == 0) return stats;
+
+    // Each vertex remembers when it entered the FIFO, it's still there if less than cacheSize vertices entered after it
+    std::vector<size_t> entered(vertexCount, 0);
+    size_t misses = 0;
+
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        unsigned int vertex = indices[i];
+        if (entered[vertex] == 0 || misses + 1 - entered[vertex] > cacheSize)
+        {
+            ++misses;
+            entered[vertex] = misses;
+        }
+    }
+
+    stats.acmr = (float)misses / (indexCount / 3);
+    stats.atvr = (float)misses / vertexCount;
+    return stats;
+}
+
+void MeshOptimizer::OptimizeVertexCache(unsigned int* indices, size_t indexCount, unsigned int vertexCount)
+{
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0 || vertexCount == 0) return;
+
+    static const ScoreTables tables;
+
+    // Triangles of each vertex, the ones already emitted are moved past the remaining count
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i) ++remaining[indices[i]];
+
+    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+    for (unsigned int v = 0; v < vertexCount; ++v) adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remaining[v];
+
+    std::vector<unsigned int> adjacency(triangleCount * 3);
+    {
+        std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            for (int k = 0; k < 3; ++k) adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (unsigned int v = 0; v < vertexCount; ++v) vertexScore[v] = GetVertexScore(tables, -1, remaining[v]);
+
+    std::vector<float> triangleScore(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> output;
+    output.reserve(triangleCount * 3);
+
+    // 3 more slots for the vertices pushed before the oldest ones are dropped
+    unsigned int cache[SIMULATED_CACHE_SIZE + 3];
+    int cacheCount = 0;
+
+    size_t bestTriangle = 0;
+    size_t scanCursor = 0;
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+    {
+        // Nothing from the cache was a candidate, the next triangle in the original order starts again
+        if (bestTriangle == triangleCount)
+        {
+            while (emitted[scanCursor]) ++scanCursor;
+            bestTriangle = scanCursor;
+        }
+
+        const unsigned int* triangle = &indices[bestTriangle * 3];
+        output.insert(output.end(), triangle, triangle + 3);
+        emitted[bestTriangle] = true;
+
+        // Remove the triangle from the adjacency of its vertices
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int vertex = triangle[k];
+            unsigned int* begin = &adjacency[adjacencyOffsets[vertex]];
+            unsigned int* end = begin + remaining[vertex];
+            std::swap(*std::find(begin, end, (unsigned int)bestTriangle), *(end - 1));
+            --remaining[vertex];
+        }
+
+        // The vertices of the triangle go to the front of the LRU cache, without repeating them
+        unsigned int newCache[SIMULATED_CACHE_SIZE + 3];
+        int newCount = 0;
+        for (int k = 0; k < 3; ++k) newCache[newCount++] = triangle[k];
+        for (int c = 0; c < cacheCount; ++c)
+        {
+            unsigned int vertex = cache[c];
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) newCache[newCount++] = vertex;
+        }
+
+        for (int c = 0; c < newCount; ++c)
+        {
+            unsigned int vertex = newCache[c];
+            cachePosition[vertex] = (c < SIMULATED_CACHE_SIZE) ? c : -1;
+            vertexScore[vertex] = GetVertexScore(tables, cachePosition[vertex], remaining[vertex]);
+        }
+
+        // Only the triangles of the vertices whose score changed can be the next best one
+        float bestScore = -1.0f;
+        bestTriangle = triangleCount;
+        for (int c = 0; c < newCount; ++c)
+        {
+            unsigned int vertex = newCache[c];
+            for (unsigned int a = 0; a < remaining[vertex]; ++a)
+            {
+                unsigned int t = adjacency[adjacencyOffsets[vertex] + a];
+                const unsigned int* other = &indices[t * 3];
+                triangleScore[t] = vertexScore[other[0]] + vertexScore[other[1]] + vertexScore[other[2]];
+
+                if (c < SIMULATED_CACHE_SIZE && triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        cacheCount = std::min(newCount, SIMULATED_CACHE_SIZE);
+        memcpy(cache, newCache, cacheCount * sizeof(unsigned int));
+    }
+
+    memcpy(indices, output.data(), output.size() * sizeof(unsigned int));
+}
+
+std::vector<unsigned int> MeshOptimizer::OptimizeVertexFetch(unsigned int* indices, size_t indexCount, unsigned int vertexCount, unsigned int& newVertexCount)
+{
+    std::vector<unsigned int> remap(vertexCount, INVALID_INDEX);
+    newVertexCount = 0;
+
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        unsigned int& newIndex = remap[indices[i]];
+        if (newIndex == INVALID_INDEX) newIndex = newVertexCount++;
+        indices[i] = newIndex;
+    }
+
+    return remap;
+}
+
+void MeshOptimizer::RemapVertices(float* destination, const float* source, unsigned int components, const std::vector<unsigned int>& remap)
+{
+    for (size_t v = 0; v < remap.size(); ++v)
+    {
+        if (remap[v] == INVALID_INDEX) continue;
+        memcpy(destination + (size_t)remap[v] * components, source + v * components, components * sizeof(float));
+    }
+}
+
+// Sum of the squared distances to a set of planes, as the symmetric 4x4 matrix of the plane equations
+struct Quadric
+{
+    double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+    double a11 = 0, a12 = 0, a13 = 0;
+    double a22 = 0, a23 = 0;
+    double a33 = 0;
+
+    void AddPlane(double a, double b, double c, double d)
+    {
+        a00 += a * a; a01 += a * b; a02 += a * c; a03 += a * d;
+        a11 += b * b; a12 += b * c; a13 += b * d;
+        a22 += c * c; a23 += c * d;
+        a33 += d * d;
+    }
+
+    void Add(const Quadric& q)
+    {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+        a11 += q.a11; a12 += q.a12; a13 += q.a13;
+        a22 += q.a22; a23 += q.a23;
+        a33 += q.a33;
+    }
+
+    double Evaluate(const float* p) const
+    {
+        double x = p[0], y = p[1], z = p[2];
+        return a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+            + a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+            + a22 * z * z + 2 * a23 * z
+            + a33;
+    }
+};
+
+static void TriangleNormal(const float* a, const float* b, const float* c, float normal[3])
+{
+    float e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    float e1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    normal[0] = e0[1] * e1[2] - e0[2] * e1[1];
+    normal[1] = e0[2] * e1[0] - e0[0] * e1[2];
+    normal[2] = e0[0] * e1[1] - e0[1] * e1[0];
+}
+
+struct Collapse
+{
+    unsigned int from;
+    unsigned int to;
+    double cost;
+};
+
+std::vector<unsigned int> MeshOptimizer::Simplify(const unsigned int* indices, size_t indexCount, const float* positions, unsigned int vertexCount,
+    size_t targetIndexCount, float maxError, float& error)
+{
+    std::vector<unsigned int> result(indices, indices + indexCount - indexCount % 3);
+    error = 0.0f;
+    if (result.empty() || vertexCount == 0) return result;
+
+    // Edges with one triangle are borders (the seams are too, their vertices are split), more than two are non manifold
+    std::vector<bool> locked(vertexCount, false);
+    {
+        std::unordered_map<uint64_t, unsigned int> edgeUses;
+        edgeUses.reserve(result.size());
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                unsigned int a = result[i + k], b = result[i + (k + 1) % 3];
+                ++edgeUses[((uint64_t)std::min(a, b) << 32) | std::max(a, b)];
+            }
+        }
+        for (const auto& [edge, uses] : edgeUses)
+        {
+            if (uses == 2) continue;
+            locked[(unsigned int)(edge >> 32)] = true;
+            locked[(unsigned int)(edge & 0xFFFFFFFFu)] = true;
+        }
+    }
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        const float* p0 = positions + (size_t)result[i] * 3;
+        float normal[3];
+        TriangleNormal(p0, positions + (size_t)result[i + 1] * 3, positions + (size_t)result[i + 2] * 3, normal);
+
+        double length = std::sqrt((double)normal[0] * normal[0] + (double)normal[1] * normal[1] + (double)normal[2] * normal[2]);
+        if (length <= 0.0) continue;
+
+        double a = normal[0] / length, b = normal[1] / length, c = normal[2] / length;
+        double d = -(a * p0[0] + b * p0[1] + c * p0[2]);
+        for (int k = 0; k < 3; ++k) quadrics[result[i + k]].AddPlane(a, b, c, d);
+    }
+
+    const double maxCost = (double)maxError * maxError;
+    double worstCost = 0.0;
+
+    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1);
+    std::vector<unsigned int> adjacency;
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<bool> touched(vertexCount);
+    std::vector<Collapse> collapses;
+
+    // Each pass collapses the cheapest edges whose neighbourhoods don't overlap, then the triangles are rebuilt
+    while (result.size() > targetIndexCount)
+    {
+        const size_t triangleCount = result.size() / 3;
+
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (unsigned int v : result) ++adjacencyOffsets[v + 1];
+        for (unsigned int v = 0; v < vertexCount; ++v) adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+        adjacency.resize(result.size());
+        {
+            std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t t = 0; t < triangleCount; ++t)
+            {
+                for (int k = 0; k < 3; ++k) adjacency[fill[result[t * 3 + k]]++] = (unsigned int)t;
+            }
+        }
+
+        // Every directed edge of a triangle is one candidate, the other direction comes from the triangle on the other side
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                unsigned int from = result[i + k], to = result[i + (k + 1) % 3];
+                if (locked[from]) continue;
+
+                Quadric q = quadrics[from];
+                q.Add(quadrics[to]);
+                double cost = q.Evaluate(positions + (size_t)to * 3);
+                if (cost <= maxCost) collapses.push_back({ from, to, cost });
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        for (unsigned int v = 0; v < vertexCount; ++v) remap[v] = v;
+        std::fill(touched.begin(), touched.end(), false);
+
+        size_t removedIndices = 0;
+        size_t collapsed = 0;
+        for (const Collapse& collapse : collapses)
+        {
+            if (result.size() - removedIndices <= targetIndexCount) break;
+            if (touched[collapse.from] || touched[collapse.to]) continue;
+
+            // The triangles that keep existing can't turn around when their vertex moves
+            bool flips = false;
+            size_t removedTriangles = 0;
+            for (unsigned int a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && !flips; ++a)
+            {
+                const unsigned int* triangle = &result[(size_t)adjacency[a] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                {
+                    ++removedTriangles;
+                    continue;
+                }
+
+                const float* before[3];
+                const float* after[3];
+                for (int k = 0; k < 3; ++k)
+                {
+                    before[k] = positions + (size_t)triangle[k] * 3;
+                    after[k] = (triangle[k] == collapse.from) ? positions + (size_t)collapse.to * 3 : before[k];
+                }
+
+                float normalBefore[3], normalAfter[3];
+                TriangleNormal(before[0], before[1], before[2], normalBefore);
+                TriangleNormal(after[0], after[1], after[2], normalAfter);
+                float dot = normalBefore[0] * normalAfter[0] + normalBefore[1] * normalAfter[1] + normalBefore[2] * normalAfter[2];
+                float lengths = std::sqrt((normalBefore[0] * normalBefore[0] + normalBefore[1] * normalBefore[1] + normalBefore[2] * normalBefore[2]) *
+                    (normalAfter[0] * normalAfter[0] + normalAfter[1] * normalAfter[1] + normalAfter[2] * normalAfter[2]));
+                flips = dot <= MIN_NORMAL_DOT * lengths;
+            }
+            if (flips) continue;
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].Add(quadrics[collapse.from]);
+            worstCost = std::max(worstCost, collapse.cost);
+            removedIndices += removedTriangles * 3;
+            ++collapsed;
+
+            // Nothing else around the moved vertex changes on this pass, so the flip test above stays valid
+            for (unsigned int a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; ++a)
+            {
+                const unsigned int* triangle = &result[(size_t)adjacency[a] * 3];
+                for (int k = 0; k < 3; ++k) touched[triangle[k]] = true;
+            }
+        }
+
+        if (collapsed == 0) break;
+
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            unsigned int a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+            if (a == b || b == c || a == c) continue;
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    error = (float)std::sqrt(worstCost);
+    return result;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Reorders the triangles and the vertices of an indexed triangle list before it's packed and saved on the Library
+// The order is kept on the .rgs, so it's done once per mesh
+namespace MeshOptimizer
+{
+    static const unsigned int INVALID_INDEX = 0xFFFFFFFFu;
+
+    struct CacheStats
+    {
+        float acmr = 0.0f; // Average cache miss ratio, vertex shader runs per triangle, from 0.5 (best) to 3
+        float atvr = 0.0f; // Average transformed vertex ratio, vertex shader runs per vertex, 1 is the best
+    };
+
+    // Simulates a FIFO post-transform cache of cacheSize vertices
+    CacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, unsigned int vertexCount, unsigned int cacheSize = 16);
+
+    // Linear-speed vertex cache optimization (Forsyth), rewrites the triangle order of indices
+    void OptimizeVertexCache(unsigned int* indices, size_t indexCount, unsigned int vertexCount);
+
+    // Numbers the vertices in the order the triangles use them, so the fetches go forward in memory
+    // Rewrites indices and returns the new position of each old vertex (INVALID_INDEX if no triangle uses it)
+    std::vector<unsigned int> OptimizeVertexFetch(unsigned int* indices, size_t indexCount, unsigned int vertexCount, unsigned int& newVertexCount);
+
+    // Moves the vertices of a stream with components floats per vertex to the positions of the remap
+    void RemapVertices(float* destination, const float* source, unsigned int components, const std::vector<unsigned int>& remap);
+
+    // Quadric error edge collapse towards targetIndexCount, a vertex is only merged on one of its neighbours
+    // so the result uses the same vertex buffer. Stops before a collapse that moves the surface more than maxError
+    // The vertices on borders, seams and non manifold edges don't move. error gets the largest one of the collapses done
+    std::vector<unsigned int> Simplify(const unsigned int* indices, size_t indexCount, const float* positions, unsigned int vertexCount,
+        size_t targetIndexCount, float maxError, float& error);
+}
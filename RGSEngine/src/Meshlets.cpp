@@ -0,0 +1,204 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const unsigned int NO_MESHLET = 0xFFFFFFFFu;
+
+// Wider cones than this almost never face away from the camera, they are not worth testing
+static const float MIN_CONE_DOT = 0.1f;
+
+static glm::vec3 GetPosition(const float* positions, unsigned int vertex)
+{
+    return glm::vec3(positions[vertex * 3], positions[vertex * 3 + 1], positions[vertex * 3 + 2]);
+}
+
+static Meshlet ComputeMeshletBounds(const unsigned int* indices, uint32_t firstIndex, uint32_t indexCount, const float* positions)
+{
+    Meshlet meshlet;
+    meshlet.firstIndex = firstIndex;
+    meshlet.indexCount = indexCount;
+
+    glm::vec3 minPosition(INFINITY), maxPosition(-INFINITY);
+    for (uint32_t i = firstIndex; i < firstIndex + indexCount; ++i)
+    {
+        glm::vec3 position = GetPosition(positions, indices[i]);
+        minPosition = glm::min(minPosition, position);
+        maxPosition = glm::max(maxPosition, position);
+    }
+
+    glm::vec3 center = (minPosition + maxPosition) * 0.5f;
+    float radius = 0.0f;
+    for (uint32_t i = firstIndex; i < firstIndex + indexCount; ++i)
+    {
+        radius = std::max(radius, glm::length(GetPosition(positions, indices[i]) - center));
+    }
+
+    meshlet.center[0] = center.x;
+    meshlet.center[1] = center.y;
+    meshlet.center[2] = center.z;
+    meshlet.radius = radius;
+
+    // The axis is the average of the face normals, the cone has to reach the one furthest from it
+    std::vector<glm::vec3> normals;
+    normals.reserve(indexCount / 3);
+    glm::vec3 normalSum(0.0f);
+    for (uint32_t i = firstIndex; i < firstIndex + indexCount; i += 3)
+    {
+        glm::vec3 a = GetPosition(positions, indices[i]);
+        glm::vec3 b = GetPosition(positions, indices[i + 1]);
+        glm::vec3 c = GetPosition(positions, indices[i + 2]);
+
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        float length = glm::length(normal);
+        if (length <= 0.0f) continue;
+
+        normals.push_back(normal / length);
+        normalSum += normals.back();
+    }
+
+    float sumLength = glm::length(normalSum);
+    if (normals.empty() || sumLength <= 0.0f) return meshlet;
+
+    glm::vec3 axis = normalSum / sumLength;
+    float minDot = 1.0f;
+    for (const glm::vec3& normal : normals) minDot = std::min(minDot, glm::dot(normal, axis));
+
+    meshlet.coneAxis[0] = axis.x;
+    meshlet.coneAxis[1] = axis.y;
+    meshlet.coneAxis[2] = axis.z;
+    meshlet.coneCutoff = (minDot <= MIN_CONE_DOT) ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+    return meshlet;
+}
+
+std::vector<Meshlet> MeshletBuilder::Build(unsigned int* indices, size_t indexCount, const float* positions, unsigned int vertexCount)
+{
+    std::vector<Meshlet> meshlets;
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0 || vertexCount == 0) return meshlets;
+
+    // Triangles of each vertex, the ones already in a meshlet are moved past the remaining count
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i) ++remaining[indices[i]];
+
+    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+    for (unsigned int v = 0; v < vertexCount; ++v) adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remaining[v];
+
+    std::vector<unsigned int> adjacency(triangleCount * 3);
+    {
+        std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            for (int k = 0; k < 3; ++k) adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+        }
+    }
+
+    // Last meshlet that used each vertex, so the new vertices of a triangle are counted without a set
+    std::vector<unsigned int> vertexMeshlet(vertexCount, NO_MESHLET);
+    std::vector<bool> assigned(triangleCount, false);
+
+    std::vector<unsigned int> output;
+    output.reserve(triangleCount * 3);
+
+    std::vector<unsigned int> meshletTriangles;
+    std::vector<unsigned int> meshletVertices;
+    meshletTriangles.reserve(MAX_TRIANGLES);
+    meshletVertices.reserve(MAX_VERTICES);
+
+    unsigned int currentMeshlet = 0;
+    size_t scanCursor = 0;
+
+    auto CountNewVertices = [&](size_t t)
+        {
+            unsigned int count = 0;
+            for (int k = 0; k < 3; ++k)
+            {
+                if (vertexMeshlet[indices[t * 3 + k]] != currentMeshlet) ++count;
+            }
+            return count;
+        };
+
+    auto FlushMeshlet = [&]()
+        {
+            if (meshletTriangles.empty()) return;
+
+            std::sort(meshletTriangles.begin(), meshletTriangles.end());
+
+            uint32_t firstIndex = (uint32_t)output.size();
+            for (unsigned int t : meshletTriangles) output.insert(output.end(), &indices[t * 3], &indices[t * 3] + 3);
+
+            meshlets.push_back(ComputeMeshletBounds(output.data(), firstIndex, (uint32_t)output.size() - firstIndex, positions));
+
+            meshletTriangles.clear();
+            meshletVertices.clear();
+            ++currentMeshlet;
+        };
+
+    for (size_t assignedCount = 0; assignedCount < triangleCount; ++assignedCount)
+    {
+        // The neighbour that adds the fewest vertices, on a tie the first one on the original order
+        size_t best = triangleCount;
+        unsigned int bestNew = 4;
+        for (unsigned int vertex : meshletVertices)
+        {
+            for (unsigned int a = 0; a < remaining[vertex]; ++a)
+            {
+                unsigned int t = adjacency[adjacencyOffsets[vertex] + a];
+                unsigned int newVertices = CountNewVertices(t);
+                if (newVertices < bestNew || (newVertices == bestNew && t < best))
+                {
+                    best = t;
+                    bestNew = newVertices;
+                }
+            }
+        }
+
+        // Nothing connected left, the next triangle on the original order is usually close anyway
+        if (best == triangleCount)
+        {
+            while (assigned[scanCursor]) ++scanCursor;
+            best = scanCursor;
+            bestNew = CountNewVertices(best);
+        }
+
+        if (meshletTriangles.size() == MAX_TRIANGLES || meshletVertices.size() + bestNew > MAX_VERTICES)
+        {
+            FlushMeshlet();
+        }
+
+        assigned[best] = true;
+        meshletTriangles.push_back((unsigned int)best);
+
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int vertex = indices[best * 3 + k];
+            if (vertexMeshlet[vertex] != currentMeshlet)
+            {
+                vertexMeshlet[vertex] = currentMeshlet;
+                meshletVertices.push_back(vertex);
+            }
+
+            unsigned int* begin = &adjacency[adjacencyOffsets[vertex]];
+            unsigned int* end = begin + remaining[vertex];
+            std::swap(*std::find(begin, end, (unsigned int)best), *(end - 1));
+            --remaining[vertex];
+        }
+    }
+
+    FlushMeshlet();
+
+    std::copy(output.begin(), output.end(), indices);
+    return meshlets;
+}
+
+bool MeshletBuilder::IsBackfacing(const Meshlet& meshlet, const glm::vec3& cameraPosition)
+{
+    if (meshlet.coneCutoff >= 1.0f) return false;
+
+    glm::vec3 center(meshlet.center[0], meshlet.center[1], meshlet.center[2]);
+    glm::vec3 axis(meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2]);
+
+    // Every point of the sphere sees the faces from behind
+    glm::vec3 toCenter = center - cameraPosition;
+    return glm::dot(toCenter, axis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Cluster of triangles of a mesh, culled on its own by Render
+// The triangles of a meshlet are contiguous on the index buffer, so it's drawn as a range of indices
+// Stored as it is on the meshlet section of the .rgs files
+struct Meshlet
+{
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+
+    // Bounding sphere in the local space of the mesh
+    float center[3] = { 0.0f, 0.0f, 0.0f };
+    float radius = 0.0f;
+
+    // All the triangle normals are inside the cone around the axis
+    // cutoff is the sine of its half angle, 1 when the cone is too wide to cull anything
+    float coneAxis[3] = { 0.0f, 0.0f, 1.0f };
+    float coneCutoff = 1.0f;
+};
+
+static_assert(sizeof(Meshlet) == 40, "The meshlets are read directly from the .rgs file");
+
+namespace MeshletBuilder
+{
+    // Around the sizes the GPUs work best with, small enough to cull a part of a big mesh
+    static const unsigned int MAX_VERTICES = 64;
+    static const unsigned int MAX_TRIANGLES = 124;
+
+    // Groups neighbouring triangles and rewrites indices so the triangles of each meshlet go together
+    // The original order is kept inside each meshlet, so the vertex cache optimization is not lost
+    std::vector<Meshlet> Build(unsigned int* indices, size_t indexCount, const float* positions, unsigned int vertexCount);
+
+    // True if no triangle of the meshlet can face a camera at cameraPosition, both in the local space of the mesh
+    bool IsBackfacing(const Meshlet& meshlet, const glm::vec3& cameraPosition);
+}
@@ -26,6 +26,13 @@
 #include "ImGuizmo.h"
 #include "LoadFiles.h"
 #include "Time.h"
+#include "TransformSystem.h"
+#include "JobSystem.h"
+#include "ModuleResources.h"
+#include "ResourceMesh.h"
+#include "ResourceTexture.h"
+#include "GeometryPool.h"
+#include "TextureFormat.h"
 
 #include <IL/il.h>
 #include <glm/gtc/type_ptr.hpp>
@@ -263,6 +270,15 @@ bool ModuleEditor::Update(float dt)
         }
     }
 
+    // --- PICKING ---
+    // Left click on the scene selects the object under the mouse, except when the click is for ImGui, the gizmo or the orbit
+    ImGuiIO& io = ImGui::GetIO();
+    bool gizmoHovered = (targetTransform != nullptr) && (ImGuizmo::IsOver() || ImGuizmo::IsUsing());
+    if (ImGui::IsMouseClicked(ImGuiMouseButton_Left) && !io.WantCaptureMouse && !gizmoHovered && !input->IsAltPressed())
+    {
+        selectedGameObject = PickGameObject(io.MousePos.x, io.MousePos.y, viewport->Pos.x, viewport->Pos.y, viewport->Size.x, viewport->Size.y);
+    }
+
     // --- WINDOWS ---
     // Main menu is drawed inside ImGui::Begin
     DrawMainMenuBar();
@@ -307,6 +323,12 @@ bool ModuleEditor::Update(float dt)
     if (showTimeDebugWindow)
         DrawTimeDebugWindow();
 
+    if (showResourcesWindow)
+        DrawResourcesWindow();
+
+    if (!Application::GetInstance().loadFiles->GetImports().empty())
+        DrawImportsWindow();
+
     // Close the container window
     ImGui::End();
 
@@ -373,6 +395,7 @@ void ModuleEditor::DrawMainMenuBar()
             ImGui::MenuItem("Configuration", NULL, &showConfigurationWindow);
             ImGui::MenuItem("Console", NULL, &showConsoleWindow);
             ImGui::MenuItem("Time Debug", NULL, &showTimeDebugWindow);
+            ImGui::MenuItem("Resources", NULL, &showResourcesWindow);
 
             ImGui::Separator();
 
@@ -782,18 +805,23 @@ void ModuleEditor::DrawInspectorWindow()
             ComponentTransform* transform = static_cast<ComponentTransform*>(component.get());
             if (ImGui::CollapsingHeader("Transform", ImGuiTreeNodeFlags_DefaultOpen))
             {
-                if (ImGui::DragFloat3("Position", (float*)&transform->position, 0.1f))
+                // Edit copies and apply them with the setters, the values live on the TransformSystem
+                glm::vec3 position = transform->GetPosition();
+                if (ImGui::DragFloat3("Position", (float*)&position, 0.1f))
                 {
+                    transform->SetPosition(position);
                 }
 
-                glm::vec3 eulerAngles = glm::degrees(glm::eulerAngles(transform->rotation));
+                glm::vec3 eulerAngles = glm::degrees(glm::eulerAngles(transform->GetRotation()));
                 if (ImGui::DragFloat3("Rotation", (float*)&eulerAngles, 1.0f))
                 {
                     transform->SetRotation(glm::quat(glm::radians(eulerAngles)));
                 }
 
-                if (ImGui::DragFloat3("Scale", (float*)&transform->scale, 0.1f))
+                glm::vec3 scale = transform->GetScale();
+                if (ImGui::DragFloat3("Scale", (float*)&scale, 0.1f))
                 {
+                    transform->SetScale(scale);
                 }
             }
             break;
@@ -821,8 +849,19 @@ void ModuleEditor::DrawInspectorWindow()
                 }
                 ImGui::Separator();
 
-                ImGui::Text("Index Count: %d", mesh->indexCount);
-                ImGui::Text("VAO: %d, VBO: %d, IBO: %d", mesh->VAO, mesh->VBO, mesh->IBO);
+                ResourceMesh* resource = mesh->resource.get();
+                if (resource != nullptr)
+                {
+                    ImGui::Text("Index Count: %d", resource->indexCount);
+                    for (size_t lod = 1; lod < resource->lods.size(); ++lod)
+                    {
+                        ImGui::Text("LOD %d: %d triangles, error %.4f", (int)lod, (int)(resource->lods[lod].indexCount / 3), resource->lods[lod].error);
+                    }
+                    if (resource->lods.size() > 1) ImGui::Text("Current LOD: %d", mesh->lodLevel);
+                    ImGui::Text("VAO: %d, base vertex: %d, first index: %d", resource->VAO, resource->allocation.baseVertex, resource->allocation.firstIndex);
+                    ImGui::Text("Vertex size: %d bytes, %d bit indices", resource->vertexStride, (resource->indexType == GL_UNSIGNED_SHORT) ? 16 : 32);
+                    ImGui::Text("Shared by: %d components", (int)mesh->resource.use_count());
+                }
 
                 ImGui::Separator();
                 if (ImGui::Button("Select Mesh..."))
@@ -836,11 +875,11 @@ void ModuleEditor::DrawInspectorWindow()
 
                 ImGui::Separator();
 
-                if (mesh->normalsVAO != 0)
+                if (resource != nullptr && resource->normalsVAO != 0)
                 {
                     ImGui::Checkbox("Show Vertex Normals", &Application::GetInstance().render->drawVertexNormals);
                 }
-                if (mesh->faceNormalsVAO != 0)
+                if (resource != nullptr && resource->faceNormalsVAO != 0)
                 {
                     ImGui::Checkbox("Show Face Normals", &Application::GetInstance().render->drawFaceNormals);
                 }
@@ -885,7 +924,12 @@ void ModuleEditor::DrawInspectorWindow()
                 ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.5f, 0.5f, 0.5f, 1.0f));
                 ImGui::Text("Internal: %s", texture->libraryPath.c_str());
                 ImGui::PopStyleColor();
-                ImGui::Text("Size: %d x %d", texture->width, texture->height);
+                if (texture->resource != nullptr && !texture->resource->IsReady())
+                    ImGui::Text("Size: Loading...");
+                else if (texture->resource != nullptr)
+                    ImGui::Text("Size: %d x %d", texture->resource->width, texture->resource->height);
+                else
+                    ImGui::Text("Size: %d x %d", texture->width, texture->height);
                 ImGui::Text("Texture ID: %d", texture->textureID);
 
                 ImGui::SameLine();
@@ -1032,6 +1076,7 @@ void ModuleEditor::DrawConsoleWindow()
     // Button to clear the console
     if (ImGui::Button("Clear"))
     {
+        std::lock_guard<std::mutex> lock(GetLogMutex());
         consoleStream.str(""); // Clear the stringstream
         consoleStream.clear(); // Clear the state flags
     }
@@ -1040,8 +1085,13 @@ void ModuleEditor::DrawConsoleWindow()
     // Scroll on the console
     ImGui::BeginChild("ScrollingRegion");
 
-    // Show the text
-    ImGui::TextUnformatted(consoleStream.str().c_str());
+    // Show the text, copied under the lock because the workers can be logging
+    std::string consoleText;
+    {
+        std::lock_guard<std::mutex> lock(GetLogMutex());
+        consoleText = consoleStream.str();
+    }
+    ImGui::TextUnformatted(consoleText.c_str());
 
     // Auto-scroll if we are next to the end
     if (ImGui::GetScrollY() >= ImGui::GetScrollMaxY())
@@ -1081,6 +1131,127 @@ void ModuleEditor::DrawConfigurationWindow()
             ImGui::SliderFloat("Camera Speed", &render->cameraSpeed, 0.1f, 10.0f);
             ImGui::SliderFloat("Camera Sensitivity", &render->cameraSensitivity, 0.01f, 1.0f);
             ImGui::SliderFloat("Camera FOV", &render->cameraFOV, 1.0f, 120.0f);
+
+            ImGui::Separator();
+            ImGui::Checkbox("Frustum Culling", &render->frustumCulling);
+            ImGui::Text("Visible meshes: %u", render->visibleMeshes);
+            ImGui::Text("Culled meshes: %u", render->culledMeshes);
+            ImGui::Checkbox("Cluster Culling", &render->clusterCulling);
+            ImGui::Checkbox("Backface Culling", &render->backfaceCulling);
+            if (ImGui::IsItemHovered())
+            {
+                ImGui::SetTooltip("Hides the back faces of the opaque meshes and culls the meshlets facing away");
+            }
+            ImGui::Text("Meshlets: %u visible, %u culled", render->visibleClusters, render->culledClusters);
+            ImGui::Checkbox("LOD Selection", &render->lodSelection);
+            ImGui::SliderFloat("LOD Screen Size", &render->lodScreenSize, 0.01f, 1.0f);
+            if (ImGui::IsItemHovered())
+            {
+                ImGui::SetTooltip("Fraction of the screen height under which the first LOD is used, each next one at half of it");
+            }
+            ImGui::SliderFloat("LOD Hysteresis", &render->lodHysteresis, 0.0f, 0.5f);
+            ImGui::Text("Triangles: %u", render->renderedTriangles);
+            ImGui::Checkbox("Multi-Draw Indirect", &render->indirectRendering);
+            if (ImGui::IsItemHovered())
+            {
+                ImGui::SetTooltip("Draws the opaque meshes with one glMultiDrawElementsIndirect per texture");
+            }
+            ImGui::Text("Draw calls: %u (%u instanced)", render->drawCalls, render->instancedDrawCalls);
+            ImGui::Text("Multi-draw commands: %u", render->multiDrawCommands);
+            if (render->indirectRendering)
+            {
+                ImGui::Checkbox("GPU Culling", &render->gpuCulling);
+                if (ImGui::IsItemHovered())
+                {
+                    ImGui::SetTooltip("Compute shader frustum and occlusion test of the opaque objects, the CPU frustum culling still runs before it");
+                }
+                if (render->gpuCulling)
+                {
+                    ImGui::Checkbox("Occlusion Culling", &render->occlusionCulling);
+                    ImGui::Text("Instances: %u visible, %u outside, %u occluded", render->gpuVisibleInstances, render->gpuFrustumCulled, render->gpuOccluded);
+                    ImGui::Checkbox("Validate GPU Culling", &render->validateGpuCulling);
+                    if (ImGui::IsItemHovered())
+                    {
+                        ImGui::SetTooltip("Reads back the results every frame and compares them with the CPU reference, slow");
+                    }
+                    if (render->validateGpuCulling) ImGui::Text("Mismatches: %u", render->gpuCullingMismatches);
+                }
+            }
+            const char* occluderModes[] = { "Off", "GPU Hi-Z", "Software" };
+            ImGui::Combo("Occluders", &render->occluderMode, occluderModes, IM_ARRAYSIZE(occluderModes));
+            if (ImGui::IsItemHovered())
+            {
+                ImGui::SetTooltip("Draws the depth of the largest opaque meshes first and skips the meshes hidden behind it");
+            }
+            if (render->occluderMode != OCCLUDERS_OFF)
+            {
+                ImGui::SliderFloat("Occluder Screen Size", &render->occluderScreenSize, 0.01f, 1.0f);
+                ImGui::SliderInt("Max Occluders", &render->maxOccluders, 1, 128);
+                ImGui::Text("Occluders: %u (%u triangles)", render->occluders, render->occluderTriangles);
+                ImGui::Text("Occluded meshes: %u", render->occludedMeshes);
+                ImGui::Text("Occlusion CPU time: %.3f ms", render->occlusionTimeMs);
+                if (render->occluderMode == OCCLUDERS_GPU)
+                {
+                    ImGui::Text("Occlusion GPU time: %.3f ms", render->occlusionGpuTimeMs);
+                    if (ImGui::IsItemHovered())
+                    {
+                        ImGui::SetTooltip("Depth pass of the occluders and reduction to the pyramid, measured a few frames late");
+                    }
+                }
+            }
+            ImGui::Text("State changes: %u", render->stateChanges);
+
+            ImGui::Separator();
+            ImGui::Checkbox("Quantize Mesh Positions", &ResourceMesh::quantizePositions);
+            if (ImGui::IsItemHovered())
+            {
+                ImGui::SetTooltip("16 bit positions for the meshes imported from now on");
+            }
+            ImGui::Checkbox("Optimize Vertex Cache", &ResourceMesh::optimizeVertexCache);
+            if (ImGui::IsItemHovered())
+            {
+                ImGui::SetTooltip("Reorder the triangles and vertices of the meshes imported from now on");
+            }
+            ImGui::Checkbox("Generate LODs", &ResourceMesh::generateLods);
+            if (ImGui::IsItemHovered())
+            {
+                ImGui::SetTooltip("Simplified levels for the meshes imported from now on");
+            }
+            ImGui::Checkbox("Compress Textures (BC1/BC3)", &ResourceTexture::compressOnImport);
+            if (ImGui::IsItemHovered())
+            {
+                ImGui::SetTooltip("Block compressed textures for the ones imported from now on, BC3 if they have alpha");
+            }
+            ImGui::TreePop();
+        }
+        if (ImGui::TreeNode("Scene BVH"))
+        {
+            ModuleScene* scene = Application::GetInstance().scene.get();
+            const BVH& bvh = scene->GetBVH();
+            ImGui::Text("Proxies: %d", bvh.GetProxyCount());
+            ImGui::Text("Height: %d", bvh.GetHeight());
+            ImGui::Text("SAH Cost: %.2f", bvh.ComputeCost());
+            if (ImGui::Button("Rebuild"))
+            {
+                scene->RebuildBVH();
+            }
+            ImGui::TreePop();
+        }
+        if (ImGui::TreeNode("Transforms"))
+        {
+            TransformSystem& transforms = TransformSystem::GetInstance();
+            ImGui::Text("Transforms: %u", transforms.GetCount());
+            ImGui::Text("Updated last frame: %u", transforms.GetLastUpdatedCount());
+            ImGui::Text("Update time: %.3f ms", transforms.GetLastUpdateMs());
+            ImGui::Text("Worker threads: %u", JobSystem::GetInstance().GetWorkerCount());
+            ImGui::TreePop();
+        }
+        if (ImGui::TreeNode("Import"))
+        {
+            LoadFiles* loadFiles = Application::GetInstance().loadFiles.get();
+            ImGui::SliderFloat("Upload Budget (ms)", &loadFiles->importBudgetMs, 0.5f, 16.0f);
+            ImGui::Text("Imports running: %d", (int)loadFiles->GetImports().size());
+            ImGui::Text("Sources on the asset database: %d", (int)loadFiles->assetDatabase.GetSourceCount());
             ImGui::TreePop();
         }
         if (ImGui::TreeNode("Window"))
@@ -1239,6 +1410,60 @@ void ModuleEditor::DrawAboutWindow()
     ImGui::End();
 }
 
+GameObject* ModuleEditor::PickGameObject(float mouseX, float mouseY, float viewportX, float viewportY, float viewportWidth, float viewportHeight)
+{
+    if (viewportWidth <= 0.0f || viewportHeight <= 0.0f) return nullptr;
+
+    // Mouse position to Normalized Device Coordinates, Y goes up on NDC
+    float ndcX = 2.0f * (mouseX - viewportX) / viewportWidth - 1.0f;
+    float ndcY = 1.0f - 2.0f * (mouseY - viewportY) / viewportHeight;
+
+    // Unproject the points on the near and far planes to obtain the ray in world space
+    const glm::mat4& viewMatrix = Application::GetInstance().render->GetViewMatrix();
+    const glm::mat4& projectionMatrix = Application::GetInstance().render->GetProjectionMatrix();
+    glm::mat4 inverseViewProjection = glm::inverse(projectionMatrix * viewMatrix);
+
+    glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+    nearPoint /= nearPoint.w;
+    farPoint /= farPoint.w;
+
+    glm::vec3 origin = glm::vec3(nearPoint);
+    Ray ray(origin, glm::normalize(glm::vec3(farPoint) - origin));
+
+    GameObject* closest = nullptr;
+
+    // Broad phase on the BVH of the scene, the narrow phase tests the triangles of each mesh in its local space
+    // The direction is not normalized after the transform, so the distance along the local ray is the same as in world
+    Application::GetInstance().scene->GetBVH().QueryRay(ray, FLT_MAX, [&](GameObject* go, float maxDistance)
+        {
+            for (GameObject* current = go; current != nullptr; current = current->GetParent())
+            {
+                if (!current->IsActive()) return maxDistance;
+            }
+
+            ComponentMesh* mesh = go->GetComponent<ComponentMesh>();
+            ComponentTransform* transform = go->GetComponent<ComponentTransform>();
+            if (mesh == nullptr || transform == nullptr) return maxDistance;
+
+            glm::mat4 inverseWorld = glm::inverse(transform->GetWorldMatrix());
+            Ray localRay(glm::vec3(inverseWorld * glm::vec4(ray.origin, 1.0f)), glm::vec3(inverseWorld * glm::vec4(ray.direction, 0.0f)));
+
+            float distance;
+            if (!mesh->RayCast(localRay, maxDistance, distance)) return maxDistance;
+
+            closest = go;
+            return distance;
+        });
+
+    if (closest != nullptr)
+    {
+        LOG("Picked GameObject: %s", closest->GetName().c_str());
+    }
+
+    return closest;
+}
+
 void ModuleEditor::UpdateMemoryStats()
 {
     if (isNVIDIA)
@@ -1329,4 +1554,173 @@ void ModuleEditor::DrawTimeDebugWindow()
     }
 
     ImGui::End();
-}
\ No newline at end of file
+}
+
+void ModuleEditor::DrawResourcesWindow()
+{
+    if (!ImGui::Begin("Resources", &showResourcesWindow))
+    {
+        ImGui::End();
+        return;
+    }
+
+    std::vector<std::shared_ptr<ResourceMesh>> meshes = Application::GetInstance().resources->GetMeshes();
+
+    size_t totalGPU = 0;
+    size_t totalCPU = 0;
+    for (const auto& mesh : meshes)
+    {
+        totalGPU += mesh->GetGPUBytes();
+        totalCPU += mesh->GetCPUBytes();
+    }
+
+    ImGui::Text("Meshes loaded: %d", (int)meshes.size());
+    ImGui::Text("GPU memory: %.2f MB", totalGPU / (1024.0f * 1024.0f));
+    ImGui::Text("CPU memory: %.2f MB", totalCPU / (1024.0f * 1024.0f));
+
+    // The meshes share the buffers of the pools, the capacity not used yet is on the GPU too
+    size_t poolUsed = 0;
+    size_t poolCapacity = 0;
+    const auto& pools = Application::GetInstance().resources->GetGeometryPools();
+    for (const auto& pool : pools)
+    {
+        poolUsed += pool.second->GetUsedBytes();
+        poolCapacity += pool.second->GetCapacityBytes();
+    }
+    ImGui::Text("Geometry pools: %d, %.2f of %.2f MB used", (int)pools.size(), poolUsed / (1024.0f * 1024.0f), poolCapacity / (1024.0f * 1024.0f));
+    ImGui::Separator();
+
+    if (ImGui::BeginTable("MeshResources", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable))
+    {
+        ImGui::TableSetupColumn("Library Path");
+        ImGui::TableSetupColumn("References");
+        ImGui::TableSetupColumn("Vertices");
+        ImGui::TableSetupColumn("Indices");
+        ImGui::TableSetupColumn("GPU KB");
+        ImGui::TableHeadersRow();
+
+        for (const auto& mesh : meshes)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", mesh->libraryPath.c_str());
+            ImGui::TableNextColumn();
+            // Without the copy of the list, only the components
+            ImGui::Text("%d", (int)mesh.use_count() - 1);
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", mesh->vertexCount);
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", mesh->indexCount);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", mesh->GetGPUBytes() / 1024.0f);
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::Separator();
+
+    std::vector<std::shared_ptr<ResourceTexture>> textures = Application::GetInstance().resources->GetTextures();
+
+    // What the textures would use if each component had uploaded its own copy
+    size_t textureVRAM = 0;
+    size_t textureVRAMWithoutSharing = 0;
+    size_t textureVRAMUncompressed = 0;
+    for (const auto& texture : textures)
+    {
+        textureVRAM += texture->GetGPUBytes();
+        textureVRAMWithoutSharing += texture->GetGPUBytes() * (texture.use_count() - 1);
+        textureVRAMUncompressed += (size_t)texture->width * texture->height * 4 * 4 / 3;
+    }
+
+    ImGui::Text("Textures loaded: %d", (int)textures.size());
+    ImGui::Text("VRAM: %.2f MB (%.2f MB without sharing)", textureVRAM / (1024.0f * 1024.0f), textureVRAMWithoutSharing / (1024.0f * 1024.0f));
+    ImGui::Text("As RGBA8: %.2f MB", textureVRAMUncompressed / (1024.0f * 1024.0f));
+    ImGui::Separator();
+
+    if (ImGui::BeginTable("TextureResources", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable))
+    {
+        ImGui::TableSetupColumn("Source");
+        ImGui::TableSetupColumn("References");
+        ImGui::TableSetupColumn("ID");
+        ImGui::TableSetupColumn("Size");
+        ImGui::TableSetupColumn("Format");
+        ImGui::TableSetupColumn("VRAM KB");
+        ImGui::TableHeadersRow();
+
+        for (const auto& texture : textures)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", texture->sourcePath.c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%d", (int)texture.use_count() - 1);
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", texture->textureID);
+            ImGui::TableNextColumn();
+            if (texture->IsReady())
+                ImGui::Text("%d x %d", texture->width, texture->height);
+            else
+                ImGui::Text("Loading");
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", TextureFormat::GetEncodingName(texture->encoding));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", texture->GetGPUBytes() / 1024.0f);
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::End();
+}
+
+void ModuleEditor::DrawImportsWindow()
+{
+    if (!ImGui::Begin("Imports"))
+    {
+        ImGui::End();
+        return;
+    }
+
+    LoadFiles* loadFiles = Application::GetInstance().loadFiles.get();
+    FBXImport* cancelledImport = nullptr;
+
+    for (const auto& import : loadFiles->GetImports())
+    {
+        ImGui::PushID(import.get());
+
+        ImGui::Text("%s", import->name.c_str());
+        ImGui::SameLine();
+        ImGui::TextDisabled("(%s)", import->cancelled ? "Cancelling" : import->GetStateName());
+
+        if (import->state == FBXImport::State::PROCESSING_MESHES)
+        {
+            ImGui::Text("Meshes: %u processed, %u uploaded of %d", import->processedMeshes.load(), import->uploadedMeshes, (int)import->jobMeshes.size());
+        }
+
+        ImGui::ProgressBar(import->GetProgress(), ImVec2(-80.0f, 0.0f));
+        ImGui::SameLine();
+
+        ImGui::BeginDisabled(import->cancelled);
+        if (ImGui::Button("Cancel"))
+        {
+            cancelledImport = import.get();
+        }
+        ImGui::EndDisabled();
+
+        ImGui::PopID();
+    }
+
+    if (cancelledImport != nullptr)
+    {
+        // The placeholder and its children are removed, the selection can't point to them
+        std::shared_ptr<GameObject> placeholder = cancelledImport->placeholder.lock();
+        if (placeholder != nullptr && selectedGameObject != nullptr &&
+            (selectedGameObject == placeholder.get() || placeholder->IsAncestorOf(selectedGameObject)))
+        {
+            selectedGameObject = nullptr;
+        }
+
+        loadFiles->CancelImport(cancelledImport);
+    }
+
+    ImGui::End();
+}
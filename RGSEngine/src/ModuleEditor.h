@@ -37,6 +37,9 @@ private:
 
     void ApplyDefaultDockingLayout();
 
+    // Selects the object under the mouse on the scene viewport, nullptr if the ray doesn't hit any mesh
+    GameObject* PickGameObject(float mouseX, float mouseY, float viewportX, float viewportY, float viewportWidth, float viewportHeight);
+
     ImGuizmo::OPERATION mCurrentGizmoOperation;
     ImGuizmo::MODE mCurrentGizmoMode;
 
@@ -55,6 +58,13 @@ private:
     bool showTimeDebugWindow = false;
     void DrawTimeDebugWindow();
 
+    // Meshes and textures on the resources cache with their references and memory
+    bool showResourcesWindow = false;
+    void DrawResourcesWindow();
+
+    // Progress of the FBX imports running in the background, shown only while there are some
+    void DrawImportsWindow();
+
     // Buffer for the console
     std::streambuf* oldCerrStreamBuf;
     std::stringstream consoleStream;
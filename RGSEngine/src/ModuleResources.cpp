@@ -0,0 +1,153 @@
+#include "ModuleResources.h"
+#include "ResourceMesh.h"
+#include "ResourceTexture.h"
+#include "GeometryPool.h"
+#include "Log.h"
+
+#include <filesystem>
+#include <algorithm>
+#include <cctype>
+
+ModuleResources::ModuleResources()
+{
+    name = "resources";
+}
+
+ModuleResources::~ModuleResources()
+{
+}
+
+bool ModuleResources::CleanUp()
+{
+    LOG("Cleaning up Resources");
+
+    // The scene is already cleared, anything still alive here is held by someone else
+    for (const auto& mesh : GetMeshes())
+    {
+        LOG("Resource still in use on CleanUp: %s (%d references)", mesh->libraryPath.c_str(), (int)mesh.use_count() - 1);
+    }
+    for (const auto& texture : GetTextures())
+    {
+        LOG("Resource still in use on CleanUp: %s (%d references)", texture->sourcePath.c_str(), (int)texture.use_count() - 1);
+    }
+
+    meshes.clear();
+    textures.clear();
+    geometryPools.clear();
+    return true;
+}
+
+std::shared_ptr<ResourceMesh> ModuleResources::FindMesh(const std::string& libraryPath)
+{
+    if (libraryPath.empty()) return nullptr;
+
+    auto it = meshes.find(libraryPath);
+    if (it == meshes.end()) return nullptr;
+
+    std::shared_ptr<ResourceMesh> mesh = it->second.lock();
+    if (mesh == nullptr) meshes.erase(it);
+    return mesh;
+}
+
+std::shared_ptr<ResourceMesh> ModuleResources::LoadMesh(const std::string& libraryPath,
+    const float* vertices, unsigned int numVertices,
+    const unsigned int* indices, unsigned int numIndices,
+    const float* texCoords, const float* normals)
+{
+    std::shared_ptr<ResourceMesh> mesh = FindMesh(libraryPath);
+    if (mesh != nullptr)
+    {
+        LOG("Resources: Reusing mesh already on GPU: %s", libraryPath.c_str());
+        return mesh;
+    }
+
+    PackedMesh packed = VertexFormat::Pack(vertices, numVertices, indices, numIndices, texCoords, normals, ResourceMesh::quantizePositions);
+    return LoadMesh(libraryPath, packed.GetView());
+}
+
+std::shared_ptr<ResourceMesh> ModuleResources::LoadMesh(const std::string& libraryPath, const PackedMeshView& packed)
+{
+    std::shared_ptr<ResourceMesh> mesh = FindMesh(libraryPath);
+    if (mesh != nullptr)
+    {
+        LOG("Resources: Reusing mesh already on GPU: %s", libraryPath.c_str());
+        return mesh;
+    }
+
+    mesh = std::make_shared<ResourceMesh>(libraryPath);
+    mesh->Load(packed, GetGeometryPool(packed.flags));
+
+    if (!libraryPath.empty()) meshes[libraryPath] = mesh;
+    return mesh;
+}
+
+std::shared_ptr<GeometryPool> ModuleResources::GetGeometryPool(uint32_t flags)
+{
+    std::shared_ptr<GeometryPool>& pool = geometryPools[GeometryPool::GetLayoutKey(flags)];
+    if (pool == nullptr) pool = std::make_shared<GeometryPool>(flags);
+    return pool;
+}
+
+std::vector<std::shared_ptr<ResourceMesh>> ModuleResources::GetMeshes()
+{
+    std::vector<std::shared_ptr<ResourceMesh>> alive;
+    for (auto it = meshes.begin(); it != meshes.end();)
+    {
+        std::shared_ptr<ResourceMesh> mesh = it->second.lock();
+        if (mesh == nullptr)
+        {
+            it = meshes.erase(it);
+            continue;
+        }
+        alive.push_back(mesh);
+        ++it;
+    }
+    return alive;
+}
+
+std::string ModuleResources::GetTextureKey(const std::string& sourcePath)
+{
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(sourcePath, error);
+    std::string key = error ? sourcePath : canonical.generic_string();
+
+#ifdef _WIN32
+    // The paths are not case sensitive on Windows
+    std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+#endif
+
+    return key;
+}
+
+std::shared_ptr<ResourceTexture> ModuleResources::FindTexture(const std::string& key)
+{
+    auto it = textures.find(key);
+    if (it == textures.end()) return nullptr;
+
+    std::shared_ptr<ResourceTexture> texture = it->second.lock();
+    if (texture == nullptr) textures.erase(it);
+    return texture;
+}
+
+void ModuleResources::AddTexture(std::shared_ptr<ResourceTexture> texture)
+{
+    if (texture == nullptr || texture->sourcePath.empty()) return;
+    textures[texture->sourcePath] = texture;
+}
+
+std::vector<std::shared_ptr<ResourceTexture>> ModuleResources::GetTextures()
+{
+    std::vector<std::shared_ptr<ResourceTexture>> alive;
+    for (auto it = textures.begin(); it != textures.end();)
+    {
+        std::shared_ptr<ResourceTexture> texture = it->second.lock();
+        if (texture == nullptr)
+        {
+            it = textures.erase(it);
+            continue;
+        }
+        alive.push_back(texture);
+        ++it;
+    }
+    return alive;
+}
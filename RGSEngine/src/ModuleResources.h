@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Module.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+
+class ResourceMesh;
+class ResourceTexture;
+class GeometryPool;
+struct PackedMeshView;
+
+// Cache of the assets loaded on the GPU, so the same asset is only uploaded once
+// The map keeps weak references: the components own the resources and the last one frees them
+class ModuleResources : public Module
+{
+public:
+    ModuleResources();
+    ~ModuleResources();
+
+    bool CleanUp() override;
+
+    // Mesh already loaded from the library path, nullptr if no component is using it
+    std::shared_ptr<ResourceMesh> FindMesh(const std::string& libraryPath);
+
+    // Returns the cached mesh of the path or uploads the data as a new one
+    // Meshes with an empty path are not cached, each call creates a new resource
+    std::shared_ptr<ResourceMesh> LoadMesh(const std::string& libraryPath,
+        const float* vertices, unsigned int numVertices,
+        const unsigned int* indices, unsigned int numIndices,
+        const float* texCoords = nullptr, const float* normals = nullptr);
+
+    // Same with the vertices already in the interleaved format, the buffers of the view are uploaded without copies
+    std::shared_ptr<ResourceMesh> LoadMesh(const std::string& libraryPath, const PackedMeshView& packed);
+
+    // Meshes alive right now, the expired entries of the cache are removed on the way
+    std::vector<std::shared_ptr<ResourceMesh>> GetMeshes();
+
+    // Shared buffers for the meshes with the vertex layout of flags (VertexFlags), created the first time one is needed
+    // The meshes keep a reference, so the pool outlives CleanUp until the last one is released
+    std::shared_ptr<GeometryPool> GetGeometryPool(uint32_t flags);
+    const std::unordered_map<uint32_t, std::shared_ptr<GeometryPool>>& GetGeometryPools() const { return geometryPools; }
+
+    // Key of a texture on the cache, the same file reached from different relative paths gives the same key
+    static std::string GetTextureKey(const std::string& sourcePath);
+
+    // Texture already loaded with that key, nullptr if no component is using it
+    std::shared_ptr<ResourceTexture> FindTexture(const std::string& key);
+    void AddTexture(std::shared_ptr<ResourceTexture> texture);
+
+    std::vector<std::shared_ptr<ResourceTexture>> GetTextures();
+
+private:
+
+    std::unordered_map<std::string, std::weak_ptr<ResourceMesh>> meshes;
+    std::unordered_map<std::string, std::weak_ptr<ResourceTexture>> textures;
+    std::unordered_map<uint32_t, std::shared_ptr<GeometryPool>> geometryPools;
+};
@@ -9,9 +9,13 @@
 #include "ComponentMesh.h"
 #include "ComponentTexture.h"
 #include "ComponentCamera.h"
+#include "TransformSystem.h"
+#include "ModuleResources.h"
+#include "ResourceTexture.h"
 
 #include <glad/glad.h>
 #include <vector>
+#include <algorithm>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
@@ -19,26 +23,36 @@
 
 static void CreateDefaultCheckerTexture(std::shared_ptr<ComponentTexture> texture)
 {
-    const int texWidth = 8, texHeight = 8;
-    GLubyte checkerTexture[texWidth * texHeight * 4];
-    for (int y = 0; y < texHeight; y++) {
-        for (int x = 0; x < texWidth; x++) {
-            int i = (y * texWidth + x) * 4;
-            bool isBlack = ((x % 2) == 0) != ((y % 2) == 0);
-            checkerTexture[i + 0] = isBlack ? 0 : 255;
-            checkerTexture[i + 1] = isBlack ? 0 : 255;
-            checkerTexture[i + 2] = isBlack ? 0 : 255;
-            checkerTexture[i + 3] = 255;
+    // All the primitives share the same checker, it's only uploaded the first time
+    std::shared_ptr<ResourceTexture> checker = Application::GetInstance().resources->FindTexture("default_checker");
+    if (checker == nullptr)
+    {
+        const int texWidth = 8, texHeight = 8;
+        GLubyte checkerTexture[texWidth * texHeight * 4];
+        for (int y = 0; y < texHeight; y++) {
+            for (int x = 0; x < texWidth; x++) {
+                int i = (y * texWidth + x) * 4;
+                bool isBlack = ((x % 2) == 0) != ((y % 2) == 0);
+                checkerTexture[i + 0] = isBlack ? 0 : 255;
+                checkerTexture[i + 1] = isBlack ? 0 : 255;
+                checkerTexture[i + 2] = isBlack ? 0 : 255;
+                checkerTexture[i + 3] = 255;
+            }
         }
+        GLuint textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texWidth, texHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, checkerTexture);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        checker = std::make_shared<ResourceTexture>("default_checker");
+        checker->SetTexture(textureID, texWidth, texHeight, false);
+        Application::GetInstance().resources->AddTexture(checker);
     }
-    glGenTextures(1, &texture->textureID);
-    glBindTexture(GL_TEXTURE_2D, texture->textureID);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texWidth, texHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, checkerTexture);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    texture->width = texWidth;
-    texture->height = texHeight;
+
+    texture->SetResource(checker);
     texture->path = "default_checker";
 }
 
@@ -120,9 +134,94 @@ bool ModuleScene::CleanUp()
     // As it is a shared_ptr, the 'rootObject' will be cleaning auto at the exit, calling the destroyers of all the GameObjects and Components
     rootObject.reset();
     rootObject.reset();
+
+    // The meshes left the BVH on their destructors, nothing should remain
+    bvh.Clear();
+    meshProxies.clear();
     return true;
 }
 
+// The world box of a mesh, only the local box if the object has no transform yet
+static AABB GetMeshWorldBox(ComponentMesh* mesh)
+{
+    ComponentTransform* transform = mesh->owner->GetComponent<ComponentTransform>();
+    if (transform == nullptr) return mesh->GetLocalAABB();
+
+    return mesh->GetLocalAABB().Transformed(transform->GetWorldMatrix());
+}
+
+void ModuleScene::RegisterMeshProxy(ComponentMesh* mesh)
+{
+    // Loading a new mesh on the same component only changes the box
+    if (mesh->bvhProxy != BVH::NULL_NODE)
+    {
+        bvh.MoveProxy(mesh->bvhProxy, GetMeshWorldBox(mesh));
+        return;
+    }
+
+    mesh->bvhProxy = bvh.CreateProxy(GetMeshWorldBox(mesh), mesh->owner);
+    mesh->sceneProxyIndex = (int)meshProxies.size();
+    meshProxies.push_back(mesh);
+    ++insertsSinceRebuild;
+}
+
+void ModuleScene::UnregisterMeshProxy(ComponentMesh* mesh)
+{
+    if (mesh->bvhProxy == BVH::NULL_NODE) return;
+
+    bvh.DestroyProxy(mesh->bvhProxy);
+    mesh->bvhProxy = BVH::NULL_NODE;
+
+    // Swap and pop, the last mesh takes the index of the removed one
+    int index = mesh->sceneProxyIndex;
+    meshProxies[index] = meshProxies.back();
+    meshProxies[index]->sceneProxyIndex = index;
+    meshProxies.pop_back();
+    mesh->sceneProxyIndex = -1;
+}
+
+void ModuleScene::UpdateBVH()
+{
+    TransformSystem& transforms = TransformSystem::GetInstance();
+
+    int moved = 0;
+    for (ComponentMesh* mesh : meshProxies)
+    {
+        ComponentTransform* transform = mesh->owner->GetComponent<ComponentTransform>();
+        if (transform == nullptr || !transforms.HasChanged(transform->GetHandle())) continue;
+
+        if (bvh.MoveProxy(mesh->bvhProxy, GetMeshWorldBox(mesh))) ++moved;
+    }
+
+    // An import inserts its meshes one by one, the SAH build gives a better tree once a good part of it is new
+    // Waiting for the new proxies to be half of them keeps the rebuilds of many imports at O(N log N) in total
+    if (insertsSinceRebuild > 0 && insertsSinceRebuild >= bvh.GetProxyCount() / 2)
+    {
+        RebuildBVH();
+        return;
+    }
+
+    if (moved == 0) return;
+
+    // The refits keep the tree valid but not optimal, checked only after a good amount of moves
+    refitsSinceRebuild += moved;
+    if (refitsSinceRebuild < std::max(64, bvh.GetProxyCount() / 2)) return;
+
+    refitsSinceRebuild = 0;
+    if (bvh.ComputeCost() > costAfterRebuild * 1.3f)
+    {
+        RebuildBVH();
+    }
+}
+
+void ModuleScene::RebuildBVH()
+{
+    bvh.Rebuild();
+    costAfterRebuild = bvh.ComputeCost();
+    refitsSinceRebuild = 0;
+    insertsSinceRebuild = 0;
+}
+
 void ModuleScene::AddGameObject(std::shared_ptr<GameObject> gameObject)
 {
     if (gameObject != nullptr && rootObject != nullptr)
@@ -191,6 +290,8 @@ void ModuleScene::CreatePyramid()
     };
     unsigned int num_indices = 18; // 6 faces * 3 index
 
+    // Same path for every primitive of this shape, so they share one mesh resource and Render can draw them instanced
+    mesh->libraryPath = "Primitives/Pyramid";
     mesh->LoadMesh(positions, num_vertices, indices, num_indices, uvs, nullptr);
     go->AddComponent(mesh);
 
@@ -225,6 +326,7 @@ void ModuleScene::CreateTriangle()
     };
     unsigned int indices[] = { 0, 1, 2 };
 
+    mesh->libraryPath = "Primitives/Triangle";
     mesh->LoadMesh(positions, 3, indices, 3, uvs, normals);
     go->AddComponent(mesh);
 
@@ -262,6 +364,7 @@ void ModuleScene::CreateSquare()
     };
     unsigned int indices[] = { 0, 1, 2,  0, 2, 3 };
 
+    mesh->libraryPath = "Primitives/Square";
     mesh->LoadMesh(positions, 4, indices, 6, uvs, normals);
     go->AddComponent(mesh);
 
@@ -299,6 +402,7 @@ void ModuleScene::CreateRectangle()
     };
     unsigned int indices[] = { 0, 1, 2,  0, 2, 3 };
 
+    mesh->libraryPath = "Primitives/Rectangle";
     mesh->LoadMesh(positions, 4, indices, 6, uvs, normals);
     go->AddComponent(mesh);
 
@@ -371,6 +475,7 @@ void ModuleScene::CreateCube()
     };
     unsigned int num_indices = 36;
 
+    mesh->libraryPath = "Primitives/Cube";
     mesh->LoadMesh(positions, num_vertices, indices, num_indices, uvs, normals);
     go->AddComponent(mesh);
 
@@ -435,6 +540,7 @@ void ModuleScene::CreateSphere()
         }
     }
 
+    mesh->libraryPath = "Primitives/Sphere";
     mesh->LoadMesh(positions.data(), positions.size() / 3, indices.data(), indices.size(), uvs.data(), normals.data());
     go->AddComponent(mesh);
 
@@ -3,9 +3,12 @@
 #include "Module.h"
 #include "GameObject.h"
 #include "SceneState.h"
+#include "BVH.h"
 #include <vector>
 #include <memory> // Used for the std::shared_ptr
 
+class ComponentMesh;
+
 class ModuleScene : public Module
 {
 public:
@@ -27,6 +30,18 @@ public:
 
     void AddGameObject(std::shared_ptr<GameObject> gameObject);
 
+    // --- Spatial acceleration ---
+    // The meshes register themselves when they are loaded and leave when they are destroyed
+    void RegisterMeshProxy(ComponentMesh* mesh);
+    void UnregisterMeshProxy(ComponentMesh* mesh);
+
+    // Refits the proxies of the meshes whose transform changed on the last TransformSystem pass,
+    // and rebuilds the tree with SAH when the refits made it too expensive
+    void UpdateBVH();
+    void RebuildBVH();
+
+    const BVH& GetBVH() const { return bvh; }
+
     // Simulation Control
     enum class SimulationState
     {
@@ -53,4 +68,11 @@ public:
 private:
     SimulationState simulationState;
     SceneState savedState;
+
+    // World space boxes of all the meshes, used by the culling of Render and the picking of the editor
+    BVH bvh;
+    std::vector<ComponentMesh*> meshProxies; // Each mesh keeps its index on sceneProxyIndex
+    int refitsSinceRebuild = 0;
+    int insertsSinceRebuild = 0;
+    float costAfterRebuild = 0.0f;
 };
\ No newline at end of file
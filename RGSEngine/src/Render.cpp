@@ -9,12 +9,16 @@
 #include "GameObject.h"
 #include "ComponentTransform.h"
 #include "ComponentMesh.h"
+#include "ResourceMesh.h"
 #include "ComponentTexture.h"
 #include "ComponentCamera.h"
+#include "TransformSystem.h"
 
 #include "imgui.h"
 #include "imgui_impl_opengl3.h"
 
+#include <algorithm>
+#include <chrono>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/matrix_decompose.hpp>
@@ -60,6 +64,44 @@ Render::Render() : Module()
 	drawVertexNormals = false;
 	drawFaceNormals = false;
 
+	frustumCulling = true;
+	culledMeshes = 0;
+	visibleMeshes = 0;
+
+	clusterCulling = true;
+	backfaceCulling = false;
+	culledClusters = 0;
+	visibleClusters = 0;
+
+	lodSelection = true;
+	lodScreenSize = 0.25f;
+	lodHysteresis = 0.1f;
+
+	indirectRendering = true;
+
+	gpuCulling = false;
+	occlusionCulling = true;
+	validateGpuCulling = false;
+	gpuCullingMismatches = 0;
+	gpuVisibleInstances = 0;
+	gpuFrustumCulled = 0;
+	gpuOccluded = 0;
+
+	occluderMode = OCCLUDERS_OFF;
+	occluderScreenSize = 0.2f;
+	maxOccluders = 32;
+	occluders = 0;
+	occluderTriangles = 0;
+	occludedMeshes = 0;
+	occlusionTimeMs = 0.0f;
+	occlusionGpuTimeMs = 0.0f;
+
+	drawCalls = 0;
+	instancedDrawCalls = 0;
+	multiDrawCommands = 0;
+	stateChanges = 0;
+	renderedTriangles = 0;
+
 	// Initialize camera rotation
 	cameraPos = glm::vec3(0.0f, 0.0f, 3.0f);
 	cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
@@ -124,8 +166,23 @@ bool Render::Start()
 	// Create shader
 	shader = std::make_unique<Shader>();
 
+	// Variant of the default shader with the model matrix per instance
+	instancedShader = std::make_unique<Shader>(DefaultShaders::instancedVertexShader, DefaultShaders::fragmentShader);
+
+	// Variant for the multi draw indirect path, the model matrix and the alpha test per object from a storage buffer
+	indirectShader = std::make_unique<Shader>(DefaultShaders::indirectVertexShader, DefaultShaders::indirectFragmentShader);
+
 	// Create shader for the normals
 	normalsShader = std::make_unique<Shader>(NormalShaders::vertex, NormalShaders::fragment);
+
+	glGenBuffers(1, &instanceVBO);
+	glGenBuffers(1, &indirectBuffer);
+	glGenBuffers(1, &objectBuffer);
+	glGenBuffers(1, &instanceObjectBuffer);
+
+	// Compute shaders and buffers of the culling on the GPU
+	cullingPass = std::make_unique<GpuCulling>();
+	glGenQueries(OCCLUSION_QUERY_COUNT, occlusionQueries);
 	
 	CreateDefaultCheckerTexture();
 
@@ -326,6 +383,12 @@ bool Render::PreUpdate()
 
 bool Render::Update(float dt)
 {
+	// All the world matrices are updated in one pass before drawing, after the scene and the gizmo moved the objects
+	TransformSystem::GetInstance().UpdateWorldMatrices();
+
+	// The boxes of the meshes that moved are refit on the BVH
+	Application::GetInstance().scene->UpdateBVH();
+
 	Input* input = Application::GetInstance().input.get();
 	ImGuiIO& io = ImGui::GetIO();
 
@@ -355,17 +418,54 @@ bool Render::Update(float dt)
 	shader->SetMat4("view", viewMatrix);
 	shader->SetMat4("projection", projectionMatrix);
 
+	instancedShader->Use();
+	instancedShader->SetMat4("view", viewMatrix);
+	instancedShader->SetMat4("projection", projectionMatrix);
+
+	indirectShader->Use();
+	indirectShader->SetMat4("view", viewMatrix);
+	indirectShader->SetMat4("projection", projectionMatrix);
+
 	normalsShader->Use();
 	normalsShader->SetMat4("view", viewMatrix);
 	normalsShader->SetMat4("projection", projectionMatrix);
 
 	shader->Use();
+
+	frustum.ExtractFromMatrix(projectionMatrix * viewMatrix);
+	culledMeshes = 0;
+	visibleMeshes = 0;
+	culledClusters = 0;
+	visibleClusters = 0;
+
 	// Obtain the rootObject of the scene
 	std::shared_ptr<GameObject> root = Application::GetInstance().scene->rootObject;
 	// Start the process to draw recursive
 	if (root != nullptr)
 	{
-		DrawGameObject(root.get(), glm::mat4(1.0f));
+		if (frustumCulling)
+		{
+			// Only the boxes of the BVH are tested, the meshes found are marked as visible for this frame
+			++cullingFrame;
+			visibleObjects.clear();
+			Application::GetInstance().scene->GetBVH().QueryFrustum(frustum, visibleObjects);
+
+			for (GameObject* visible : visibleObjects)
+			{
+				ComponentMesh* visibleMesh = visible->GetComponent<ComponentMesh>();
+				if (visibleMesh != nullptr) visibleMesh->visibleFrame = cullingFrame;
+			}
+		}
+
+		// Collect, sort and then submit, so the GL state only changes between different groups
+		opaqueQueue.clear();
+		blendedQueue.clear();
+		cameraGizmos.clear();
+
+		CollectGameObject(root.get());
+		CullOccludedItems();
+		SortRenderQueue();
+		SubmitRenderQueue();
 	}
 
 	static bool loggedOnce = false;
@@ -381,7 +481,7 @@ bool Render::Update(float dt)
 	return true;
 }
 
-void Render::DrawGameObject(GameObject* go, const glm::mat4& parentTransform)
+void Render::CollectGameObject(GameObject* go)
 {
 	if (go == nullptr || !go->IsActive())
 	{
@@ -393,102 +493,721 @@ void Render::DrawGameObject(GameObject* go, const glm::mat4& parentTransform)
 	ComponentMesh* mesh = go->GetComponent<ComponentMesh>();
 	ComponentTexture* texture = go->GetComponent<ComponentTexture>();
 
-	glm::mat4 localTransform = (transform != nullptr) ? transform->GetModelMatrix() : glm::mat4(1.0f);
-	glm::mat4 globalTransform = parentTransform * localTransform;
+	bool meshVisible = (mesh != nullptr && transform != nullptr && mesh->HasGeometry());
+	if (meshVisible && frustumCulling && mesh->visibleFrame != cullingFrame)
+	{
+		meshVisible = false;
+		++culledMeshes;
+	}
 
-	if (mesh != nullptr && transform != nullptr)
+	if (meshVisible)
 	{
-		// Force the main shader is active
-		shader->Use();
+		++visibleMeshes;
+
+		DrawItem item;
+		item.mesh = mesh->resource.get();
+		// The world matrix comes already calculated from the TransformSystem
+		item.worldMatrix = transform->GetWorldMatrix();
+		item.shaderID = shader->ID;
+		item.VAO = item.mesh->VAO;
+		item.geometryID = GetGeometryID(item.mesh);
 
-		// TEMPORARY LOG FOR DEBUG
-		static bool loggedOnce = false;
-		if (!loggedOnce && mesh->VBO_UV != 0)
+		if (texture != nullptr)
 		{
-			LOG("Drawing mesh with UVs: VBO_UV = %d", mesh->VBO_UV);
-			loggedOnce = true;
+			item.textureID = texture->GetDrawTextureID(defaultCheckerTexture);
+			item.alphaTest = texture->enableAlphaTest;
+			item.alphaThreshold = texture->alphaThreshold;
+			item.blending = texture->enableBlending;
+			item.blendSrc = texture->blendSrc;
+			item.blendDst = texture->blendDst;
+		}
+		else
+		{
+			// Use default checker texture
+			item.textureID = defaultCheckerTexture;
 		}
 
-		// Send to the shader
-		shader->SetMat4("model", globalTransform);
+		// Distance along the view direction of the center of the mesh, used to sort the transparent ones
+		glm::vec3 center = glm::vec3(item.worldMatrix * glm::vec4(item.mesh->localAABB.GetCenter(), 1.0f));
+		item.depth = glm::dot(center - cameraPos, cameraFront);
 
-		// Link the texture
-		glActiveTexture(GL_TEXTURE0);
+		// Height of the sphere on the screen as a fraction of the screen height, for the LOD and the occluders
+		glm::mat3 linear = glm::mat3(item.worldMatrix);
+		float scale = glm::max(glm::max(glm::length(linear[0]), glm::length(linear[1])), glm::length(linear[2]));
+		float radius = item.mesh->localSphere.radius * scale;
+		float distance = glm::length(center - cameraPos);
+		item.screenSize = (distance > radius) ? radius / (distance * tanf(glm::radians(cameraFOV) * 0.5f)) : 1.0f;
 
-		bool alphaTest = false;
-		float alphaCutoff = 0.0f;
-		bool blending = false;
+		if (lodSelection && item.mesh->lods.size() > 1)
+		{
+			item.lod = mesh->SelectLod(item.screenSize, lodScreenSize, lodHysteresis);
+		}
+		else
+		{
+			mesh->lodLevel = 0;
+		}
 
-		if (texture != nullptr)
+		if (item.blending)
+		{
+			blendedQueue.push_back(item);
+		}
+		else
+		{
+			item.sortKey = RenderQueue::MakeSortKey(item.shaderID, item.textureID, item.geometryID, item.lod);
+			opaqueQueue.push_back(item);
+		}
+	}
+
+	ComponentCamera* camera = go->GetComponent<ComponentCamera>();
+	if (camera != nullptr && camera->active)
+	{
+		cameraGizmos.push_back(camera);
+	}
+
+	for (const auto& child : go->GetChildren())
+	{
+		CollectGameObject(child.get());
+	}
+}
+
+void Render::SortRenderQueue()
+{
+	RenderQueue::Sort(opaqueQueue, blendedQueue);
+}
+
+void Render::CullOccludedItems()
+{
+	occluders = 0;
+	occluderTriangles = 0;
+	occludedMeshes = 0;
+	occlusionTimeMs = 0.0f;
+	if (occluderMode == OCCLUDERS_OFF) return;
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	// The largest opaque meshes on the screen, the alpha tested ones can have holes
+	occluderItems.clear();
+	for (uint32_t i = 0; i < (uint32_t)opaqueQueue.size(); ++i)
+	{
+		const DrawItem& item = opaqueQueue[i];
+		if (!item.alphaTest && item.screenSize >= occluderScreenSize) occluderItems.push_back(i);
+	}
+	std::sort(occluderItems.begin(), occluderItems.end(),
+		[this](uint32_t a, uint32_t b) { return opaqueQueue[a].screenSize > opaqueQueue[b].screenSize; });
+	if (occluderItems.size() > (size_t)std::max(maxOccluders, 0)) occluderItems.resize((size_t)std::max(maxOccluders, 0));
+
+	for (uint32_t index : occluderItems) opaqueQueue[index].occluder = true;
+	occluders = (unsigned int)occluderItems.size();
+
+	// With the GPU culling the compute shader reads the pyramid, so it has to be drawn even when it is empty
+	const bool gpuTest = (occluderMode == OCCLUDERS_GPU && indirectRendering && gpuCulling && occlusionCulling);
+	const DepthPyramid* pyramid = nullptr;
+
+	if (!occluderItems.empty() || gpuTest)
+	{
+		int width, height;
+		Application::GetInstance().window->GetWindowSize(width, height);
+		const glm::mat4 viewProjection = projectionMatrix * viewMatrix;
+
+		if (occluderMode == OCCLUDERS_SOFTWARE)
+		{
+			softwareOcclusion.Begin((float)width / (float)std::max(height, 1), viewProjection);
+			for (uint32_t index : occluderItems)
+			{
+				// The LOD the item is drawn with, a coarser one can move the surface outwards and hide what is visible
+				const DrawItem& item = opaqueQueue[index];
+				softwareOcclusion.RasterizeMesh(item.mesh->cpuPositions.data(), item.mesh->GetLodIndices(item.lod), item.mesh->lods[item.lod].indexCount, item.worldMatrix);
+			}
+			softwareOcclusion.End();
+
+			occluderTriangles = softwareOcclusion.GetTriangleCount();
+			pyramid = &softwareOcclusion.GetPyramid();
+		}
+		else
+		{
+			// The wall time above only covers the submission, the GPU time of the pass is read a few frames later
+			// A query still waiting for its result is not reused, that frame is not timed
+			unsigned int query = occlusionQueryFrame;
+			if (occlusionQueryPending[query])
+			{
+				GLint available = 0;
+				glGetQueryObjectiv(occlusionQueries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+				if (available)
+				{
+					GLuint64 elapsed = 0;
+					glGetQueryObjectui64v(occlusionQueries[query], GL_QUERY_RESULT, &elapsed);
+					occlusionGpuTimeMs = (float)(elapsed / 1.0e6);
+					occlusionQueryPending[query] = false;
+				}
+			}
+			const bool timed = !occlusionQueryPending[query];
+			if (timed) glBeginQuery(GL_TIME_ELAPSED, occlusionQueries[query]);
+
+			// Depth only at half the resolution, with the LOD each occluder is drawn with
+			cullingPass->BeginOccluderPass(width / 2, height / 2);
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			normalsShader->Use();
+
+			for (uint32_t index : occluderItems)
+			{
+				const DrawItem& item = opaqueQueue[index];
+				const MeshLod& lod = item.mesh->lods[item.lod];
+				normalsShader->SetMat4("model", item.worldMatrix * item.mesh->dequantizeMatrix);
+				glBindVertexArray(item.mesh->VAO);
+				glDrawElementsBaseVertex(GL_TRIANGLES, lod.indexCount, item.mesh->indexType, item.mesh->GetLodOffset(item.lod), item.mesh->GetBaseVertex());
+				occluderTriangles += lod.indexCount / 3;
+			}
+
+			glBindVertexArray(0);
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			cullingPass->EndOccluderPass(viewProjection, width, height);
+			shader->Use();
+
+			if (timed)
+			{
+				glEndQuery(GL_TIME_ELAPSED);
+				occlusionQueryPending[query] = true;
+			}
+			occlusionQueryFrame = (occlusionQueryFrame + 1) % OCCLUSION_QUERY_COUNT;
+
+			// Reading it back waits for the GPU, only done when nothing else tests against it
+			if (!gpuTest && cullingPass->ReadDepthPyramid(occluderPyramid, OCCLUDER_READBACK_WIDTH)) pyramid = &occluderPyramid;
+		}
+	}
+
+	if (pyramid != nullptr)
+	{
+		// The occluders stay, they are part of the depth they would be tested against
+		auto RemoveOccluded = [&](std::vector<DrawItem>& queue)
+			{
+				size_t kept = 0;
+				for (size_t i = 0; i < queue.size(); ++i)
+				{
+					const DrawItem& item = queue[i];
+					if (!item.occluder && pyramid->IsOccluded(item.mesh->localAABB.Transformed(item.worldMatrix)))
+					{
+						++occludedMeshes;
+						continue;
+					}
+					if (kept != i) queue[kept] = queue[i];
+					++kept;
+				}
+				queue.resize(kept);
+			};
+
+		RemoveOccluded(opaqueQueue);
+		RemoveOccluded(blendedQueue);
+		visibleMeshes -= occludedMeshes;
+	}
+
+	auto endTime = std::chrono::high_resolution_clock::now();
+	occlusionTimeMs = std::chrono::duration<float, std::milli>(endTime - startTime).count();
+}
+
+unsigned int Render::GetGeometryID(ResourceMesh* mesh)
+{
+	// The components that load the same library asset share the resource, so one id per resource is enough
+	if (mesh->geometryID == 0) mesh->geometryID = nextGeometryID++;
+	return mesh->geometryID;
+}
+
+void Render::CullClusters(DrawItem& item)
+{
+	const std::vector<Meshlet>& meshlets = item.mesh->meshlets;
+
+	// With one meshlet the test of the whole mesh was already enough, the meshlets are only of the full mesh
+	if (!clusterCulling || meshlets.size() < 2 || item.lod != 0) return;
+
+	// The cones are tested in the local space of the mesh, the side of a plane doesn't change with the transform
+	// A mirrored transform flips the winding, those keep all their meshlets
+	glm::mat3 linear = glm::mat3(item.worldMatrix);
+	bool testCones = backfaceCulling && glm::determinant(linear) > 0.0f;
+	glm::vec3 localCamera = glm::vec3(glm::inverse(item.worldMatrix) * glm::vec4(cameraPos, 1.0f));
+
+	float scale = glm::max(glm::max(glm::length(linear[0]), glm::length(linear[1])), glm::length(linear[2]));
+
+	// The meshlets are ranges of the full mesh, which starts at the first index of the allocation on the pool
+	const uint32_t meshFirstIndex = item.mesh->GetLodFirstIndex(0);
+
+	item.clustered = true;
+	item.firstCommand = (uint32_t)indirectCommands.size();
+	item.commandCount = 0;
+
+	for (const Meshlet& meshlet : meshlets)
+	{
+		BoundingSphere sphere;
+		sphere.center = glm::vec3(item.worldMatrix * glm::vec4(meshlet.center[0], meshlet.center[1], meshlet.center[2], 1.0f));
+		sphere.radius = meshlet.radius * scale;
+
+		if (!frustum.Intersects(sphere) || (testCones && MeshletBuilder::IsBackfacing(meshlet, localCamera)))
+		{
+			++culledClusters;
+			continue;
+		}
+		++visibleClusters;
+
+		// The meshlets are contiguous on the index buffer, consecutive visible ones go on the same command
+		if (item.commandCount > 0)
+		{
+			DrawElementsIndirectCommand& last = indirectCommands.back();
+			if (last.firstIndex + last.count == meshFirstIndex + meshlet.firstIndex)
+			{
+				last.count += meshlet.indexCount;
+				continue;
+			}
+		}
+
+		DrawElementsIndirectCommand command;
+		command.count = meshlet.indexCount;
+		command.firstIndex = meshFirstIndex + meshlet.firstIndex;
+		command.baseVertex = item.mesh->GetBaseVertex();
+		indirectCommands.push_back(command);
+		++item.commandCount;
+	}
+}
+
+// Command for the LOD of the item, read from the geometry pool of its mesh, AddInstances gives it its instances
+static DrawElementsIndirectCommand GetLodCommand(const DrawItem& item)
+{
+	DrawElementsIndirectCommand command;
+	command.count = item.mesh->lods[item.lod].indexCount;
+	command.firstIndex = item.mesh->GetLodFirstIndex(item.lod);
+	command.baseVertex = item.mesh->GetBaseVertex();
+	return command;
+}
+
+void Render::AddInstances(uint32_t command, uint32_t firstObject, uint32_t count)
+{
+	DrawElementsIndirectCommand& target = indirectCommands[command];
+	target.baseInstance = (uint32_t)instanceObjects.size();
+	target.instanceCount = count;
+
+	for (uint32_t object = firstObject; object < firstObject + count; ++object)
+	{
+		instanceObjects.push_back(object);
+
+		// The shader counts the visible instances again, the objects it rejects don't take their slot
+		if (gpuCulling)
+		{
+			CullEntry entry;
+			entry.sphere = glm::vec4(objectSpheres[object].center, objectSpheres[object].radius);
+			entry.command = command;
+			entry.object = object;
+			cullEntries.push_back(entry);
+		}
+	}
+	if (gpuCulling) target.instanceCount = 0;
+}
+
+void Render::BuildIndirectQueue()
+{
+	objects.clear();
+	objectSpheres.clear();
+	instanceObjects.clear();
+	indirectRuns.clear();
+	cullEntries.clear();
+	commandRuns.clear();
+
+	for (size_t i = 0; i < opaqueQueue.size();)
+	{
+		// The alpha test is per object here, only the geometry and the LOD have to match to share a command
+		size_t end = i + 1;
+		while (end < opaqueQueue.size() && opaqueQueue[end].sortKey == opaqueQueue[i].sortKey) ++end;
+
+		const uint32_t firstObject = (uint32_t)objects.size();
+		const uint32_t firstCommand = (uint32_t)indirectCommands.size();
+		for (size_t k = i; k < end; ++k)
+		{
+			ObjectData object;
+			object.model = opaqueQueue[k].worldMatrix * opaqueQueue[k].mesh->dequantizeMatrix;
+			object.material = glm::vec4(opaqueQueue[k].alphaTest ? 1.0f : 0.0f, opaqueQueue[k].alphaThreshold, 0.0f, 0.0f);
+			objects.push_back(object);
+			objectSpheres.push_back(opaqueQueue[k].mesh->localSphere.Transformed(opaqueQueue[k].worldMatrix));
+		}
+
+		if (end - i >= RenderQueue::MIN_INSTANCES)
+		{
+			indirectCommands.push_back(GetLodCommand(opaqueQueue[i]));
+			AddInstances(firstCommand, firstObject, (uint32_t)(end - i));
+		}
+		else
 		{
-			texture->Bind();
+			// Alone, the same as the classic path: the visible meshlets or the whole LOD
+			for (size_t k = i; k < end; ++k)
+			{
+				uint32_t object = firstObject + (uint32_t)(k - i);
+				uint32_t itemCommand = (uint32_t)indirectCommands.size();
 
-			alphaTest = texture->enableAlphaTest;
-			alphaCutoff = texture->alphaThreshold;
-			blending = texture->enableBlending;
+				CullClusters(opaqueQueue[k]);
+				if (!opaqueQueue[k].clustered) indirectCommands.push_back(GetLodCommand(opaqueQueue[k]));
 
-			// BLENDING
-			if (blending) {
-				glEnable(GL_BLEND);
-				glBlendFunc(texture->blendSrc, texture->blendDst);
+				for (uint32_t c = itemCommand; c < (uint32_t)indirectCommands.size(); ++c) AddInstances(c, object, 1);
 			}
-			else {
-				glDisable(GL_BLEND);
+		}
+
+		// The queue is sorted by texture first, so a run only breaks when the texture or the pool changes
+		const DrawItem& item = opaqueQueue[i];
+		uint32_t commandCount = (uint32_t)indirectCommands.size() - firstCommand;
+		if (commandCount > 0)
+		{
+			if (!indirectRuns.empty() && indirectRuns.back().textureID == item.textureID && indirectRuns.back().VAO == item.VAO)
+			{
+				indirectRuns.back().commandCount += commandCount;
+			}
+			else
+			{
+				IndirectRun run;
+				run.textureID = item.textureID;
+				run.VAO = item.VAO;
+				run.indexType = item.mesh->indexType;
+				run.firstCommand = firstCommand;
+				run.commandCount = commandCount;
+				indirectRuns.push_back(run);
 			}
 		}
+		i = end;
+	}
+
+	// Where the culling pass compacts each command
+	if (gpuCulling)
+	{
+		commandRuns.resize(indirectCommands.size());
+		for (uint32_t r = 0; r < (uint32_t)indirectRuns.size(); ++r)
+		{
+			const IndirectRun& run = indirectRuns[r];
+			for (uint32_t c = run.firstCommand; c < run.firstCommand + run.commandCount; ++c) commandRuns[c] = glm::uvec2(r, run.firstCommand);
+		}
+	}
+}
+
+void Render::SubmitIndirectQueue()
+{
+	if (indirectRuns.empty()) return;
+
+	// Orphaned every frame, the same as the instance matrices
+	auto Upload = [](unsigned int buffer, size_t& capacity, const void* data, size_t size)
+		{
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+			if (size > capacity) capacity = size * 2;
+			glBufferData(GL_SHADER_STORAGE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, data);
+		};
+
+	Upload(objectBuffer, objectBufferCapacity, objects.data(), objects.size() * sizeof(ObjectData));
+	Upload(instanceObjectBuffer, instanceObjectBufferCapacity, instanceObjects.data(), instanceObjects.size() * sizeof(uint32_t));
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	if (gpuCulling)
+	{
+		cullingPass->Cull(cullEntries, commandRuns, (uint32_t)indirectRuns.size(), indirectBuffer, instanceObjectBuffer, frustum, occlusionCulling);
+		if (validateGpuCulling)
+		{
+			unsigned int mismatches = cullingPass->Validate(cullEntries, frustum, occlusionCulling);
+			if (mismatches != 0 && mismatches != gpuCullingMismatches) LOG("GPU culling: %u results different from the CPU reference", mismatches);
+			gpuCullingMismatches = mismatches;
+		}
+
+		// The compacted commands replace the ones uploaded, each run draws the count the shader left for it
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, cullingPass->GetDrawBuffer());
+		glBindBuffer(GL_PARAMETER_BUFFER, cullingPass->GetRunCountBuffer());
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_BINDING, objectBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_OBJECT_BINDING, instanceObjectBuffer);
+
+	indirectShader->Use();
+	indirectShader->SetInt("tex1", 0);
+	++stateChanges;
+
+	// SubmitRenderQueue starts with the texture and the VAO unbound
+	unsigned int currentTexture = 0;
+	unsigned int currentVAO = 0;
+
+	for (uint32_t r = 0; r < (uint32_t)indirectRuns.size(); ++r)
+	{
+		const IndirectRun& run = indirectRuns[r];
+		if (run.textureID != currentTexture)
+		{
+			glBindTexture(GL_TEXTURE_2D, run.textureID);
+			currentTexture = run.textureID;
+			++stateChanges;
+		}
+		if (run.VAO != currentVAO)
+		{
+			glBindVertexArray(run.VAO);
+			currentVAO = run.VAO;
+			++stateChanges;
+		}
+
+		const void* offset = (const void*)(uintptr_t)(run.firstCommand * sizeof(DrawElementsIndirectCommand));
+		if (gpuCulling)
+		{
+			glMultiDrawElementsIndirectCount(GL_TRIANGLES, run.indexType, offset, (GLintptr)(r * sizeof(uint32_t)), (GLsizei)run.commandCount, 0);
+		}
 		else
 		{
-			// Use default checker texture
-			glBindTexture(GL_TEXTURE_2D, defaultCheckerTexture);
-			glDisable(GL_BLEND);
+			glMultiDrawElementsIndirect(GL_TRIANGLES, run.indexType, offset, (GLsizei)run.commandCount, 0);
+			for (uint32_t c = run.firstCommand; c < run.firstCommand + run.commandCount; ++c)
+			{
+				renderedTriangles += indirectCommands[c].count / 3 * indirectCommands[c].instanceCount;
+			}
+		}
+		multiDrawCommands += run.commandCount;
+		++drawCalls;
+	}
+
+	if (gpuCulling)
+	{
+		// Only known after the GPU is done, these are of the frame before
+		renderedTriangles = cullingPass->triangles;
+		gpuVisibleInstances = cullingPass->visibleEntries;
+		gpuFrustumCulled = cullingPass->frustumCulled;
+		gpuOccluded = cullingPass->occluded;
+
+		glBindBuffer(GL_PARAMETER_BUFFER, 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+
+		// The opaque objects of this frame are the occluders of the next one, unless the occluder pass already drew them
+		if (occlusionCulling && occluderMode != OCCLUDERS_GPU)
+		{
+			int width, height;
+			Application::GetInstance().window->GetWindowSize(width, height);
+			cullingPass->BuildDepthPyramid(width, height, projectionMatrix * viewMatrix);
+		}
+	}
+
+	// Back to the state the cached values of SubmitRenderQueue expect
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindVertexArray(0);
+}
+
+void Render::SubmitRenderQueue()
+{
+	drawCalls = 0;
+	instancedDrawCalls = 0;
+	multiDrawCommands = 0;
+	stateChanges = 0;
+	renderedTriangles = 0;
+
+	// Group the opaque queue in batches and put the matrices of the instanced ones in one buffer, uploaded once per frame
+	std::vector<RenderQueue::Batch> batches;
+	instanceMatrices.clear();
+	indirectCommands.clear();
+
+	// The indirect path builds its own commands, the batches are only for the classic one
+	if (indirectRendering) BuildIndirectQueue();
+	else RenderQueue::BuildBatches(opaqueQueue, batches);
+
+	for (RenderQueue::Batch& batch : batches)
+	{
+		batch.instanceOffset = instanceMatrices.size();
+		const size_t end = batch.first + batch.count;
+		if (batch.count >= RenderQueue::MIN_INSTANCES)
+		{
+			for (size_t k = batch.first; k < end; ++k) instanceMatrices.push_back(opaqueQueue[k].worldMatrix * opaqueQueue[k].mesh->dequantizeMatrix);
+		}
+		else
+		{
+			for (size_t k = batch.first; k < end; ++k) CullClusters(opaqueQueue[k]);
 		}
+	}
+
+	if (!instanceMatrices.empty())
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+		size_t size = instanceMatrices.size() * sizeof(glm::mat4);
+		if (size > instanceBufferCapacity) instanceBufferCapacity = size * 2;
+
+		// Orphan the storage every frame so the driver doesn't wait for the draws of the previous one
+		glBufferData(GL_ARRAY_BUFFER, instanceBufferCapacity, nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, size, instanceMatrices.data());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	if (!indirectCommands.empty())
+	{
+		// Stays bound while the queue is drawn, the commands of each item are an offset on it
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+		size_t size = indirectCommands.size() * sizeof(DrawElementsIndirectCommand);
+		if (size > indirectBufferCapacity) indirectBufferCapacity = size * 2;
+
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, indirectBufferCapacity, nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, size, indirectCommands.data());
+	}
+
+	// Cached state, the GL call is only done when the value is different
+	Shader* currentShader = nullptr;
+	unsigned int currentTexture = 0;
+	unsigned int currentVAO = 0;
+	bool currentBlending = false;
+	unsigned int currentBlendSrc = 0;
+	unsigned int currentBlendDst = 0;
+	int currentAlphaTest = -1;
+	float currentAlphaThreshold = -1.0f;
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDisable(GL_BLEND);
 
-		// Send Uniforms of Alpha Test to the shader
-		shader->SetBool("enableAlphaTest", alphaTest);
-		shader->SetFloat("alphaThreshold", alphaCutoff);
+	auto BindState = [&](const DrawItem& item, Shader* program)
+		{
+			if (program != currentShader)
+			{
+				program->Use();
+				program->SetInt("tex1", 0);
+				currentShader = program;
+				// The uniforms are per program
+				currentAlphaTest = -1;
+				++stateChanges;
+			}
+
+			if (item.textureID != currentTexture)
+			{
+				glBindTexture(GL_TEXTURE_2D, item.textureID);
+				currentTexture = item.textureID;
+				++stateChanges;
+			}
 
-		shader->SetInt("tex1", 0);
+			if (item.blending != currentBlending)
+			{
+				if (item.blending) glEnable(GL_BLEND);
+				else glDisable(GL_BLEND);
+				currentBlending = item.blending;
+				++stateChanges;
+			}
 
-		// Draw the mesh
-		mesh->Draw();
+			if (item.blending && (item.blendSrc != currentBlendSrc || item.blendDst != currentBlendDst))
+			{
+				glBlendFunc(item.blendSrc, item.blendDst);
+				currentBlendSrc = item.blendSrc;
+				currentBlendDst = item.blendDst;
+				++stateChanges;
+			}
 
-		// Unlink the texture
-		glBindTexture(GL_TEXTURE_2D, 0);
+			// Send Uniforms of Alpha Test to the shader
+			if ((int)item.alphaTest != currentAlphaTest || item.alphaThreshold != currentAlphaThreshold)
+			{
+				program->SetBool("enableAlphaTest", item.alphaTest);
+				program->SetFloat("alphaThreshold", item.alphaThreshold);
+				currentAlphaTest = (int)item.alphaTest;
+				currentAlphaThreshold = item.alphaThreshold;
+				++stateChanges;
+			}
 
-		glDisable(GL_BLEND);
+			if (item.VAO != currentVAO)
+			{
+				glBindVertexArray(item.VAO);
+				currentVAO = item.VAO;
+				++stateChanges;
+			}
+		};
 
-		if (drawVertexNormals || drawFaceNormals)
+	auto SubmitItem = [&](const DrawItem& item)
 		{
-			// Use the shader of the normals
-			normalsShader->Use();
-			// Send the model matrix
-			normalsShader->SetMat4("model", globalTransform);
+			// All its meshlets were culled
+			if (item.clustered && item.commandCount == 0) return;
+
+			BindState(item, shader.get());
+
+			// The quantized positions go to local space before the model matrix
+			shader->SetMat4("model", item.worldMatrix * item.mesh->dequantizeMatrix);
+
+			if (item.clustered)
+			{
+				const void* offset = (const void*)(uintptr_t)(item.firstCommand * sizeof(DrawElementsIndirectCommand));
+				glMultiDrawElementsIndirect(GL_TRIANGLES, item.mesh->indexType, offset, (GLsizei)item.commandCount, 0);
+
+				for (uint32_t c = item.firstCommand; c < item.firstCommand + item.commandCount; ++c) renderedTriangles += indirectCommands[c].count / 3;
+			}
+			else
+			{
+				const MeshLod& lod = item.mesh->lods[item.lod];
+				glDrawElementsBaseVertex(GL_TRIANGLES, lod.indexCount, item.mesh->indexType, item.mesh->GetLodOffset(item.lod), item.mesh->GetBaseVertex());
+				renderedTriangles += lod.indexCount / 3;
+			}
+			++drawCalls;
+		};
 
-			if (drawVertexNormals) mesh->DrawNormals();
-			if (drawFaceNormals)   mesh->DrawFaceNormals();
+	// Only the opaque queue, the transparent objects show their back faces
+	if (backfaceCulling) glEnable(GL_CULL_FACE);
+
+	if (indirectRendering) SubmitIndirectQueue();
+
+	for (const RenderQueue::Batch& batch : batches)
+	{
+		if (batch.count < RenderQueue::MIN_INSTANCES)
+		{
+			for (size_t k = batch.first; k < batch.first + batch.count; ++k) SubmitItem(opaqueQueue[k]);
+			continue;
 		}
+
+		// All the items share the geometry and the LOD, the VAO of the first one draws the whole batch
+		const DrawItem& item = opaqueQueue[batch.first];
+		item.mesh->SetupInstanceAttributes(INSTANCE_BINDING);
+
+		BindState(item, instancedShader.get());
+		glBindVertexBuffer(INSTANCE_BINDING, instanceVBO, batch.instanceOffset * sizeof(glm::mat4), sizeof(glm::mat4));
+
+		const MeshLod& lod = item.mesh->lods[item.lod];
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, lod.indexCount, item.mesh->indexType, item.mesh->GetLodOffset(item.lod),
+			(GLsizei)batch.count, item.mesh->GetBaseVertex());
+		renderedTriangles += lod.indexCount / 3 * (unsigned int)batch.count;
+		++drawCalls;
+		++instancedDrawCalls;
 	}
 
-	ComponentCamera* camera = go->GetComponent<ComponentCamera>();
-	if (camera != nullptr && camera->active)
+	glDisable(GL_CULL_FACE);
+
+	// The transparent objects don't write the depth so the ones behind are not discarded
+	if (!blendedQueue.empty())
+	{
+		glDepthMask(GL_FALSE);
+		for (const DrawItem& item : blendedQueue) SubmitItem(item);
+		glDepthMask(GL_TRUE);
+	}
+	// Unlink the state used by the queue
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDisable(GL_BLEND);
+
+	// Debug lines, all of them with the shader of the normals
+	if (drawVertexNormals || drawFaceNormals)
+	{
+		normalsShader->Use();
+		++stateChanges;
+
+		auto DrawItemNormals = [&](const DrawItem& item)
+			{
+				// Send the model matrix
+				normalsShader->SetMat4("model", item.worldMatrix);
+
+				if (drawVertexNormals) item.mesh->DrawNormals();
+				if (drawFaceNormals)   item.mesh->DrawFaceNormals();
+			};
+
+		for (const DrawItem& item : opaqueQueue) DrawItemNormals(item);
+		for (const DrawItem& item : blendedQueue) DrawItemNormals(item);
+	}
+
+	if (!cameraGizmos.empty())
 	{
 		// Using the shader for the normals
 		normalsShader->Use();
+		++stateChanges;
 
-		// Send the indentity transform because GenerateFrustumGizmo already uses the world coords with transform->position
+		// Send the indentity transform because GenerateFrustumGizmo already uses the world coords with transform->GetPosition()
 		glm::mat4 identity = glm::mat4(1.0f);
 		normalsShader->SetMat4("model", identity);
 
 		// Draw the lines
-		camera->DrawFrustum();
-
-		shader->Use();
+		for (ComponentCamera* camera : cameraGizmos)
+		{
+			camera->DrawFrustum();
+		}
 	}
 
-	for (const auto& child : go->GetChildren())
-	{
-		DrawGameObject(child.get(), globalTransform);
-	}
+	shader->Use();
 }
 
 bool Render::PostUpdate()
@@ -518,6 +1237,15 @@ bool Render::CleanUp()
 	// The shader is from this class so we have to CleanUp
 	shader.reset();
 	normalsShader.reset();
+	instancedShader.reset();
+	indirectShader.reset();
+	cullingPass.reset();
+	if (occlusionQueries[0] != 0) { glDeleteQueries(OCCLUSION_QUERY_COUNT, occlusionQueries); occlusionQueries[0] = 0; }
+
+	if (instanceVBO != 0) { glDeleteBuffers(1, &instanceVBO); instanceVBO = 0; }
+	if (indirectBuffer != 0) { glDeleteBuffers(1, &indirectBuffer); indirectBuffer = 0; }
+	if (objectBuffer != 0) { glDeleteBuffers(1, &objectBuffer); objectBuffer = 0; }
+	if (instanceObjectBuffer != 0) { glDeleteBuffers(1, &instanceObjectBuffer); instanceObjectBuffer = 0; }
 	return true;
 }
 
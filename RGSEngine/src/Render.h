@@ -2,9 +2,44 @@
 #include <SDL3/SDL.h>
 #include <glm/glm.hpp>
 #include <memory>
+#include <vector>
+#include <cstdint>
+
+#include "BoundingVolumes.h"
+#include "GpuCulling.h"
+#include "SoftwareOcclusion.h"
+#include "RenderQueue.h"
 
 class Shader;
 class GameObject;
+class ComponentMesh;
+class ResourceMesh;
+class ComponentCamera;
+
+// Layout glMultiDrawElementsIndirect reads from the GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand
+{
+	uint32_t count = 0;
+	uint32_t instanceCount = 1;
+	uint32_t firstIndex = 0;
+	int32_t baseVertex = 0;
+	uint32_t baseInstance = 0;
+};
+
+// One per opaque item on the object buffer of the multi draw indirect path, std430 layout
+struct ObjectData
+{
+	glm::mat4 model = glm::mat4(1.0f); // World matrix with the dequantize matrix of the mesh
+	glm::vec4 material = glm::vec4(0.0f); // x: alpha test enabled, y: alpha threshold
+};
+
+// Where the depth of the large occluders is drawn before the occlusion test of the rest
+enum OccluderMode
+{
+	OCCLUDERS_OFF = 0,
+	OCCLUDERS_GPU = 1,      // Depth pre-pass and Hi-Z pyramid on the GPU
+	OCCLUDERS_SOFTWARE = 2  // The LOD drawn rasterized on the CPU
+};
 
 class Render : public Module
 {
@@ -50,6 +85,52 @@ public:
 	bool drawVertexNormals;
 	bool drawFaceNormals;
 
+	// Frustum culling
+	bool frustumCulling;
+	unsigned int culledMeshes;  // Meshes skipped on the last frame
+	unsigned int visibleMeshes; // Meshes drawn on the last frame
+
+	// Meshlets of the visible meshes tested against the frustum and, with the backface culling, against the camera
+	bool clusterCulling;
+	bool backfaceCulling;
+	unsigned int culledClusters;
+	unsigned int visibleClusters;
+
+	// LOD from the size of the bounding sphere on the screen, see ComponentMesh::SelectLod
+	bool lodSelection;
+	float lodScreenSize;
+	float lodHysteresis;
+
+	// The opaque queue goes on the shared geometry buffers with one glMultiDrawElementsIndirect per texture
+	bool indirectRendering;
+
+	// On the indirect path, the objects are tested by a compute shader against the frustum and the depth of the previous frame
+	// The counts come one frame late, validation reads everything back and compares it with the CPU reference
+	bool gpuCulling;
+	bool occlusionCulling;
+	bool validateGpuCulling;
+	unsigned int gpuCullingMismatches;
+	unsigned int gpuVisibleInstances;
+	unsigned int gpuFrustumCulled;
+	unsigned int gpuOccluded;
+
+	// The opaque meshes larger than occluderScreenSize draw their depth first, the meshes whose box is behind it are dropped
+	// With the GPU culling on the indirect path the compute shader does the test, if not the pyramid is read back to the CPU
+	int occluderMode;
+	float occluderScreenSize;
+	int maxOccluders;
+	unsigned int occluders;
+	unsigned int occluderTriangles;
+	unsigned int occludedMeshes;
+	float occlusionTimeMs;     // CPU, selection, submission and the test of the queues
+	float occlusionGpuTimeMs;  // GPU occluder pass and pyramid reduction, from a frame a few frames old
+	// Render queue stats of the last frame
+	unsigned int drawCalls;
+	unsigned int instancedDrawCalls;
+	unsigned int multiDrawCommands; // Commands of all the glMultiDrawElementsIndirect of the indirect path
+	unsigned int stateChanges;  // Shader, texture, VAO, blend and alpha test changes
+	unsigned int renderedTriangles;
+
 	void ProcessKeyboardMovement(float dt);
 	void FocusOnGameObject(GameObject* go);
 
@@ -95,13 +176,99 @@ private:
 	void ProcessMouseFreeLook(int deltaX, int deltaY);
 	void ProcessMouseOrbit(int deltaX, int deltaY);
 
-	void DrawGameObject(GameObject* go, const glm::mat4& parentTransform);
+	// Render queue: the scene is collected on flat lists, sorted to group the GL state and then submitted
+	void CollectGameObject(GameObject* go);
+	void SortRenderQueue();
+
+	// Draws the depth of the occluders and removes the items hidden by it from both queues
+	void CullOccludedItems();
+	void SubmitRenderQueue();
+
+	// --- Instancing ---
+	// Opaque items with the same geometry and texture are drawn with one glDrawElementsInstanced
+	unsigned int GetGeometryID(ResourceMesh* mesh);
+
+	static const unsigned int INSTANCE_BINDING = 8; // Vertex buffer binding of the matrices, away from the ones of glVertexAttribPointer
+
+	std::unique_ptr<Shader> instancedShader;
+	unsigned int instanceVBO = 0;
+	size_t instanceBufferCapacity = 0;
+	std::vector<glm::mat4> instanceMatrices;
+
+	unsigned int nextGeometryID = 1;
+
+	// --- Cluster culling ---
+	// The meshes drawn one by one only submit the ranges of their visible meshlets, with one glMultiDrawElementsIndirect
+	void CullClusters(DrawItem& item);
+
+	unsigned int indirectBuffer = 0;
+	size_t indirectBufferCapacity = 0;
+	std::vector<DrawElementsIndirectCommand> indirectCommands;
+
+	// --- Multi draw indirect ---
+	// Consecutive commands with the same texture and VAO, drawn with one call
+	// With the GPU culling, the commands of the run that survive are compacted to its start
+	struct IndirectRun
+	{
+		unsigned int textureID = 0;
+		unsigned int VAO = 0;
+		unsigned int indexType = 0;
+		uint32_t firstCommand = 0;
+		uint32_t commandCount = 0;
+	};
+
+	void BuildIndirectQueue();
+	void SubmitIndirectQueue();
+
+	// Each command gets its own slots on the instance buffer, from its baseInstance, with the object of each instance
+	void AddInstances(uint32_t command, uint32_t firstObject, uint32_t count);
+
+	static const unsigned int OBJECT_BINDING = 0; // Shader storage bindings of the object and instance buffers
+	static const unsigned int INSTANCE_OBJECT_BINDING = 1;
+
+	std::unique_ptr<Shader> indirectShader;
+	unsigned int objectBuffer = 0;
+	size_t objectBufferCapacity = 0;
+	unsigned int instanceObjectBuffer = 0;
+	size_t instanceObjectBufferCapacity = 0;
+	std::vector<ObjectData> objects;
+	std::vector<BoundingSphere> objectSpheres; // World space, for the GPU culling
+	std::vector<uint32_t> instanceObjects;
+	std::vector<IndirectRun> indirectRuns;
+
+	std::unique_ptr<GpuCulling> cullingPass;
+	std::vector<CullEntry> cullEntries;
+	std::vector<glm::uvec2> commandRuns;
+
+	// --- Occluders ---
+	static const int OCCLUDER_READBACK_WIDTH = 256;
+
+	SoftwareOcclusion softwareOcclusion;
+	DepthPyramid occluderPyramid; // Read back from the GPU pass when the compute shader doesn't test the objects
+	std::vector<uint32_t> occluderItems;
+
+	// GL_TIME_ELAPSED of the GPU occluder pass, a ring so a result is only read once the GPU has it
+	static const unsigned int OCCLUSION_QUERY_COUNT = 3;
+	unsigned int occlusionQueries[OCCLUSION_QUERY_COUNT] = {};
+	bool occlusionQueryPending[OCCLUSION_QUERY_COUNT] = {};
+	unsigned int occlusionQueryFrame = 0;
+
+	std::vector<DrawItem> opaqueQueue;
+	std::vector<DrawItem> blendedQueue;
+	std::vector<ComponentCamera*> cameraGizmos;
 
 	void CreateDefaultCheckerTexture();
 
 	glm::mat4 viewMatrix;
 	glm::mat4 projectionMatrix;
 
+	// Planes of the editor camera, extracted each frame from projection * view
+	Frustum frustum;
+
+	// The BVH query stamps the visible meshes with this frame so CollectGameObject only has to compare
+	uint64_t cullingFrame = 0;
+	std::vector<GameObject*> visibleObjects;
+
 	unsigned int gridVAO = 0;
 	unsigned int gridVBO = 0;
 	unsigned int gridVertexCount = 0;
@@ -0,0 +1,47 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+
+uint64_t RenderQueue::MakeSortKey(unsigned int shaderID, unsigned int textureID, unsigned int geometryID, unsigned int lod)
+{
+	return ((uint64_t)(shaderID & 0xFFFF) << 48) |
+		((uint64_t)(textureID & 0xFFFFFF) << 24) |
+		(uint64_t)(((geometryID << 3) | lod) & 0xFFFFFF);
+}
+
+bool RenderQueue::CanShareBatch(const DrawItem& a, const DrawItem& b)
+{
+	return a.sortKey == b.sortKey && a.alphaTest == b.alphaTest && a.alphaThreshold == b.alphaThreshold;
+}
+
+void RenderQueue::Sort(std::vector<DrawItem>& opaqueQueue, std::vector<DrawItem>& blendedQueue)
+{
+	// The alpha test isn't on the key, it's compared after it so the items that can share a batch stay together
+	std::sort(opaqueQueue.begin(), opaqueQueue.end(),
+		[](const DrawItem& a, const DrawItem& b)
+		{
+			if (a.sortKey != b.sortKey) return a.sortKey < b.sortKey;
+			if (a.alphaTest != b.alphaTest) return a.alphaTest < b.alphaTest;
+			return a.alphaThreshold < b.alphaThreshold;
+		});
+
+	// Back to front so the blending mixes with what is already behind
+	std::sort(blendedQueue.begin(), blendedQueue.end(),
+		[](const DrawItem& a, const DrawItem& b) { return a.depth > b.depth; });
+}
+
+void RenderQueue::BuildBatches(const std::vector<DrawItem>& opaqueQueue, std::vector<Batch>& batches)
+{
+	batches.clear();
+	for (size_t i = 0; i < opaqueQueue.size();)
+	{
+		size_t end = i + 1;
+		while (end < opaqueQueue.size() && CanShareBatch(opaqueQueue[i], opaqueQueue[end])) ++end;
+
+		Batch batch;
+		batch.first = i;
+		batch.count = end - i;
+		batches.push_back(batch);
+		i = end;
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+class ResourceMesh;
+
+// Everything needed to draw one mesh, collected from the scene before any GL call
+struct DrawItem
+{
+	ResourceMesh* mesh = nullptr;
+	glm::mat4 worldMatrix = glm::mat4(1.0f);
+
+	unsigned int shaderID = 0;
+	unsigned int textureID = 0;
+	unsigned int VAO = 0;
+	unsigned int geometryID = 0; // Same for the components that share the mesh resource
+
+	bool alphaTest = false;
+	float alphaThreshold = 0.0f;
+
+	bool blending = false;
+	unsigned int blendSrc = 0;
+	unsigned int blendDst = 0;
+
+	float depth = 0.0f;      // View space distance, for the back to front order of the transparent items
+	uint64_t sortKey = 0;    // Shader | texture | geometry, for the opaque items
+
+	unsigned int lod = 0;    // Range of the IBO of the mesh that is drawn
+	float screenSize = 0.0f; // Height of the bounding sphere as a fraction of the screen height
+
+	bool occluder = false;   // Drawn to the occlusion depth this frame, never tested against it
+
+	// Drawn with the commands of the meshlets that passed the cluster culling, firstCommand is on the indirect buffer
+	bool clustered = false;
+	uint32_t firstCommand = 0;
+	uint32_t commandCount = 0;
+};
+
+// Sort and batching of the render queue, apart from Render so they can be tested without OpenGL
+namespace RenderQueue
+{
+	// Opaque items with the same geometry and texture from this count are drawn with one glDrawElementsInstanced
+	static const size_t MIN_INSTANCES = 2;
+
+	// Items of the sorted opaque queue that go on the same draw, instanced when there are MIN_INSTANCES or more
+	struct Batch
+	{
+		size_t first = 0;
+		size_t count = 0;
+		size_t instanceOffset = 0; // First matrix on the instance buffer, set by Render
+	};
+
+	// Shader, then texture, then geometry and LOD: the most expensive changes are the ones grouped first
+	// and the items with the same geometry and LOD end together, ready to be drawn instanced
+	uint64_t MakeSortKey(unsigned int shaderID, unsigned int textureID, unsigned int geometryID, unsigned int lod);
+
+	// Items that can go on the same instanced call: same shader, texture, geometry and alpha test
+	bool CanShareBatch(const DrawItem& a, const DrawItem& b);
+
+	// The opaque items by their key, the blended ones back to front
+	void Sort(std::vector<DrawItem>& opaqueQueue, std::vector<DrawItem>& blendedQueue);
+
+	// Splits the sorted opaque queue in batches of consecutive items that can share a call
+	void BuildBatches(const std::vector<DrawItem>& opaqueQueue, std::vector<Batch>& batches);
+}
@@ -0,0 +1,283 @@
+#include "ResourceMesh.h"
+#include "Log.h"
+
+#include <glad/glad.h>
+
+bool ResourceMesh::quantizePositions = true;
+bool ResourceMesh::optimizeVertexCache = true;
+bool ResourceMesh::generateLods = true;
+
+ResourceMesh::ResourceMesh(const std::string& libraryPath) : libraryPath(libraryPath)
+{
+}
+
+ResourceMesh::~ResourceMesh()
+{
+    // The last component using the mesh is gone, free the GPU buffers
+    CleanUp();
+}
+
+void ResourceMesh::Load(const PackedMeshView& packed, std::shared_ptr<GeometryPool> geometryPool)
+{
+    // Clear previous buffers if they exist
+    CleanUp();
+
+    vertexCount = packed.vertexCount;
+    indexCount = packed.indexCount;
+    vertexStride = packed.GetStride();
+    indexType = packed.HasFlag(VERTEX_INDEX_16) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    dequantizeMatrix = packed.GetDequantizeMatrix();
+
+    // Bounds in local space, kept here so the culling doesn't need the vertices again
+    localAABB = packed.bounds;
+    localSphere = BoundingSphere::FromAABB(localAABB);
+
+    // CPU copy for the picking, the triangle BVH is built from it the first time a ray reaches this mesh
+    cpuPositions.resize((size_t)vertexCount * 3);
+    for (unsigned int i = 0; i < vertexCount; ++i)
+    {
+        glm::vec3 position = packed.GetPosition(i);
+        cpuPositions[i * 3 + 0] = position.x;
+        cpuPositions[i * 3 + 1] = position.y;
+        cpuPositions[i * 3 + 2] = position.z;
+    }
+    cpuIndices.resize(indexCount);
+    for (unsigned int i = 0; i < indexCount; ++i) cpuIndices[i] = packed.GetIndex(i);
+    triangleBVH.reset();
+
+    meshlets.assign(packed.meshlets, packed.meshlets + packed.meshletCount);
+
+    MeshLod fullMesh;
+    fullMesh.indexCount = indexCount;
+    lods.assign(1, fullMesh);
+    lods.insert(lods.end(), packed.lods, packed.lods + packed.lodCount);
+
+    lodIndices.resize(packed.lodIndexCount);
+    for (unsigned int i = 0; i < packed.lodIndexCount; ++i) lodIndices[i] = packed.GetLodIndex(i);
+
+    // New range, Render assigns again the geometry
+    geometryID = 0;
+
+    // The vertices and the indices, with the ones of the LODs after the full mesh, go to the shared buffers
+    if (geometryPool == nullptr || !geometryPool->Allocate(packed, allocation))
+    {
+        LOG("Error: Mesh %s doesn't fit on the geometry pool", libraryPath.c_str());
+        vertexCount = 0;
+        indexCount = 0;
+        return;
+    }
+    pool = geometryPool;
+    VAO = pool->GetVAO();
+    gpuBytes += (size_t)allocation.vertexCount * vertexStride + (size_t)allocation.indexCount * packed.GetIndexSize();
+
+    if (!packed.HasFlag(VERTEX_HAS_UVS)) LOG("No UV coordinates provided");
+
+    if (packed.HasFlag(VERTEX_HAS_NORMALS))
+    {
+        // Setup of buffers to show normals
+        SetupNormalsBuffers(packed);
+    }
+    else
+    {
+        LOG("No normals provided");
+    }
+
+    SetupFaceNormalsBuffers();
+
+    LOG("Mesh loaded to GPU: VAO=%d, base vertex=%d, first index=%d, Vertices=%d, Indices=%d, %d bytes per vertex, %d bit indices",
+        VAO, allocation.baseVertex, allocation.firstIndex, vertexCount, indexCount, vertexStride, (indexType == GL_UNSIGNED_SHORT) ? 16 : 32);
+}
+
+bool ResourceMesh::RayCast(const Ray& localRay, float maxDistance, float& hitDistance)
+{
+    if (cpuIndices.empty()) return false;
+
+    if (triangleBVH == nullptr)
+    {
+        triangleBVH = std::make_unique<TriangleBVH>();
+        triangleBVH->Build(cpuPositions.data(), (unsigned int)cpuPositions.size() / 3, cpuIndices.data(), (unsigned int)cpuIndices.size());
+        LOG("Triangle BVH built for picking: %d triangles, %d nodes", (int)triangleBVH->GetTriangleCount(), (int)triangleBVH->GetNodeCount());
+    }
+
+    uint32_t triangle;
+    return triangleBVH->RayCast(localRay, maxDistance, hitDistance, triangle);
+}
+
+void ResourceMesh::SetupInstanceAttributes(unsigned int bindingIndex)
+{
+    if (pool != nullptr) pool->SetupInstanceAttributes(bindingIndex);
+}
+
+void ResourceMesh::SetupNormalsBuffers(const PackedMeshView& packed)
+{
+    const float NORMAL_LINE_LENGTH = 0.2f; // Length of the normal line
+    normalVertexCount = vertexCount * 2; // 2 vertex for line
+    std::vector<float> lineData(normalVertexCount * 3); // 3 floats for vertex (xyz)
+
+    for (unsigned int i = 0; i < vertexCount; ++i)
+    {
+        glm::vec3 normal = packed.GetNormal(i);
+
+        // Starting point, vertex
+        lineData[i * 6 + 0] = cpuPositions[i * 3 + 0];
+        lineData[i * 6 + 1] = cpuPositions[i * 3 + 1];
+        lineData[i * 6 + 2] = cpuPositions[i * 3 + 2];
+
+        // Ending point (vertex + normal * Length)
+        lineData[i * 6 + 3] = cpuPositions[i * 3 + 0] + normal.x * NORMAL_LINE_LENGTH;
+        lineData[i * 6 + 4] = cpuPositions[i * 3 + 1] + normal.y * NORMAL_LINE_LENGTH;
+        lineData[i * 6 + 5] = cpuPositions[i * 3 + 2] + normal.z * NORMAL_LINE_LENGTH;
+    }
+
+    // Create VAO and VBO for the lines of the normals
+    glGenVertexArrays(1, &normalsVAO);
+    glBindVertexArray(normalsVAO);
+
+    glGenBuffers(1, &normalsVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, normalsVBO);
+    glBufferData(GL_ARRAY_BUFFER, lineData.size() * sizeof(float), lineData.data(), GL_STATIC_DRAW);
+    gpuBytes += lineData.size() * sizeof(float);
+
+    // Only needed the attribute of position (layout 0)
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    // Unbind
+    glBindVertexArray(0);
+
+    LOG("Normals visualization buffers created: VAO=%d, VBO=%d, Lines=%d", normalsVAO, normalsVBO, vertexCount);
+}
+
+void ResourceMesh::SetupFaceNormalsBuffers()
+{
+    if (indexCount == 0 || cpuPositions.empty()) return;
+
+    const float NORMAL_LINE_LENGTH = 0.2f;
+    std::vector<float> lineData;
+    lineData.reserve((indexCount / 3) * 6);
+
+    // Iterate for each triangle
+    for (unsigned int i = 0; i + 2 < indexCount; i += 3)
+    {
+        // Obtain the index of the 3 vertexs of the triangle
+        unsigned int idx0 = cpuIndices[i];
+        unsigned int idx1 = cpuIndices[i + 1];
+        unsigned int idx2 = cpuIndices[i + 2];
+
+        // Obtain the XYZ coords of the 3 vertexs
+        glm::vec3 v0(cpuPositions[idx0 * 3], cpuPositions[idx0 * 3 + 1], cpuPositions[idx0 * 3 + 2]);
+        glm::vec3 v1(cpuPositions[idx1 * 3], cpuPositions[idx1 * 3 + 1], cpuPositions[idx1 * 3 + 2]);
+        glm::vec3 v2(cpuPositions[idx2 * 3], cpuPositions[idx2 * 3 + 1], cpuPositions[idx2 * 3 + 2]);
+
+        // Calculate the center
+        glm::vec3 center = (v0 + v1 + v2) / 3.0f;
+
+        // Calculate the normal of the face, cross product of 2 edges
+        glm::vec3 edge1 = v1 - v0;
+        glm::vec3 edge2 = v2 - v0;
+        glm::vec3 normal = glm::normalize(glm::cross(edge1, edge2));
+
+        // Starting point, center
+        lineData.push_back(center.x);
+        lineData.push_back(center.y);
+        lineData.push_back(center.z);
+
+        // Ending point (center + normal * Length)
+        glm::vec3 endPoint = center + normal * NORMAL_LINE_LENGTH;
+        lineData.push_back(endPoint.x);
+        lineData.push_back(endPoint.y);
+        lineData.push_back(endPoint.z);
+    }
+
+    faceNormalVertexCount = lineData.size() / 3;
+
+    // Create VAO and VBO for the normal faces
+    glGenVertexArrays(1, &faceNormalsVAO);
+    glBindVertexArray(faceNormalsVAO);
+
+    glGenBuffers(1, &faceNormalsVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, faceNormalsVBO);
+    glBufferData(GL_ARRAY_BUFFER, lineData.size() * sizeof(float), lineData.data(), GL_STATIC_DRAW);
+    gpuBytes += lineData.size() * sizeof(float);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glBindVertexArray(0);
+
+    LOG("Face Normals generated: %d lines", faceNormalVertexCount / 2);
+}
+
+void ResourceMesh::Draw()
+{
+    if (VAO != 0 && indexCount > 0)
+    {
+        glBindVertexArray(VAO);
+        glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, indexType, GetLodOffset(0), GetBaseVertex());
+        glBindVertexArray(0);
+    }
+}
+
+void ResourceMesh::DrawNormals()
+{
+    if (normalsVAO != 0 && normalVertexCount > 0)
+    {
+        glBindVertexArray(normalsVAO);
+        // Draw GL_LINES, using the VBO prepared on the SetupNormalsBuffers
+        glDrawArrays(GL_LINES, 0, normalVertexCount);
+        glBindVertexArray(0);
+    }
+}
+
+void ResourceMesh::DrawFaceNormals()
+{
+    if (faceNormalsVAO != 0 && faceNormalVertexCount > 0)
+    {
+        glBindVertexArray(faceNormalsVAO);
+        // Draw GL_LINES, using the VBO prepared on the SetupFaceNormalsBuffers
+        glDrawArrays(GL_LINES, 0, faceNormalVertexCount);
+        glBindVertexArray(0);
+    }
+}
+
+size_t ResourceMesh::GetCPUBytes() const
+{
+    return cpuPositions.size() * sizeof(float) + (cpuIndices.size() + lodIndices.size()) * sizeof(unsigned int) + meshlets.size() * sizeof(Meshlet) + lods.size() * sizeof(MeshLod);
+}
+
+void ResourceMesh::CleanUp()
+{
+    // The VAO belongs to the pool, only the range is given back
+    if (pool != nullptr)
+    {
+        pool->Free(allocation);
+        pool.reset();
+    }
+    allocation = GeometryAllocation();
+    VAO = 0;
+    if (normalsVAO != 0)
+    {
+        glDeleteVertexArrays(1, &normalsVAO);
+        normalsVAO = 0;
+    }
+    if (normalsVBO != 0)
+    {
+        glDeleteBuffers(1, &normalsVBO);
+        normalsVBO = 0;
+    }
+    normalVertexCount = 0;
+    if (faceNormalsVAO != 0)
+    {
+        glDeleteVertexArrays(1, &faceNormalsVAO);
+        faceNormalsVAO = 0;
+    }
+    if (faceNormalsVBO != 0)
+    {
+        glDeleteBuffers(1, &faceNormalsVBO);
+        faceNormalsVBO = 0;
+    }
+    faceNormalVertexCount = 0;
+    vertexCount = 0;
+    indexCount = 0;
+    gpuBytes = 0;
+}
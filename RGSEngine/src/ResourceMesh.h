@@ -0,0 +1,107 @@
+#pragma once
+
+#include "BoundingVolumes.h"
+#include "TriangleBVH.h"
+#include "VertexFormat.h"
+#include "GeometryPool.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+
+// Geometry of a mesh uploaded once to the GPU and shared by all the ComponentMesh that use the same library asset
+// ModuleResources caches it by its library path, its range of the geometry pool is freed when the last component releases it
+class ResourceMesh
+{
+public:
+
+    ResourceMesh(const std::string& libraryPath);
+    ~ResourceMesh();
+
+    // Uploads the vertices and indices to a range of the pool, the CPU copy for the picking and the debug lines are decoded from them
+    void Load(const PackedMeshView& packed, std::shared_ptr<GeometryPool> geometryPool);
+
+    void CleanUp();
+
+    // Exact ray test against the triangles, the ray must be in the local space of the mesh
+    bool RayCast(const Ray& localRay, float maxDistance, float& hitDistance);
+
+    // Adds the per instance model matrix (locations 3 to 6) to the VAO of the pool, read from the buffer Render binds on bindingIndex
+    void SetupInstanceAttributes(unsigned int bindingIndex);
+
+    // Where the indices of a LOD start on the index buffer of the pool, in indices and as the offset of glDrawElements
+    uint32_t GetLodFirstIndex(unsigned int lod) const { return allocation.firstIndex + lods[lod].firstIndex; }
+    const void* GetLodOffset(unsigned int lod) const { return (const void*)((size_t)GetLodFirstIndex(lod) * pool->GetIndexSize()); }
+    int GetBaseVertex() const { return (int)allocation.baseVertex; }
+
+    void Draw();
+    void DrawNormals();
+    void DrawFaceNormals();
+
+    // Memory used by the buffers of this mesh, for the resources panel
+    size_t GetGPUBytes() const { return gpuBytes; }
+    size_t GetCPUBytes() const;
+
+public:
+
+    std::string libraryPath;
+
+    // Local space bounds of the vertices, used for the frustum culling
+    AABB localAABB;
+    BoundingSphere localSphere;
+
+    // Assigned by Render the first time the mesh is drawn, the meshes with the same id are drawn in one instanced call
+    unsigned int geometryID = 0;
+
+    // Geometry kept on the CPU for the picking
+    std::vector<float> cpuPositions;
+    std::vector<unsigned int> cpuIndices;
+    std::unique_ptr<TriangleBVH> triangleBVH;
+
+    // Indices of the simplified levels in the order of the index buffer, the software occlusion draws the LOD of each item with them
+    std::vector<unsigned int> lodIndices;
+    const unsigned int* GetLodIndices(unsigned int lod) const { return (lod == 0) ? cpuIndices.data() : lodIndices.data() + (lods[lod].firstIndex - indexCount); }
+
+    // Clusters of triangles with their bounds, Render culls them one by one and draws the ranges left
+    std::vector<Meshlet> meshlets;
+
+    // The full mesh first and then the simplified levels, all of them ranges of the allocation
+    std::vector<MeshLod> lods;
+
+    // Applied before the model matrix, so the shaders receive the quantized positions already in local space
+    glm::mat4 dequantizeMatrix = glm::mat4(1.0f);
+
+    // Shared by all the meshes with the same layout, the VAO is the one of the pool
+    std::shared_ptr<GeometryPool> pool;
+    GeometryAllocation allocation;
+
+    unsigned int VAO = 0;
+    unsigned int vertexCount = 0;
+    unsigned int indexCount = 0;
+    unsigned int indexType = 0; // GL_UNSIGNED_SHORT when the vertices fit, GL_UNSIGNED_INT if not
+    unsigned int vertexStride = 0;
+
+    // New meshes are packed with the positions quantized to 16 bits inside their bounds
+    static bool quantizePositions;
+
+    // New meshes get their triangles and vertices reordered for the post-transform cache and the fetches
+    static bool optimizeVertexCache;
+
+    // New meshes get simplified levels for the distance
+    static bool generateLods;
+
+    unsigned int normalsVAO = 0;
+    unsigned int normalsVBO = 0;
+    unsigned int normalVertexCount = 0;
+
+    unsigned int faceNormalsVAO = 0;
+    unsigned int faceNormalsVBO = 0;
+    unsigned int faceNormalVertexCount = 0;
+
+private:
+
+    void SetupNormalsBuffers(const PackedMeshView& packed);
+    void SetupFaceNormalsBuffers();
+
+    size_t gpuBytes = 0;
+};
@@ -0,0 +1,57 @@
+#include "ResourceTexture.h"
+#include "TextureFormat.h"
+#include "Log.h"
+
+#include <glad/glad.h>
+
+bool ResourceTexture::compressOnImport = true;
+
+ResourceTexture::ResourceTexture(const std::string& sourcePath) : sourcePath(sourcePath)
+{
+}
+
+ResourceTexture::~ResourceTexture()
+{
+    CleanUp();
+}
+
+void ResourceTexture::Reserve(unsigned int newTextureID)
+{
+    CleanUp();
+    textureID = newTextureID;
+}
+
+void ResourceTexture::SetTexture(unsigned int newTextureID, int newWidth, int newHeight, bool hasMipmaps)
+{
+    size_t bytes = (size_t)newWidth * newHeight * 4;
+    if (hasMipmaps) bytes += bytes / 3;
+    SetTexture(newTextureID, newWidth, newHeight, bytes, TEXTURE_RGBA8);
+}
+
+void ResourceTexture::SetTexture(unsigned int newTextureID, int newWidth, int newHeight, size_t newGPUBytes, unsigned int newEncoding)
+{
+    // The streamed textures fill the one they reserved
+    if (newTextureID != textureID) CleanUp();
+
+    textureID = newTextureID;
+    width = newWidth;
+    height = newHeight;
+    encoding = newEncoding;
+    gpuBytes = newGPUBytes;
+    ready = true;
+}
+
+void ResourceTexture::CleanUp()
+{
+    if (textureID != 0)
+    {
+        LOG("Texture released: %s (ID: %d)", sourcePath.c_str(), textureID);
+        glDeleteTextures(1, &textureID);
+        textureID = 0;
+    }
+    width = 0;
+    height = 0;
+    encoding = TEXTURE_RGBA8;
+    gpuBytes = 0;
+    ready = false;
+}
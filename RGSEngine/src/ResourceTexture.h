@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// OpenGL texture uploaded once and shared by all the ComponentTexture that use the same image
+// ModuleResources caches it by the canonical path of the source, the texture is deleted with the last reference
+class ResourceTexture
+{
+public:
+
+    ResourceTexture(const std::string& sourcePath);
+    ~ResourceTexture();
+
+    // Takes the ownership of a texture that is still being decoded, it's not ready until SetTexture
+    void Reserve(unsigned int textureID);
+
+    // Takes the ownership of the texture, the memory is estimated as RGBA8 (plus a third more with the mipmaps)
+    void SetTexture(unsigned int textureID, int width, int height, bool hasMipmaps);
+    // Same with the exact memory of the levels uploaded, encoding is a TextureEncoding
+    void SetTexture(unsigned int textureID, int width, int height, size_t gpuBytes, unsigned int encoding);
+
+    // False while the pixels are streaming, the components draw the default checker until then
+    bool IsReady() const { return ready; }
+
+    void CleanUp();
+
+    size_t GetGPUBytes() const { return gpuBytes; }
+
+public:
+
+    std::string sourcePath;  // Key on the cache
+    std::string libraryPath; // Internal path Library/Textures/
+
+    unsigned int textureID = 0;
+    int width = 0;
+    int height = 0;
+    unsigned int encoding = 0;
+
+    // New imports are saved with all their mips and block compressed (BC1, or BC3 with alpha)
+    static bool compressOnImport;
+
+private:
+
+    size_t gpuBytes = 0;
+    bool ready = false;
+};
@@ -28,9 +28,9 @@ void SceneState::CaptureGameObject(GameObject* go, uint64_t parentUID)
     ComponentTransform* transform = go->GetComponent<ComponentTransform>();
     if (transform)
     {
-        state.position = transform->position;
-        state.rotation = transform->rotation;
-        state.scale = transform->scale;
+        state.position = transform->GetPosition();
+        state.rotation = transform->GetRotation();
+        state.scale = transform->GetScale();
     }
     else
     {
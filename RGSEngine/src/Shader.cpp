@@ -24,6 +24,63 @@ namespace DefaultShaders
     }
     )";
 
+    // Same as the vertexShader but the model matrix comes per instance from the vertex attributes 3 to 6
+    const char* instancedVertexShader = R"(
+    #version 460 core
+    layout (location = 0) in vec3 aPos; // Positions
+    layout (location = 1) in vec2 aTexCoord; // Input UV
+    layout (location = 3) in mat4 aInstanceModel; // One column per location
+
+    uniform mat4 view;
+    uniform mat4 projection;
+
+    out vec2 TexCoord; // UV to the fragment shader
+
+    void main()
+    {
+        gl_Position = projection * view * aInstanceModel * vec4(aPos, 1.0);
+        TexCoord = aTexCoord; // Assign
+    }
+    )";
+
+    // For glMultiDrawElementsIndirect: the model matrix and the alpha test come from the object buffer
+    // Each command points its baseInstance to its first slot on the instance buffer, which has the index of the object
+    const char* indirectVertexShader = R"(
+    #version 460 core
+    layout (location = 0) in vec3 aPos; // Positions
+    layout (location = 1) in vec2 aTexCoord; // Input UV
+
+    struct ObjectData
+    {
+        mat4 model;
+        vec4 material; // x: alpha test enabled, y: alpha threshold
+    };
+
+    layout (std430, binding = 0) readonly buffer Objects
+    {
+        ObjectData objects[];
+    };
+
+    layout (std430, binding = 1) readonly buffer Instances
+    {
+        uint instanceObjects[];
+    };
+
+    uniform mat4 view;
+    uniform mat4 projection;
+
+    out vec2 TexCoord; // UV to the fragment shader
+    flat out vec2 AlphaTest;
+
+    void main()
+    {
+        ObjectData object = objects[instanceObjects[gl_BaseInstance + gl_InstanceID]];
+        gl_Position = projection * view * object.model * vec4(aPos, 1.0);
+        TexCoord = aTexCoord;
+        AlphaTest = object.material.xy;
+    }
+    )";
+
     const char* fragmentShader = R"(
     #version 460 core
     out vec4 FragColor;
@@ -48,6 +105,25 @@ namespace DefaultShaders
         FragColor = texColor; 
     }
     )";
+
+    // Same as the fragmentShader with the alpha test of each object
+    const char* indirectFragmentShader = R"(
+    #version 460 core
+    out vec4 FragColor;
+
+    in vec2 TexCoord;
+    flat in vec2 AlphaTest;
+    uniform sampler2D tex1;
+
+    void main()
+    {
+        vec4 texColor = texture(tex1, TexCoord);
+        if (AlphaTest.x > 0.5 && texColor.a < AlphaTest.y)
+            discard;
+
+        FragColor = texColor;
+    }
+    )";
 }
 
 Shader::Shader(const char* vertexSource, const char* fragmentSource)
@@ -82,6 +158,23 @@ Shader::Shader(const char* vertexSource, const char* fragmentSource)
     glDeleteShader(fragment);
 }
 
+std::unique_ptr<Shader> Shader::Compute(const char* computeSource)
+{
+    unsigned int compute = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(compute, 1, &computeSource, NULL);
+    glCompileShader(compute);
+
+    std::unique_ptr<Shader> program(new Shader(glCreateProgram()));
+    program->CheckCompileErrors(compute, "COMPUTE");
+
+    glAttachShader(program->ID, compute);
+    glLinkProgram(program->ID);
+    program->CheckCompileErrors(program->ID, "PROGRAM");
+
+    glDeleteShader(compute);
+    return program;
+}
+
 void Shader::Use()
 {
     glUseProgram(ID);
@@ -107,6 +200,16 @@ void Shader::SetMat4(const std::string& name, const glm::mat4& mat) const
     glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
 }
 
+void Shader::SetVec2(const std::string& name, const glm::vec2& value) const
+{
+    glUniform2f(glGetUniformLocation(ID, name.c_str()), value.x, value.y);
+}
+
+void Shader::SetVec4Array(const std::string& name, const glm::vec4* values, int count) const
+{
+    glUniform4fv(glGetUniformLocation(ID, name.c_str()), count, glm::value_ptr(values[0]));
+}
+
 void Shader::CheckCompileErrors(unsigned int shader, std::string type)
 {
     int success;
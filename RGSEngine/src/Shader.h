@@ -2,8 +2,19 @@
 
 #include <glad/glad.h>
 #include <string>
+#include <memory>
 #include <glm/glm.hpp>
 
+// Sources of the engine shaders
+namespace DefaultShaders
+{
+    extern const char* vertexShader;
+    extern const char* instancedVertexShader;
+    extern const char* indirectVertexShader;
+    extern const char* fragmentShader;
+    extern const char* indirectFragmentShader;
+}
+
 class Shader
 {
 public:
@@ -13,6 +24,9 @@ public:
     // Constructor
     Shader(const char* vertexSource = nullptr, const char* fragmentSource = nullptr);
 
+    // Program with only a compute stage, dispatched by the caller after Use
+    static std::unique_ptr<Shader> Compute(const char* computeSource);
+
 
     void Use();
 
@@ -21,8 +35,12 @@ public:
     void SetInt(const std::string& name, int value) const;
     void SetFloat(const std::string& name, float value) const;
     void SetMat4(const std::string& name, const glm::mat4& mat) const;
+    void SetVec2(const std::string& name, const glm::vec2& value) const;
+    void SetVec4Array(const std::string& name, const glm::vec4* values, int count) const;
 
 private:
 
+    Shader(unsigned int programID) : ID(programID) {}
+
     void CheckCompileErrors(unsigned int shader, std::string type);
 };
\ No newline at end of file
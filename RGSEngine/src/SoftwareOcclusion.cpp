@@ -0,0 +1,122 @@
+#include "SoftwareOcclusion.h"
+
+#include <algorithm>
+#include <cmath>
+
+void SoftwareOcclusion::Begin(float aspect, const glm::mat4& viewProjection)
+{
+    pyramid.width = WIDTH;
+    pyramid.height = std::max(1, (int)std::lround(WIDTH / std::max(aspect, 0.01f)));
+    pyramid.viewProjection = viewProjection;
+    pyramid.levels.resize(1);
+    pyramid.levels[0].assign((size_t)pyramid.width * pyramid.height, 1.0f);
+
+    triangleCount = 0;
+}
+
+// Point of the segment where it crosses the near plane, z = -w in clip space
+static glm::vec4 IntersectNear(const glm::vec4& inside, const glm::vec4& outside)
+{
+    float insideDistance = inside.z + inside.w;
+    float outsideDistance = outside.z + outside.w;
+    float t = insideDistance / (insideDistance - outsideDistance);
+    return inside + (outside - inside) * t;
+}
+
+void SoftwareOcclusion::RasterizeMesh(const float* positions, const unsigned int* indices, size_t indexCount, const glm::mat4& worldMatrix)
+{
+    if (indexCount < 3) return;
+
+    // Each vertex is transformed once, the indices only point to them
+    unsigned int vertexCount = 0;
+    for (size_t i = 0; i < indexCount; ++i) vertexCount = std::max(vertexCount, indices[i] + 1);
+
+    const glm::mat4 matrix = pyramid.viewProjection * worldMatrix;
+    clipPositions.resize(vertexCount);
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        clipPositions[v] = matrix * glm::vec4(positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2], 1.0f);
+    }
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        const glm::vec4 triangle[3] = { clipPositions[indices[i]], clipPositions[indices[i + 1]], clipPositions[indices[i + 2]] };
+
+        // Clipped against the near plane only, the others are handled by the bounds of the rasterization
+        glm::vec4 polygon[4];
+        int count = 0;
+        for (int e = 0; e < 3; ++e)
+        {
+            const glm::vec4& current = triangle[e];
+            const glm::vec4& next = triangle[(e + 1) % 3];
+            bool currentInside = current.z + current.w >= 0.0f;
+            bool nextInside = next.z + next.w >= 0.0f;
+
+            if (currentInside) polygon[count++] = current;
+            if (currentInside != nextInside) polygon[count++] = currentInside ? IntersectNear(current, next) : IntersectNear(next, current);
+        }
+
+        for (int k = 1; k + 1 < count; ++k) RasterizeTriangle(polygon[0], polygon[k], polygon[k + 1]);
+        if (count >= 3) ++triangleCount;
+    }
+}
+
+void SoftwareOcclusion::RasterizeTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+{
+    if (a.w <= 0.0f || b.w <= 0.0f || c.w <= 0.0f) return;
+
+    // Pixels of the buffer and window depth, z / w interpolates linearly on the screen
+    const float width = (float)pyramid.width;
+    const float height = (float)pyramid.height;
+    auto ToScreen = [&](const glm::vec4& clip)
+        {
+            return glm::vec3((clip.x / clip.w * 0.5f + 0.5f) * width, (clip.y / clip.w * 0.5f + 0.5f) * height, clip.z / clip.w * 0.5f + 0.5f);
+        };
+    glm::vec3 p0 = ToScreen(a);
+    glm::vec3 p1 = ToScreen(b);
+    glm::vec3 p2 = ToScreen(c);
+
+    float area = (p1.x - p0.x) * (p2.y - p0.y) - (p1.y - p0.y) * (p2.x - p0.x);
+    if (std::abs(area) < 1e-8f) return;
+
+    // Both windings, the weights are positive inside once divided by the signed area
+    const float invArea = 1.0f / area;
+
+    // Change of each weight along a texel, a texel is written only when the weights are positive on its four corners,
+    // the corner most outside of an edge is half a texel away from the centre on both axes
+    const glm::vec3 stepX = glm::vec3(p1.y - p2.y, p2.y - p0.y, p0.y - p1.y) * invArea;
+    const glm::vec3 stepY = glm::vec3(p2.x - p1.x, p0.x - p2.x, p1.x - p0.x) * invArea;
+    const glm::vec3 cornerMargin = (glm::abs(stepX) + glm::abs(stepY)) * 0.5f;
+
+    // And it keeps the farthest depth of the triangle on the texel, so the occluder is never nearer than it is
+    const glm::vec3 depths(p0.z, p1.z, p2.z);
+    const float depthMargin = (std::abs(glm::dot(stepX, depths)) + std::abs(glm::dot(stepY, depths))) * 0.5f;
+
+    int minX = std::max(0, (int)std::floor(std::min(std::min(p0.x, p1.x), p2.x)));
+    int maxX = std::min(pyramid.width - 1, (int)std::ceil(std::max(std::max(p0.x, p1.x), p2.x)));
+    int minY = std::max(0, (int)std::floor(std::min(std::min(p0.y, p1.y), p2.y)));
+    int maxY = std::min(pyramid.height - 1, (int)std::ceil(std::max(std::max(p0.y, p1.y), p2.y)));
+
+    std::vector<float>& depth = pyramid.levels[0];
+    for (int y = minY; y <= maxY; ++y)
+    {
+        float py = y + 0.5f;
+        for (int x = minX; x <= maxX; ++x)
+        {
+            float px = x + 0.5f;
+            float w0 = ((p2.x - p1.x) * (py - p1.y) - (p2.y - p1.y) * (px - p1.x)) * invArea;
+            float w1 = ((p0.x - p2.x) * (py - p2.y) - (p0.y - p2.y) * (px - p2.x)) * invArea;
+            float w2 = 1.0f - w0 - w1;
+            if (w0 < cornerMargin.x || w1 < cornerMargin.y || w2 < cornerMargin.z) continue;
+
+            float z = glm::clamp(w0 * p0.z + w1 * p1.z + w2 * p2.z + depthMargin, 0.0f, 1.0f);
+            float& texel = depth[(size_t)y * pyramid.width + x];
+            texel = std::min(texel, z);
+        }
+    }
+}
+
+void SoftwareOcclusion::End()
+{
+    pyramid.Reduce();
+}
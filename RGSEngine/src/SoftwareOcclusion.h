@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+
+#include "DepthPyramid.h"
+
+// Occluders rasterized on the CPU to a small depth buffer, for the occlusion test without reading anything back from the GPU
+// Only the depth is written, nearest wins, and both faces are drawn so open meshes like walls also occlude
+// A texel is only written when a triangle covers all of it, with the farthest depth of the triangle on it, so the occluders never grow
+class SoftwareOcclusion
+{
+public:
+
+    // Width of the depth buffer, the height follows the aspect of the screen
+    static const int WIDTH = 256;
+
+    // Clears the depth buffer to the far plane
+    void Begin(float aspect, const glm::mat4& viewProjection);
+
+    // Triangles of a mesh with its positions in local space, 3 floats each
+    void RasterizeMesh(const float* positions, const unsigned int* indices, size_t indexCount, const glm::mat4& worldMatrix);
+
+    // Builds the pyramid from the depth buffer, IsOccluded can be used after it
+    void End();
+
+    bool IsOccluded(const AABB& worldBox) const { return pyramid.IsOccluded(worldBox); }
+
+    const DepthPyramid& GetPyramid() const { return pyramid; }
+    unsigned int GetTriangleCount() const { return triangleCount; }
+
+private:
+
+    // The triangle is already on the near side of the camera, clip space in
+    void RasterizeTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+
+    DepthPyramid pyramid;
+    std::vector<glm::vec4> clipPositions;
+    unsigned int triangleCount = 0;
+};
@@ -0,0 +1,288 @@
+#include "TextureFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+size_t TextureFormat::GetLevelSize(uint32_t encoding, uint32_t width, uint32_t height)
+{
+    if (encoding == TEXTURE_RGBA8) return (size_t)width * height * 4;
+
+    size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+    return blocks * ((encoding == TEXTURE_BC1) ? 8 : 16);
+}
+
+std::vector<std::vector<uint8_t>> TextureFormat::GenerateMipChain(const uint8_t* rgba, uint32_t width, uint32_t height)
+{
+    std::vector<std::vector<uint8_t>> levels;
+    levels.emplace_back(rgba, rgba + (size_t)width * height * 4);
+
+    while (width > 1 || height > 1)
+    {
+        uint32_t nextWidth = std::max(1u, width / 2);
+        uint32_t nextHeight = std::max(1u, height / 2);
+
+        const std::vector<uint8_t>& source = levels.back();
+        std::vector<uint8_t> level((size_t)nextWidth * nextHeight * 4);
+
+        for (uint32_t y = 0; y < nextHeight; ++y)
+        {
+            // The odd last row or column is repeated
+            uint32_t y0 = std::min(y * 2, height - 1);
+            uint32_t y1 = std::min(y * 2 + 1, height - 1);
+
+            for (uint32_t x = 0; x < nextWidth; ++x)
+            {
+                uint32_t x0 = std::min(x * 2, width - 1);
+                uint32_t x1 = std::min(x * 2 + 1, width - 1);
+
+                for (int c = 0; c < 4; ++c)
+                {
+                    uint32_t sum = source[((size_t)y0 * width + x0) * 4 + c] + source[((size_t)y0 * width + x1) * 4 + c] +
+                        source[((size_t)y1 * width + x0) * 4 + c] + source[((size_t)y1 * width + x1) * 4 + c];
+                    level[((size_t)y * nextWidth + x) * 4 + c] = (uint8_t)((sum + 2) / 4);
+                }
+            }
+        }
+
+        levels.push_back(std::move(level));
+        width = nextWidth;
+        height = nextHeight;
+    }
+
+    return levels;
+}
+
+static uint16_t To565(const float* color)
+{
+    int r = (int)std::lround(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f);
+    int g = (int)std::lround(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f);
+    int b = (int)std::lround(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void From565(uint16_t color, int* rgb)
+{
+    int r = (color >> 11) & 31;
+    int g = (color >> 5) & 63;
+    int b = color & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// 4 color mode of BC1 (the only one of BC3): endpoints on the main axis of the colors of the block
+static void CompressColorBlock(const uint8_t* block, uint8_t* output)
+{
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 3; ++c) mean[c] += block[i * 4 + c] / 16.0f;
+
+    float covariance[6] = {}; // rr, rg, rb, gg, gb, bb
+    for (int i = 0; i < 16; ++i)
+    {
+        float r = block[i * 4] - mean[0], g = block[i * 4 + 1] - mean[1], b = block[i * 4 + 2] - mean[2];
+        covariance[0] += r * r; covariance[1] += r * g; covariance[2] += r * b;
+        covariance[3] += g * g; covariance[4] += g * b; covariance[5] += b * b;
+    }
+
+    // A few power iterations are enough to find the main axis
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 4; ++iteration)
+    {
+        float next[3] = {
+            covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+            covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+            covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2] };
+        float length = std::max({ std::abs(next[0]), std::abs(next[1]), std::abs(next[2]) });
+        if (length <= 0.0f) break;
+        for (int c = 0; c < 3; ++c) axis[c] = next[c] / length;
+    }
+
+    float minProjection = 0.0f, maxProjection = 0.0f;
+    for (int i = 0; i < 16; ++i)
+    {
+        float projection = 0.0f;
+        for (int c = 0; c < 3; ++c) projection += (block[i * 4 + c] - mean[c]) * axis[c];
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+
+    float axisLength = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    float maxColor[3], minColor[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        float scale = (axisLength > 0.0f) ? axis[c] / axisLength : 0.0f;
+        maxColor[c] = mean[c] + maxProjection * scale;
+        minColor[c] = mean[c] + minProjection * scale;
+    }
+
+    uint16_t color0 = To565(maxColor);
+    uint16_t color1 = To565(minColor);
+    if (color0 < color1) std::swap(color0, color1);
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        int palette[4][3];
+        From565(color0, palette[0]);
+        From565(color1, palette[1]);
+        for (int c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0, bestError = INT32_MAX;
+            for (int p = 0; p < 4; ++p)
+            {
+                int error = 0;
+                for (int c = 0; c < 3; ++c)
+                {
+                    int d = block[i * 4 + c] - palette[p][c];
+                    error += d * d;
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (i * 2);
+        }
+    }
+
+    memcpy(output, &color0, 2);
+    memcpy(output + 2, &color1, 2);
+    memcpy(output + 4, &indices, 4);
+}
+
+void TextureFormat::CompressBlockBC1(const uint8_t* block, uint8_t* output)
+{
+    CompressColorBlock(block, output);
+}
+
+void TextureFormat::CompressBlockBC3(const uint8_t* block, uint8_t* output)
+{
+    uint8_t alpha0 = 0, alpha1 = 255;
+    for (int i = 0; i < 16; ++i)
+    {
+        alpha0 = std::max(alpha0, block[i * 4 + 3]);
+        alpha1 = std::min(alpha1, block[i * 4 + 3]);
+    }
+
+    // alpha0 > alpha1 selects the mode with 6 interpolated values
+    uint64_t indices = 0;
+    if (alpha0 > alpha1)
+    {
+        int palette[8] = { alpha0, alpha1 };
+        for (int p = 1; p < 7; ++p) palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0, bestError = INT32_MAX;
+            for (int p = 0; p < 8; ++p)
+            {
+                int error = std::abs(block[i * 4 + 3] - palette[p]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (uint64_t)best << (i * 3);
+        }
+    }
+
+    output[0] = alpha0;
+    output[1] = alpha1;
+    for (int b = 0; b < 6; ++b) output[2 + b] = (uint8_t)(indices >> (b * 8));
+
+    CompressColorBlock(block, output + 8);
+}
+
+PackedTexture TextureFormat::Pack(const uint8_t* rgba, uint32_t width, uint32_t height, bool compress)
+{
+    PackedTexture texture;
+    texture.width = width;
+    texture.height = height;
+
+    if (compress && width % 4 == 0 && height % 4 == 0)
+    {
+        bool hasAlpha = false;
+        for (size_t i = 0; i < (size_t)width * height && !hasAlpha; ++i) hasAlpha = rgba[i * 4 + 3] < 255;
+        texture.encoding = hasAlpha ? TEXTURE_BC3 : TEXTURE_BC1;
+    }
+
+    std::vector<std::vector<uint8_t>> mips = GenerateMipChain(rgba, width, height);
+
+    size_t totalSize = 0;
+    uint32_t levelWidth = width, levelHeight = height;
+    for (size_t l = 0; l < mips.size(); ++l)
+    {
+        TextureLevel level;
+        level.width = levelWidth;
+        level.height = levelHeight;
+        level.offset = totalSize;
+        level.size = GetLevelSize(texture.encoding, levelWidth, levelHeight);
+        texture.levels.push_back(level);
+
+        totalSize += level.size;
+        levelWidth = std::max(1u, levelWidth / 2);
+        levelHeight = std::max(1u, levelHeight / 2);
+    }
+
+    texture.data.resize(totalSize);
+
+    for (size_t l = 0; l < mips.size(); ++l)
+    {
+        const TextureLevel& level = texture.levels[l];
+        uint8_t* output = texture.data.data() + level.offset;
+
+        if (texture.encoding == TEXTURE_RGBA8)
+        {
+            memcpy(output, mips[l].data(), level.size);
+            continue;
+        }
+
+        const size_t blockSize = (texture.encoding == TEXTURE_BC1) ? 8 : 16;
+        const uint32_t blocksX = (level.width + 3) / 4;
+        const uint32_t blocksY = (level.height + 3) / 4;
+
+        for (uint32_t by = 0; by < blocksY; ++by)
+        {
+            for (uint32_t bx = 0; bx < blocksX; ++bx)
+            {
+                // The levels smaller than a block repeat their last texels
+                uint8_t block[16 * 4];
+                for (uint32_t y = 0; y < 4; ++y)
+                {
+                    uint32_t sy = std::min(by * 4 + y, level.height - 1);
+                    for (uint32_t x = 0; x < 4; ++x)
+                    {
+                        uint32_t sx = std::min(bx * 4 + x, level.width - 1);
+                        memcpy(&block[(y * 4 + x) * 4], &mips[l][((size_t)sy * level.width + sx) * 4], 4);
+                    }
+                }
+
+                uint8_t* blockOutput = output + ((size_t)by * blocksX + bx) * blockSize;
+                if (texture.encoding == TEXTURE_BC1) CompressBlockBC1(block, blockOutput);
+                else CompressBlockBC3(block, blockOutput);
+            }
+        }
+    }
+
+    return texture;
+}
+
+const char* TextureFormat::GetEncodingName(uint32_t encoding)
+{
+    switch (encoding)
+    {
+    case TEXTURE_BC1: return "BC1";
+    case TEXTURE_BC3: return "BC3";
+    default: return "RGBA8";
+    }
+}
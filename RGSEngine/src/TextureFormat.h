@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Formats of the textures saved on the .rgst files, all of them with the full mip chain
+//   RGBA8: 4 bytes per texel
+//   BC1:   8 bytes per 4x4 block (0.5 per texel), for the opaque textures
+//   BC3:   16 bytes per 4x4 block (1 per texel), BC1 color with an interpolated alpha block
+enum TextureEncoding : uint32_t
+{
+    TEXTURE_RGBA8 = 0,
+    TEXTURE_BC1 = 1,
+    TEXTURE_BC3 = 2
+};
+
+struct TextureLevel
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint64_t offset = 0; // Inside PackedTexture::data
+    uint64_t size = 0;
+};
+
+struct PackedTexture
+{
+    uint32_t encoding = TEXTURE_RGBA8;
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    // Level 0 first, every level goes after the previous one in data
+    std::vector<TextureLevel> levels;
+    std::vector<uint8_t> data;
+
+    bool IsCompressed() const { return encoding != TEXTURE_RGBA8; }
+};
+
+namespace TextureFormat
+{
+    // Bytes of one level, the blocks of the compressed formats cover the texels that don't fill them
+    size_t GetLevelSize(uint32_t encoding, uint32_t width, uint32_t height);
+
+    // Box filtered levels down to 1x1, including the first one
+    std::vector<std::vector<uint8_t>> GenerateMipChain(const uint8_t* rgba, uint32_t width, uint32_t height);
+
+    // 16 RGBA texels of a 4x4 block in rows
+    void CompressBlockBC1(const uint8_t* block, uint8_t* output);
+    void CompressBlockBC3(const uint8_t* block, uint8_t* output);
+
+    // Builds all the levels, with BC1 (opaque) or BC3 (with alpha) if compress is true and the size is a multiple of 4
+    PackedTexture Pack(const uint8_t* rgba, uint32_t width, uint32_t height, bool compress);
+
+    const char* GetEncodingName(uint32_t encoding);
+}
@@ -0,0 +1,127 @@
+#include "TextureStreamer.h"
+#include "ResourceTexture.h"
+#include "TextureFormat.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cstring>
+
+// From EXT_texture_compression_s3tc, supported by every desktop driver
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+static GLenum GetInternalFormat(uint32_t encoding)
+{
+    switch (encoding)
+    {
+    case TEXTURE_BC1: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    case TEXTURE_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    default: return GL_RGBA8;
+    }
+}
+
+void TextureStreamer::Init()
+{
+    const GLsizeiptr size = (GLsizeiptr)(SLOT_SIZE * SLOT_COUNT);
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glGenBuffers(1, &pixelBuffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+    mappedData = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (mappedData == nullptr)
+    {
+        LOG("Texture streamer: Could not map the pixel buffer, the textures will be uploaded directly");
+        glDeleteBuffers(1, &pixelBuffer);
+        pixelBuffer = 0;
+        return;
+    }
+
+    LOG("Texture streamer: %d slots of %d MB", (int)SLOT_COUNT, (int)(SLOT_SIZE / (1024 * 1024)));
+}
+
+void TextureStreamer::CleanUp()
+{
+    for (GLsync& fence : slotFences)
+    {
+        if (fence != nullptr) glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    if (pixelBuffer != 0)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteBuffers(1, &pixelBuffer);
+        pixelBuffer = 0;
+    }
+    mappedData = nullptr;
+}
+
+bool TextureStreamer::Upload(ResourceTexture& texture, const PackedTexture& packed)
+{
+    const size_t size = packed.data.size();
+    const bool useSlot = mappedData != nullptr && size <= SLOT_SIZE;
+
+    size_t slot = nextSlot;
+    if (useSlot && slotFences[slot] != nullptr)
+    {
+        // Only waits if the GPU is still reading the slot from SLOT_COUNT uploads ago
+        GLenum status = glClientWaitSync(slotFences[slot], 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) return false;
+
+        glDeleteSync(slotFences[slot]);
+        slotFences[slot] = nullptr;
+    }
+
+    const GLenum internalFormat = GetInternalFormat(packed.encoding);
+
+    glBindTexture(GL_TEXTURE_2D, texture.textureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexStorage2D(GL_TEXTURE_2D, (GLsizei)packed.levels.size(), internalFormat, packed.width, packed.height);
+
+    // With a buffer bound on GL_PIXEL_UNPACK_BUFFER the pointers are offsets inside it
+    const uint8_t* source = packed.data.data();
+    if (useSlot)
+    {
+        memcpy(mappedData + slot * SLOT_SIZE, packed.data.data(), size);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+        source = (const uint8_t*)(uintptr_t)(slot * SLOT_SIZE);
+    }
+
+    // The levels come already built, there is no glGenerateMipmap
+    for (size_t l = 0; l < packed.levels.size(); ++l)
+    {
+        const TextureLevel& level = packed.levels[l];
+        if (packed.IsCompressed())
+        {
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, (GLint)l, 0, 0, level.width, level.height, internalFormat, (GLsizei)level.size, source + level.offset);
+        }
+        else
+        {
+            glTexSubImage2D(GL_TEXTURE_2D, (GLint)l, 0, 0, level.width, level.height, GL_RGBA, GL_UNSIGNED_BYTE, source + level.offset);
+        }
+    }
+
+    if (useSlot)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        slotFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        nextSlot = (slot + 1) % SLOT_COUNT;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    texture.SetTexture(texture.textureID, packed.width, packed.height, size, packed.encoding);
+    return true;
+}
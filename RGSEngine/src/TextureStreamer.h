@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+
+class ResourceTexture;
+struct PackedTexture;
+
+// Uploads the decoded textures through a ring of pixel buffers mapped once at the start
+// The pixels are copied to a slot that the GPU has already finished reading, so glTexSubImage2D doesn't stall on the copy
+class TextureStreamer
+{
+public:
+
+    // Needs the GL context, called from LoadFiles::Start
+    void Init();
+    void CleanUp();
+
+    // Creates the storage of the texture (already generated on the ResourceTexture) and uploads all the levels, compressed or not
+    // Returns false without touching the texture if all the slots are still in use, the caller tries again the next frame
+    bool Upload(ResourceTexture& texture, const PackedTexture& packed);
+
+    // 16 MB per slot, a BC3 2048x2048 with all its mips fits, a RGBA8 one of that size doesn't
+    // Bigger ones are uploaded directly from the decoded buffer
+    static const size_t SLOT_COUNT = 3;
+    static const size_t SLOT_SIZE = 2048 * 2048 * 4;
+
+private:
+
+    GLuint pixelBuffer = 0;
+    uint8_t* mappedData = nullptr;
+
+    // Signaled when the GPU has read the slot
+    GLsync slotFences[SLOT_COUNT] = {};
+    size_t nextSlot = 0;
+};
@@ -0,0 +1,406 @@
+#include "TransformSystem.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define TRANSFORM_USE_SSE
+#endif
+
+// Levels smaller than this are updated on the main thread, the cost of waking the workers is bigger than the work
+static const uint32_t PARALLEL_LEVEL_THRESHOLD = 2048;
+static const uint32_t PARALLEL_BATCH_SIZE = 512;
+
+// out = a * b for column major matrices, each column of the result is a linear combination of the columns of a
+static inline void MultiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+#ifdef TRANSFORM_USE_SSE
+    const __m128 a0 = _mm_loadu_ps(&a[0][0]);
+    const __m128 a1 = _mm_loadu_ps(&a[1][0]);
+    const __m128 a2 = _mm_loadu_ps(&a[2][0]);
+    const __m128 a3 = _mm_loadu_ps(&a[3][0]);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        __m128 column = _mm_mul_ps(a0, _mm_set1_ps(b[i][0]));
+        column = _mm_add_ps(column, _mm_mul_ps(a1, _mm_set1_ps(b[i][1])));
+        column = _mm_add_ps(column, _mm_mul_ps(a2, _mm_set1_ps(b[i][2])));
+        column = _mm_add_ps(column, _mm_mul_ps(a3, _mm_set1_ps(b[i][3])));
+        _mm_storeu_ps(&out[i][0], column);
+    }
+#else
+    out = a * b;
+#endif
+}
+
+TransformSystem& TransformSystem::GetInstance()
+{
+    static TransformSystem instance;
+    return instance;
+}
+
+TransformHandle TransformSystem::Create()
+{
+    TransformHandle handle;
+    if (!freeHandles.empty())
+    {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    }
+    else
+    {
+        handle = (TransformHandle)handleToIndex.size();
+        handleToIndex.push_back(INVALID_TRANSFORM);
+    }
+
+    // New transforms are roots until the GameObject gives them a parent, appended at the end keeps the order valid
+    uint32_t index = (uint32_t)handles.size();
+    handleToIndex[handle] = index;
+
+    positions.push_back(glm::vec3(0.0f, 0.0f, 0.0f));
+    rotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f)); // Identity quaternion without rotation
+    scales.push_back(glm::vec3(1.0f, 1.0f, 1.0f));
+    localMatrices.push_back(glm::mat4(1.0f));
+    worldMatrices.push_back(glm::mat4(1.0f));
+    parentIndices.push_back(INVALID_TRANSFORM);
+    handles.push_back(handle);
+    localDirty.push_back(1);
+    worldDirty.push_back(1);
+    changed.push_back(0);
+    worldStamps.push_back(0);
+
+    // The new root goes to the depth 0 level
+    orderDirty = true;
+    pendingChanges = true;
+    ++changeStamp;
+    ++aliveCount;
+
+    return handle;
+}
+
+void TransformSystem::Destroy(TransformHandle handle)
+{
+    if (handle >= handleToIndex.size() || handleToIndex[handle] == INVALID_TRANSFORM) return;
+
+    // The slot is removed on the next Reorder, meanwhile its parent index is kept so the childrens can skip it
+    uint32_t index = handleToIndex[handle];
+    handles[index] = INVALID_TRANSFORM;
+    handleToIndex[handle] = INVALID_TRANSFORM;
+    pendingFreeHandles.push_back(handle);
+
+    orderDirty = true;
+    pendingChanges = true;
+    ++changeStamp;
+    --aliveCount;
+}
+
+void TransformSystem::SetParent(TransformHandle handle, TransformHandle parent)
+{
+    uint32_t index = handleToIndex[handle];
+    uint32_t parentIndex = (parent != INVALID_TRANSFORM) ? handleToIndex[parent] : INVALID_TRANSFORM;
+
+    if (parentIndices[index] == parentIndex) return;
+
+    parentIndices[index] = parentIndex;
+    worldDirty[index] = 1;
+
+    orderDirty = true;
+    pendingChanges = true;
+    ++changeStamp;
+}
+
+const glm::vec3& TransformSystem::GetPosition(TransformHandle handle) const
+{
+    return positions[handleToIndex[handle]];
+}
+
+const glm::quat& TransformSystem::GetRotation(TransformHandle handle) const
+{
+    return rotations[handleToIndex[handle]];
+}
+
+const glm::vec3& TransformSystem::GetScale(TransformHandle handle) const
+{
+    return scales[handleToIndex[handle]];
+}
+
+void TransformSystem::SetPosition(TransformHandle handle, const glm::vec3& position)
+{
+    uint32_t index = handleToIndex[handle];
+    positions[index] = position;
+    localDirty[index] = 1;
+    worldDirty[index] = 1;
+    pendingChanges = true;
+    ++changeStamp;
+}
+
+void TransformSystem::SetRotation(TransformHandle handle, const glm::quat& rotation)
+{
+    uint32_t index = handleToIndex[handle];
+    rotations[index] = rotation;
+    localDirty[index] = 1;
+    worldDirty[index] = 1;
+    pendingChanges = true;
+    ++changeStamp;
+}
+
+void TransformSystem::SetScale(TransformHandle handle, const glm::vec3& scale)
+{
+    uint32_t index = handleToIndex[handle];
+    scales[index] = scale;
+    localDirty[index] = 1;
+    worldDirty[index] = 1;
+    pendingChanges = true;
+    ++changeStamp;
+}
+
+glm::mat4 TransformSystem::GetLocalMatrix(TransformHandle handle)
+{
+    uint32_t index = handleToIndex[handle];
+    if (localDirty[index]) ComposeLocal(index);
+    return localMatrices[index];
+}
+
+glm::mat4 TransformSystem::GetWorldMatrix(TransformHandle handle)
+{
+    uint32_t index = handleToIndex[handle];
+
+    // Nothing changed since the last pass, the cached matrix is valid
+    if (!pendingChanges) return worldMatrices[index];
+
+    return ComputeWorld(index);
+}
+
+bool TransformSystem::HasChanged(TransformHandle handle) const
+{
+    return changed[handleToIndex[handle]] != 0;
+}
+
+void TransformSystem::ComposeLocal(uint32_t index)
+{
+    // T * R * S without building the three matrices: rotation columns scaled and the translation on the last column
+    const glm::vec3& s = scales[index];
+    glm::mat4 m = glm::mat4_cast(rotations[index]);
+    m[0] *= s.x;
+    m[1] *= s.y;
+    m[2] *= s.z;
+    m[3] = glm::vec4(positions[index], 1.0f);
+
+    localMatrices[index] = m;
+    localDirty[index] = 0;
+}
+
+const glm::mat4& TransformSystem::ComputeWorld(uint32_t index)
+{
+    if (worldStamps[index] == changeStamp) return worldMatrices[index];
+
+    if (localDirty[index]) ComposeLocal(index);
+
+    uint32_t parent = ResolveParent(index);
+    if (parent == INVALID_TRANSFORM)
+        worldMatrices[index] = localMatrices[index];
+    else
+        MultiplyMatrices(ComputeWorld(parent), localMatrices[index], worldMatrices[index]);
+
+    worldStamps[index] = changeStamp;
+    return worldMatrices[index];
+}
+
+uint32_t TransformSystem::ResolveParent(uint32_t index) const
+{
+    uint32_t parent = parentIndices[index];
+    while (parent != INVALID_TRANSFORM && handles[parent] == INVALID_TRANSFORM)
+    {
+        parent = parentIndices[parent];
+    }
+    return parent;
+}
+
+void TransformSystem::Reorder()
+{
+    const uint32_t count = (uint32_t)handles.size();
+
+    // Depth of each alive transform, calculated once per node walking up until a known depth
+    std::vector<uint32_t> resolvedParents(count, INVALID_TRANSFORM);
+    std::vector<uint32_t> depths(count, INVALID_TRANSFORM);
+    std::vector<uint32_t> stack;
+    uint32_t maxDepth = 0;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (handles[i] == INVALID_TRANSFORM) continue;
+
+        uint32_t parent = ResolveParent(i);
+        resolvedParents[i] = parent;
+
+        // A destroyed parent was skipped, the world matrix of this transform is different now
+        if (parent != parentIndices[i]) worldDirty[i] = 1;
+    }
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (handles[i] == INVALID_TRANSFORM || depths[i] != INVALID_TRANSFORM) continue;
+
+        uint32_t current = i;
+        while (current != INVALID_TRANSFORM && depths[current] == INVALID_TRANSFORM)
+        {
+            stack.push_back(current);
+            current = resolvedParents[current];
+        }
+
+        uint32_t depth = (current == INVALID_TRANSFORM) ? 0 : depths[current] + 1;
+        while (!stack.empty())
+        {
+            depths[stack.back()] = depth++;
+            stack.pop_back();
+        }
+        if (depth > 0 && depth - 1 > maxDepth) maxDepth = depth - 1;
+    }
+
+    // Counting sort by depth, stable so the siblings keep their relative order
+    levelOffsets.assign(maxDepth + 2, 0);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (handles[i] != INVALID_TRANSFORM) ++levelOffsets[depths[i] + 1];
+    }
+    for (uint32_t level = 1; level < levelOffsets.size(); ++level)
+    {
+        levelOffsets[level] += levelOffsets[level - 1];
+    }
+
+    std::vector<uint32_t> newIndices(count, INVALID_TRANSFORM);
+    std::vector<uint32_t> cursor(levelOffsets.begin(), levelOffsets.end() - 1);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (handles[i] != INVALID_TRANSFORM) newIndices[i] = cursor[depths[i]]++;
+    }
+
+    const uint32_t newCount = levelOffsets.back();
+
+    std::vector<glm::vec3> newPositions(newCount);
+    std::vector<glm::quat> newRotations(newCount);
+    std::vector<glm::vec3> newScales(newCount);
+    std::vector<glm::mat4> newLocalMatrices(newCount);
+    std::vector<glm::mat4> newWorldMatrices(newCount);
+    std::vector<uint32_t> newParentIndices(newCount);
+    std::vector<TransformHandle> newHandles(newCount);
+    std::vector<uint8_t> newLocalDirty(newCount);
+    std::vector<uint8_t> newWorldDirty(newCount);
+    std::vector<uint8_t> newChanged(newCount);
+    std::vector<uint32_t> newWorldStamps(newCount);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t n = newIndices[i];
+        if (n == INVALID_TRANSFORM) continue;
+
+        newPositions[n] = positions[i];
+        newRotations[n] = rotations[i];
+        newScales[n] = scales[i];
+        newLocalMatrices[n] = localMatrices[i];
+        newWorldMatrices[n] = worldMatrices[i];
+        newParentIndices[n] = (resolvedParents[i] != INVALID_TRANSFORM) ? newIndices[resolvedParents[i]] : INVALID_TRANSFORM;
+        newHandles[n] = handles[i];
+        newLocalDirty[n] = localDirty[i];
+        newWorldDirty[n] = worldDirty[i];
+        newChanged[n] = changed[i];
+        newWorldStamps[n] = worldStamps[i];
+
+        handleToIndex[handles[i]] = n;
+    }
+
+    positions.swap(newPositions);
+    rotations.swap(newRotations);
+    scales.swap(newScales);
+    localMatrices.swap(newLocalMatrices);
+    worldMatrices.swap(newWorldMatrices);
+    parentIndices.swap(newParentIndices);
+    handles.swap(newHandles);
+    localDirty.swap(newLocalDirty);
+    worldDirty.swap(newWorldDirty);
+    changed.swap(newChanged);
+    worldStamps.swap(newWorldStamps);
+
+    // The dense slots of the destroyed handles don't exist anymore, now they can be reused
+    freeHandles.insert(freeHandles.end(), pendingFreeHandles.begin(), pendingFreeHandles.end());
+    pendingFreeHandles.clear();
+
+    orderDirty = false;
+}
+
+uint32_t TransformSystem::UpdateRange(uint32_t begin, uint32_t end)
+{
+    uint32_t updated = 0;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        // Parents are on a previous level, their changed flag is already final
+        uint32_t parent = parentIndices[i];
+        bool parentChanged = (parent != INVALID_TRANSFORM) && changed[parent];
+
+        if (!worldDirty[i] && !parentChanged)
+        {
+            changed[i] = 0;
+            continue;
+        }
+
+        if (localDirty[i]) ComposeLocal(i);
+
+        if (parent != INVALID_TRANSFORM)
+            MultiplyMatrices(worldMatrices[parent], localMatrices[i], worldMatrices[i]);
+        else
+            worldMatrices[i] = localMatrices[i];
+
+        worldDirty[i] = 0;
+        changed[i] = 1;
+        ++updated;
+    }
+
+    return updated;
+}
+
+void TransformSystem::UpdateWorldMatrices()
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    if (orderDirty) Reorder();
+
+    uint32_t updated = 0;
+
+    if (pendingChanges)
+    {
+        for (size_t level = 0; level + 1 < levelOffsets.size(); ++level)
+        {
+            uint32_t begin = levelOffsets[level];
+            uint32_t end = levelOffsets[level + 1];
+
+            if (end - begin < PARALLEL_LEVEL_THRESHOLD)
+            {
+                updated += UpdateRange(begin, end);
+                continue;
+            }
+
+            // Nodes of the same level only read their parents, so the batches don't depend on each other
+            std::atomic<uint32_t> levelUpdated(0);
+            JobSystem::GetInstance().ParallelFor(end - begin, PARALLEL_BATCH_SIZE, [this, begin, &levelUpdated](uint32_t first, uint32_t last)
+                {
+                    levelUpdated.fetch_add(UpdateRange(begin + first, begin + last), std::memory_order_relaxed);
+                });
+            updated += levelUpdated.load();
+        }
+    }
+    else if (lastUpdatedCount > 0)
+    {
+        // Nothing is dirty, only clear the changed flags of the previous pass
+        std::fill(changed.begin(), changed.end(), (uint8_t)0);
+    }
+
+    pendingChanges = false;
+    lastUpdatedCount = updated;
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    lastUpdateMs = std::chrono::duration<float, std::milli>(endTime - startTime).count();
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+#include <cstdint>
+
+// Handle given to each ComponentTransform, stable while the dense arrays are reordered
+using TransformHandle = uint32_t;
+constexpr TransformHandle INVALID_TRANSFORM = UINT32_MAX;
+
+// Owner of the data of every transform of the scene, stored as Structure of Arrays
+// The dense arrays are sorted so a parent is always before its childrens (grouped by depth),
+// that way the world matrices are calculated in one linear pass over contiguous memory
+// and each depth level can be split between the JobSystem workers
+class TransformSystem
+{
+public:
+
+    // Public method to get the instance of the Singleton
+    static TransformSystem& GetInstance();
+
+    TransformHandle Create();
+    void Destroy(TransformHandle handle);
+
+    // Parent of the transform on the hierarchy, INVALID_TRANSFORM for a root
+    void SetParent(TransformHandle handle, TransformHandle parent);
+
+    // --- Local TRS ---
+    const glm::vec3& GetPosition(TransformHandle handle) const;
+    const glm::quat& GetRotation(TransformHandle handle) const;
+    const glm::vec3& GetScale(TransformHandle handle) const;
+
+    void SetPosition(TransformHandle handle, const glm::vec3& position);
+    void SetRotation(TransformHandle handle, const glm::quat& rotation);
+    void SetScale(TransformHandle handle, const glm::vec3& scale);
+
+    // Local matrix T * R * S
+    glm::mat4 GetLocalMatrix(TransformHandle handle);
+
+    // Parent world * local. Between a change and the next UpdateWorldMatrices it's calculated walking the parents,
+    // so the result is always up to date even if the frame pass didn't run yet. Each result is kept until the next change,
+    // so asking for every transform after a change walks each parent once
+    glm::mat4 GetWorldMatrix(TransformHandle handle);
+
+    // Frame pass, recalculates the world matrices of the dirty transforms and their descendants
+    void UpdateWorldMatrices();
+
+    // True if the world matrix changed on the last UpdateWorldMatrices
+    bool HasChanged(TransformHandle handle) const;
+
+    // --- Stats ---
+    unsigned int GetCount() const { return aliveCount; }
+    unsigned int GetLastUpdatedCount() const { return lastUpdatedCount; }
+    float GetLastUpdateMs() const { return lastUpdateMs; }
+
+private:
+
+    // Private constructor to prevent instantiation
+    TransformSystem() = default;
+    TransformSystem(const TransformSystem&) = delete;
+    TransformSystem& operator=(const TransformSystem&) = delete;
+
+    // Compacts the destroyed slots and sorts the arrays by depth, parents before childrens
+    void Reorder();
+
+    // Updates the range [begin, end) of one depth level, returns how many world matrices changed
+    uint32_t UpdateRange(uint32_t begin, uint32_t end);
+
+    void ComposeLocal(uint32_t index);
+
+    // World matrix without the frame pass, only used while there are pending changes
+    // Written to worldMatrices with the current changeStamp, the frame pass calculates the same value again
+    const glm::mat4& ComputeWorld(uint32_t index);
+
+    // First alive parent, skipping the destroyed ones that are still waiting the Reorder
+    uint32_t ResolveParent(uint32_t index) const;
+
+    // Dense arrays (SoA), all of them with the same size
+    std::vector<glm::vec3> positions;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<glm::mat4> localMatrices;
+    std::vector<glm::mat4> worldMatrices;
+    std::vector<uint32_t> parentIndices;     // Dense index of the parent or INVALID_TRANSFORM
+    std::vector<TransformHandle> handles;    // Dense index -> handle, INVALID_TRANSFORM if destroyed
+    std::vector<uint8_t> localDirty;         // Position, rotation or scale changed
+    std::vector<uint8_t> worldDirty;         // Local or parent changed
+    std::vector<uint8_t> changed;            // World matrix changed on the last pass
+    std::vector<uint32_t> worldStamps;       // changeStamp when ComputeWorld wrote the world matrix
+
+    // Sparse array handle -> dense index
+    std::vector<uint32_t> handleToIndex;
+    std::vector<TransformHandle> freeHandles;
+    // Handles destroyed since the last Reorder, can't be reused while their dense slot exists
+    std::vector<TransformHandle> pendingFreeHandles;
+
+    // Start of each depth level in the dense arrays, the last entry is the size
+    std::vector<uint32_t> levelOffsets;
+
+    bool orderDirty = false;
+    bool pendingChanges = false;
+    uint32_t changeStamp = 1;                // Increased with each change, the results of ComputeWorld are valid while it's the same
+
+    unsigned int aliveCount = 0;
+    unsigned int lastUpdatedCount = 0;
+    float lastUpdateMs = 0.0f;
+};
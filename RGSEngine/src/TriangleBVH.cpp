@@ -0,0 +1,263 @@
+#include "TriangleBVH.h"
+
+#include <algorithm>
+
+// Leaves with this number of triangles or less are not split
+static const uint32_t MAX_LEAF_TRIANGLES = 4;
+static const int SAH_BINS = 8;
+
+void TriangleBVH::Build(const float* positions, unsigned int numVertices, const unsigned int* indices, unsigned int numIndices)
+{
+    nodes.clear();
+    triangles.clear();
+
+    if (positions == nullptr || indices == nullptr || numIndices < 3) return;
+
+    uint32_t triangleCount = numIndices / 3;
+    triangles.reserve(triangleCount);
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+        unsigned int i0 = indices[t * 3 + 0];
+        unsigned int i1 = indices[t * 3 + 1];
+        unsigned int i2 = indices[t * 3 + 2];
+        if (i0 >= numVertices || i1 >= numVertices || i2 >= numVertices) continue;
+
+        Triangle triangle;
+        triangle.v0 = glm::vec3(positions[i0 * 3], positions[i0 * 3 + 1], positions[i0 * 3 + 2]);
+        triangle.v1 = glm::vec3(positions[i1 * 3], positions[i1 * 3 + 1], positions[i1 * 3 + 2]);
+        triangle.v2 = glm::vec3(positions[i2 * 3], positions[i2 * 3 + 1], positions[i2 * 3 + 2]);
+        triangle.index = t;
+        triangles.push_back(triangle);
+    }
+
+    if (triangles.empty()) return;
+
+    std::vector<glm::vec3> centroids(triangles.size());
+    for (size_t t = 0; t < triangles.size(); ++t)
+    {
+        centroids[t] = (triangles[t].v0 + triangles[t].v1 + triangles[t].v2) / 3.0f;
+    }
+
+    // A binary tree with N leaves has at most 2N - 1 nodes
+    nodes.reserve(triangles.size() * 2);
+    nodes.emplace_back();
+    nodes[0].first = 0;
+    nodes[0].count = (uint32_t)triangles.size();
+
+    Subdivide(0, centroids);
+}
+
+void TriangleBVH::Subdivide(uint32_t nodeIndex, std::vector<glm::vec3>& centroids)
+{
+    uint32_t first = nodes[nodeIndex].first;
+    uint32_t count = nodes[nodeIndex].count;
+
+    AABB bounds;
+    AABB centroidBounds;
+    for (uint32_t t = first; t < first + count; ++t)
+    {
+        bounds.Expand(triangles[t].v0);
+        bounds.Expand(triangles[t].v1);
+        bounds.Expand(triangles[t].v2);
+        centroidBounds.Expand(centroids[t]);
+    }
+    nodes[nodeIndex].box = bounds;
+
+    if (count <= MAX_LEAF_TRIANGLES) return;
+
+    glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+    int axis = 0;
+    if (extent.y > extent.x) axis = 1;
+    if (extent.z > extent[axis]) axis = 2;
+
+    // All the centroids on the same point, it can't be split
+    if (extent[axis] <= 0.0f) return;
+
+    // Binned SAH, the split is only done if it's cheaper than testing all the triangles of the node
+    struct Bin
+    {
+        AABB box;
+        uint32_t count = 0;
+    };
+    Bin bins[SAH_BINS];
+
+    float scale = SAH_BINS / extent[axis];
+    auto BinIndex = [&](uint32_t t)
+        {
+            int b = (int)((centroids[t][axis] - centroidBounds.min[axis]) * scale);
+            return std::min(b, SAH_BINS - 1);
+        };
+
+    for (uint32_t t = first; t < first + count; ++t)
+    {
+        Bin& bin = bins[BinIndex(t)];
+        bin.box.Expand(triangles[t].v0);
+        bin.box.Expand(triangles[t].v1);
+        bin.box.Expand(triangles[t].v2);
+        ++bin.count;
+    }
+
+    float leftArea[SAH_BINS - 1];
+    uint32_t leftCount[SAH_BINS - 1];
+    AABB accumulated;
+    uint32_t accumulatedCount = 0;
+    for (int b = 0; b < SAH_BINS - 1; ++b)
+    {
+        accumulated.Expand(bins[b].box);
+        accumulatedCount += bins[b].count;
+        leftArea[b] = accumulated.GetSurfaceArea();
+        leftCount[b] = accumulatedCount;
+    }
+
+    float bestCost = FLT_MAX;
+    int bestSplit = -1;
+    accumulated.Reset();
+    accumulatedCount = 0;
+    for (int b = SAH_BINS - 1; b > 0; --b)
+    {
+        accumulated.Expand(bins[b].box);
+        accumulatedCount += bins[b].count;
+
+        if (leftCount[b - 1] == 0 || accumulatedCount == 0) continue;
+
+        float cost = leftArea[b - 1] * leftCount[b - 1] + accumulated.GetSurfaceArea() * accumulatedCount;
+        if (cost < bestCost)
+        {
+            bestCost = cost;
+            bestSplit = b;
+        }
+    }
+
+    float leafCost = bounds.GetSurfaceArea() * count;
+    if (bestSplit == -1 || bestCost >= leafCost) return;
+
+    // Partition the triangles (and their centroids) on both sides of the split
+    uint32_t i = first;
+    uint32_t j = first + count - 1;
+    while (i <= j)
+    {
+        if (BinIndex(i) < bestSplit)
+        {
+            ++i;
+        }
+        else
+        {
+            std::swap(triangles[i], triangles[j]);
+            std::swap(centroids[i], centroids[j]);
+            if (j == 0) break;
+            --j;
+        }
+    }
+
+    uint32_t leftSize = i - first;
+    if (leftSize == 0 || leftSize == count) return;
+
+    uint32_t leftChild = (uint32_t)nodes.size();
+    nodes.emplace_back();
+    nodes.emplace_back();
+
+    nodes[leftChild].first = first;
+    nodes[leftChild].count = leftSize;
+    nodes[leftChild + 1].first = i;
+    nodes[leftChild + 1].count = count - leftSize;
+
+    // The node becomes internal, first now points to the children
+    nodes[nodeIndex].first = leftChild;
+    nodes[nodeIndex].count = 0;
+
+    Subdivide(leftChild, centroids);
+    Subdivide(leftChild + 1, centroids);
+}
+
+bool TriangleBVH::IntersectTriangle(const Ray& ray, const Triangle& triangle, float maxDistance, float& distance)
+{
+    // Moller-Trumbore, both faces are hit so the picking works on planes seen from behind
+    const float EPSILON = 1e-8f;
+
+    glm::vec3 edge1 = triangle.v1 - triangle.v0;
+    glm::vec3 edge2 = triangle.v2 - triangle.v0;
+    glm::vec3 p = glm::cross(ray.direction, edge2);
+    float determinant = glm::dot(edge1, p);
+    if (std::abs(determinant) < EPSILON) return false;
+
+    float invDeterminant = 1.0f / determinant;
+    glm::vec3 s = ray.origin - triangle.v0;
+    float u = glm::dot(s, p) * invDeterminant;
+    if (u < 0.0f || u > 1.0f) return false;
+
+    glm::vec3 q = glm::cross(s, edge1);
+    float v = glm::dot(ray.direction, q) * invDeterminant;
+    if (v < 0.0f || u + v > 1.0f) return false;
+
+    float t = glm::dot(edge2, q) * invDeterminant;
+    if (t < 0.0f || t >= maxDistance) return false;
+
+    distance = t;
+    return true;
+}
+
+bool TriangleBVH::RayCast(const Ray& ray, float maxDistance, float& hitDistance, uint32_t& hitTriangle) const
+{
+    if (nodes.empty()) return false;
+
+    float entry;
+    if (!ray.Intersects(nodes[0].box, maxDistance, entry)) return false;
+
+    bool hit = false;
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+
+    while (!stack.empty())
+    {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+
+        if (node.count > 0)
+        {
+            for (uint32_t t = node.first; t < node.first + node.count; ++t)
+            {
+                float distance;
+                if (IntersectTriangle(ray, triangles[t], maxDistance, distance))
+                {
+                    maxDistance = distance;
+                    hitDistance = distance;
+                    hitTriangle = triangles[t].index;
+                    hit = true;
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearest child first so the farther one is usually rejected by the closer hit
+        uint32_t left = node.first;
+        uint32_t right = node.first + 1;
+        float entryLeft, entryRight;
+        bool hitLeft = ray.Intersects(nodes[left].box, maxDistance, entryLeft);
+        bool hitRight = ray.Intersects(nodes[right].box, maxDistance, entryRight);
+
+        if (hitLeft && hitRight)
+        {
+            if (entryLeft < entryRight)
+            {
+                stack.push_back(right);
+                stack.push_back(left);
+            }
+            else
+            {
+                stack.push_back(left);
+                stack.push_back(right);
+            }
+        }
+        else if (hitLeft)
+        {
+            stack.push_back(left);
+        }
+        else if (hitRight)
+        {
+            stack.push_back(right);
+        }
+    }
+
+    return hit;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "BoundingVolumes.h"
+
+#include <vector>
+#include <cstdint>
+
+// Static BVH over the triangles of one mesh, in the local space of the mesh
+// Built once from the CPU copy of the vertices and used by the picking for the exact ray test
+class TriangleBVH
+{
+public:
+
+    void Build(const float* positions, unsigned int numVertices, const unsigned int* indices, unsigned int numIndices);
+
+    // Closest triangle hit by the ray before maxDistance, the distance is in units of the ray direction
+    bool RayCast(const Ray& ray, float maxDistance, float& hitDistance, uint32_t& hitTriangle) const;
+
+    size_t GetNodeCount() const { return nodes.size(); }
+    size_t GetTriangleCount() const { return triangles.size(); }
+
+private:
+
+    // Vertices of the triangle copied together so the leaves don't jump through the index buffer
+    struct Triangle
+    {
+        glm::vec3 v0, v1, v2;
+        uint32_t index; // Original triangle index on the mesh
+    };
+
+    // Internal node: firstChild is the left child, the right is firstChild + 1
+    // Leaf: count > 0 and the triangles are [first, first + count)
+    struct Node
+    {
+        AABB box;
+        uint32_t first = 0;
+        uint32_t count = 0;
+    };
+
+    void Subdivide(uint32_t nodeIndex, std::vector<glm::vec3>& centroids);
+
+    static bool IntersectTriangle(const Ray& ray, const Triangle& triangle, float maxDistance, float& distance);
+
+    std::vector<Node> nodes;
+    std::vector<Triangle> triangles;
+};
@@ -0,0 +1,312 @@
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define VERTEX_FORMAT_USE_SSE
+#endif
+
+glm::mat4 PackedMeshLayout::GetDequantizeMatrix() const
+{
+    glm::mat4 matrix(1.0f);
+    if (!HasFlag(VERTEX_QUANTIZED_POSITIONS) || !bounds.IsValid()) return matrix;
+
+    // position = min + quantized * size, as a scale followed by a translation
+    glm::vec3 size = bounds.max - bounds.min;
+    matrix[0][0] = size.x;
+    matrix[1][1] = size.y;
+    matrix[2][2] = size.z;
+    matrix[3] = glm::vec4(bounds.min, 1.0f);
+    return matrix;
+}
+
+glm::vec3 PackedMeshView::GetPosition(uint32_t vertex) const
+{
+    const uint8_t* data = vertices + (size_t)vertex * GetStride();
+
+    if (HasFlag(VERTEX_QUANTIZED_POSITIONS))
+    {
+        uint16_t q[3];
+        memcpy(q, data, sizeof(q));
+        glm::vec3 t(q[0] / 65535.0f, q[1] / 65535.0f, q[2] / 65535.0f);
+        return bounds.min + (bounds.max - bounds.min) * t;
+    }
+
+    glm::vec3 position;
+    memcpy(&position.x, data, 3 * sizeof(float));
+    return position;
+}
+
+glm::vec3 PackedMeshView::GetNormal(uint32_t vertex) const
+{
+    int16_t q[2];
+    memcpy(q, vertices + (size_t)vertex * GetStride() + GetNormalOffset(), sizeof(q));
+    return VertexFormat::OctDecode(q[0], q[1]);
+}
+
+uint32_t PackedMeshView::GetIndex(uint32_t i) const
+{
+    if (HasFlag(VERTEX_INDEX_16))
+    {
+        uint16_t index;
+        memcpy(&index, indices + (size_t)i * sizeof(uint16_t), sizeof(index));
+        return index;
+    }
+
+    uint32_t index;
+    memcpy(&index, indices + (size_t)i * sizeof(uint32_t), sizeof(index));
+    return index;
+}
+
+uint32_t PackedMeshView::GetLodIndex(uint32_t i) const
+{
+    if (HasFlag(VERTEX_INDEX_16))
+    {
+        uint16_t index;
+        memcpy(&index, lodIndices + (size_t)i * sizeof(uint16_t), sizeof(index));
+        return index;
+    }
+
+    uint32_t index;
+    memcpy(&index, lodIndices + (size_t)i * sizeof(uint32_t), sizeof(index));
+    return index;
+}
+
+uint16_t VertexFormat::FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    // NaN stays NaN, too big goes to infinity
+    if (((bits >> 23) & 0xFF) == 0xFF) return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+    if (exponent >= 31) return sign | 0x7C00;
+
+    // Too small for a normal half, denormal or zero
+    if (exponent <= 0)
+    {
+        if (exponent < -10) return sign;
+        mantissa |= 0x800000;
+        uint32_t shift = (uint32_t)(14 - exponent);
+        uint16_t half = (uint16_t)(mantissa >> shift);
+        // Round to nearest
+        if ((mantissa >> (shift - 1)) & 1) ++half;
+        return sign | half;
+    }
+
+    uint16_t half = sign | (uint16_t)(exponent << 10) | (uint16_t)(mantissa >> 13);
+    // Round to nearest, the carry can go to the exponent and it's still correct
+    if (mantissa & 0x1000) ++half;
+    return half;
+}
+
+float VertexFormat::HalfToFloat(uint16_t half)
+{
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+
+    uint32_t bits;
+    if (exponent == 0)
+    {
+        if (mantissa == 0)
+        {
+            bits = sign;
+        }
+        else
+        {
+            // Denormal, normalize it for the float
+            exponent = 127 - 15 + 1;
+            while ((mantissa & 0x400) == 0)
+            {
+                mantissa <<= 1;
+                --exponent;
+            }
+            mantissa &= 0x3FF;
+            bits = sign | (exponent << 23) | (mantissa << 13);
+        }
+    }
+    else if (exponent == 31)
+    {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else
+    {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static int16_t ToSnorm16(float value)
+{
+    return (int16_t)std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+void VertexFormat::OctEncode(const glm::vec3& normal, int16_t& x, int16_t& y)
+{
+    float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (sum <= 0.0f)
+    {
+        x = 0;
+        y = 0;
+        return;
+    }
+
+    // Project on the octahedron and fold the lower half over the upper one
+    glm::vec3 n = normal / sum;
+    glm::vec2 p(n.x, n.y);
+    if (n.z < 0.0f)
+    {
+        p = glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+            (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+    }
+
+    x = ToSnorm16(p.x);
+    y = ToSnorm16(p.y);
+}
+
+glm::vec3 VertexFormat::OctDecode(int16_t x, int16_t y)
+{
+    glm::vec2 p(std::max(x / 32767.0f, -1.0f), std::max(y / 32767.0f, -1.0f));
+    glm::vec3 n(p.x, p.y, 1.0f - std::abs(p.x) - std::abs(p.y));
+
+    if (n.z < 0.0f)
+    {
+        n.x = (1.0f - std::abs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f);
+        n.y = (1.0f - std::abs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f);
+    }
+
+    float length = glm::length(n);
+    return (length > 0.0f) ? n / length : n;
+}
+
+AABB VertexFormat::ComputeBounds(const float* positions, unsigned int count)
+{
+    AABB bounds;
+    unsigned int i = 0;
+
+#ifdef VERTEX_FORMAT_USE_SSE
+    // 4 vertices are 3 registers: x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3, each lane keeps the same component
+    if (count >= 4)
+    {
+        __m128 min0 = _mm_loadu_ps(positions), min1 = _mm_loadu_ps(positions + 4), min2 = _mm_loadu_ps(positions + 8);
+        __m128 max0 = min0, max1 = min1, max2 = min2;
+
+        for (i = 4; i + 4 <= count; i += 4)
+        {
+            const float* p = positions + (size_t)i * 3;
+            __m128 a = _mm_loadu_ps(p), b = _mm_loadu_ps(p + 4), c = _mm_loadu_ps(p + 8);
+            min0 = _mm_min_ps(min0, a);
+            min1 = _mm_min_ps(min1, b);
+            min2 = _mm_min_ps(min2, c);
+            max0 = _mm_max_ps(max0, a);
+            max1 = _mm_max_ps(max1, b);
+            max2 = _mm_max_ps(max2, c);
+        }
+
+        float mins[12], maxs[12];
+        _mm_storeu_ps(mins, min0);
+        _mm_storeu_ps(mins + 4, min1);
+        _mm_storeu_ps(mins + 8, min2);
+        _mm_storeu_ps(maxs, max0);
+        _mm_storeu_ps(maxs + 4, max1);
+        _mm_storeu_ps(maxs + 8, max2);
+
+        for (int v = 0; v < 4; ++v)
+        {
+            bounds.Expand(glm::vec3(mins[v * 3], mins[v * 3 + 1], mins[v * 3 + 2]));
+            bounds.Expand(glm::vec3(maxs[v * 3], maxs[v * 3 + 1], maxs[v * 3 + 2]));
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        bounds.Expand(glm::vec3(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]));
+    }
+    return bounds;
+}
+
+PackedMesh VertexFormat::Pack(const float* positions, unsigned int numVertices,
+    const unsigned int* indices, unsigned int numIndices,
+    const float* texCoords, const float* normals, bool quantizePositions)
+{
+    PackedMesh mesh;
+    mesh.vertexCount = numVertices;
+    mesh.indexCount = numIndices;
+
+    if (quantizePositions) mesh.flags |= VERTEX_QUANTIZED_POSITIONS;
+    if (normals != nullptr) mesh.flags |= VERTEX_HAS_NORMALS;
+    if (texCoords != nullptr) mesh.flags |= VERTEX_HAS_UVS;
+    if (numVertices <= 65536) mesh.flags |= VERTEX_INDEX_16;
+
+    mesh.bounds = ComputeBounds(positions, numVertices);
+
+    const uint32_t stride = mesh.GetStride();
+    mesh.vertices.assign((size_t)numVertices * stride, 0);
+
+    glm::vec3 size = mesh.bounds.IsValid() ? mesh.bounds.max - mesh.bounds.min : glm::vec3(0.0f);
+    glm::vec3 invSize(size.x > 0.0f ? 1.0f / size.x : 0.0f, size.y > 0.0f ? 1.0f / size.y : 0.0f, size.z > 0.0f ? 1.0f / size.z : 0.0f);
+
+    for (unsigned int i = 0; i < numVertices; ++i)
+    {
+        uint8_t* vertex = mesh.vertices.data() + (size_t)i * stride;
+        glm::vec3 position(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]);
+
+        if (quantizePositions)
+        {
+            glm::vec3 t = (position - mesh.bounds.min) * invSize;
+            uint16_t q[4] = {
+                (uint16_t)std::lround(std::clamp(t.x, 0.0f, 1.0f) * 65535.0f),
+                (uint16_t)std::lround(std::clamp(t.y, 0.0f, 1.0f) * 65535.0f),
+                (uint16_t)std::lround(std::clamp(t.z, 0.0f, 1.0f) * 65535.0f),
+                0 };
+            memcpy(vertex, q, sizeof(q));
+        }
+        else
+        {
+            memcpy(vertex, &positions[i * 3], 3 * sizeof(float));
+        }
+
+        if (normals != nullptr)
+        {
+            int16_t q[2];
+            OctEncode(glm::vec3(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2]), q[0], q[1]);
+            memcpy(vertex + mesh.GetNormalOffset(), q, sizeof(q));
+        }
+
+        if (texCoords != nullptr)
+        {
+            uint16_t uv[2] = { FloatToHalf(texCoords[i * 2]), FloatToHalf(texCoords[i * 2 + 1]) };
+            memcpy(vertex + mesh.GetUVOffset(), uv, sizeof(uv));
+        }
+    }
+
+    AppendIndices(mesh.indices, indices, numIndices, mesh.HasFlag(VERTEX_INDEX_16));
+
+    return mesh;
+}
+
+void VertexFormat::AppendIndices(std::vector<uint8_t>& destination, const unsigned int* indices, size_t count, bool index16)
+{
+    const size_t start = destination.size();
+    if (index16)
+    {
+        destination.resize(start + count * sizeof(uint16_t));
+        uint16_t* out = (uint16_t*)(destination.data() + start);
+        for (size_t i = 0; i < count; ++i) out[i] = (uint16_t)indices[i];
+    }
+    else
+    {
+        destination.resize(start + count * sizeof(uint32_t));
+        memcpy(destination.data() + start, indices, count * sizeof(uint32_t));
+    }
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "BoundingVolumes.h"
+#include "Meshlets.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+// Interleaved vertex layout used by the meshes on the GPU and on the .rgs files
+//   position: 4 x uint16 normalized inside the bounds (the 4th is padding) or 3 x float
+//   normal:   2 x int16 normalized, octahedral encoding
+//   uv:       2 x half float
+// 16 bytes per vertex with quantized positions, 20 without, against the 32 of the separated float streams
+enum VertexFlags : uint32_t
+{
+    VERTEX_QUANTIZED_POSITIONS = 1 << 0,
+    VERTEX_HAS_NORMALS = 1 << 1,
+    VERTEX_HAS_UVS = 1 << 2,
+    VERTEX_INDEX_16 = 1 << 3
+};
+
+// Counts, flags and bounds of a packed mesh, enough to know where each attribute is
+struct PackedMeshLayout
+{
+    uint32_t flags = 0;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+
+    // Exact bounds of the original positions, the quantized ones are relative to them
+    AABB bounds;
+
+    bool HasFlag(uint32_t flag) const { return (flags & flag) != 0; }
+
+    uint32_t GetPositionSize() const { return HasFlag(VERTEX_QUANTIZED_POSITIONS) ? 4 * sizeof(uint16_t) : 3 * sizeof(float); }
+    uint32_t GetNormalOffset() const { return GetPositionSize(); }
+    uint32_t GetUVOffset() const { return GetPositionSize() + 2 * sizeof(int16_t); }
+    uint32_t GetStride() const { return GetUVOffset() + 2 * sizeof(uint16_t); }
+    uint32_t GetIndexSize() const { return HasFlag(VERTEX_INDEX_16) ? sizeof(uint16_t) : sizeof(uint32_t); }
+
+    size_t GetVertexBytes() const { return (size_t)vertexCount * GetStride(); }
+    size_t GetIndexBytes() const { return (size_t)indexCount * GetIndexSize(); }
+
+    // Goes from the [0, 1] quantized positions to the local space of the mesh, identity for float positions
+    glm::mat4 GetDequantizeMatrix() const;
+};
+
+// Simplified version of the mesh, its indices go after the ones of the full mesh on the same index buffer
+// and use the same vertices. Stored as it is on the LOD section of the .rgs files
+struct MeshLod
+{
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    float error = 0.0f; // Largest distance the surface moved, in the local units of the mesh
+    uint32_t reserved = 0;
+};
+
+// The full mesh and up to 4 simplified levels
+static const uint32_t MESH_MAX_LODS = 5;
+
+static_assert(sizeof(MeshLod) == 16, "The LODs are read directly from the .rgs file");
+
+// Packed mesh that doesn't own its buffers, they can be on a PackedMesh or directly on a mapped .rgs file
+struct PackedMeshView : PackedMeshLayout
+{
+    const uint8_t* vertices = nullptr;
+    const uint8_t* indices = nullptr;
+
+    // Empty on the files saved before the meshlets
+    const Meshlet* meshlets = nullptr;
+    uint32_t meshletCount = 0;
+
+    // Simplified levels, from the most detailed one, and the indices they use
+    const MeshLod* lods = nullptr;
+    uint32_t lodCount = 0;
+    const uint8_t* lodIndices = nullptr;
+    uint32_t lodIndexCount = 0;
+
+    glm::vec3 GetPosition(uint32_t vertex) const;
+    glm::vec3 GetNormal(uint32_t vertex) const;
+    uint32_t GetIndex(uint32_t i) const;
+
+    // Index i of lodIndices, the first one of a LOD is its firstIndex minus indexCount
+    uint32_t GetLodIndex(uint32_t i) const;
+};
+
+struct PackedMesh : PackedMeshLayout
+{
+    std::vector<uint8_t> vertices;
+    std::vector<uint8_t> indices;
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshLod> lods;
+    std::vector<uint8_t> lodIndices;
+
+    PackedMeshView GetView() const
+    {
+        PackedMeshView view;
+        static_cast<PackedMeshLayout&>(view) = *this;
+        view.vertices = vertices.data();
+        view.indices = indices.data();
+        view.meshlets = meshlets.data();
+        view.meshletCount = (uint32_t)meshlets.size();
+        view.lods = lods.data();
+        view.lodCount = (uint32_t)lods.size();
+        view.lodIndices = lodIndices.data();
+        view.lodIndexCount = (uint32_t)(lodIndices.size() / GetIndexSize());
+        return view;
+    }
+};
+
+namespace VertexFormat
+{
+    uint16_t FloatToHalf(float value);
+    float HalfToFloat(uint16_t half);
+
+    // Unit vector to 2 values in [-1, 1], stored as normalized int16
+    void OctEncode(const glm::vec3& normal, int16_t& x, int16_t& y);
+    glm::vec3 OctDecode(int16_t x, int16_t y);
+
+    // Bounds of count float3 positions, 4 vertices per step with SSE
+    AABB ComputeBounds(const float* positions, unsigned int count);
+
+    // Adds count indices to destination with 16 or 32 bits each
+    void AppendIndices(std::vector<uint8_t>& destination, const unsigned int* indices, size_t count, bool index16);
+
+    // Builds the interleaved buffers from the separated float streams, texCoords and normals can be nullptr
+    PackedMesh Pack(const float* positions, unsigned int numVertices,
+        const unsigned int* indices, unsigned int numIndices,
+        const float* texCoords, const float* normals, bool quantizePositions);
+}
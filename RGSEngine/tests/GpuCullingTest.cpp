@@ -0,0 +1,271 @@
+// GpuCulling against its CPU reference on a synthetic scene, without showing any window
+// Runs on any GL 4.6 driver, Mesa llvmpipe included: SDL_VIDEO_DRIVER=offscreen LIBGL_ALWAYS_SOFTWARE=1 ./GpuCullingTest
+// Exits with 1 when a result of the GPU is different from the CPU one, 2 when there is no GL 4.6 context
+
+#include "GpuCulling.h"
+#include "Shader.h"
+#include "Log.h"
+
+#include <SDL3/SDL.h>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static const int OBJECT_COUNT = 4000;
+static const uint32_t INSTANCES_PER_COMMAND = 4;
+static const uint32_t COMMANDS_PER_RUN = 8;
+static const uint32_t INDICES_PER_COMMAND = 36;
+static const int PYRAMID_SIZE = 256;
+
+// Same layout as the DrawElementsIndirectCommand of Render
+struct TestCommand
+{
+    uint32_t count = 0;
+    uint32_t instanceCount = 0;
+    uint32_t firstIndex = 0;
+    int32_t baseVertex = 0;
+    uint32_t baseInstance = 0;
+};
+
+static_assert(sizeof(TestCommand) == 20, "Layout read by the culling shaders");
+
+// A rectangle on the left half of the screen at a fixed depth, drawn without vertex buffers
+namespace OccluderShaders
+{
+    const char* vertex = R"(
+    #version 460 core
+    uniform float ndcDepth;
+
+    void main()
+    {
+        vec2 corners[4] = vec2[](vec2(-1.0, -1.0), vec2(0.0, -1.0), vec2(-1.0, 1.0), vec2(0.0, 1.0));
+        gl_Position = vec4(corners[gl_VertexID], ndcDepth, 1.0);
+    }
+    )";
+
+    const char* fragment = R"(
+    #version 460 core
+    void main() {}
+    )";
+}
+
+static int RunTest()
+{
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f);
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 viewProjection = projection * view;
+
+    Frustum frustum;
+    frustum.ExtractFromMatrix(viewProjection);
+
+    // Spheres around and in front of the camera, some outside, some behind the occluder 10 units away
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> side(-40.0f, 40.0f);
+    std::uniform_real_distribution<float> depth(-90.0f, 10.0f);
+    std::uniform_real_distribution<float> radius(0.2f, 1.5f);
+
+    std::vector<CullEntry> entries(OBJECT_COUNT);
+    const uint32_t commandCount = (OBJECT_COUNT + INSTANCES_PER_COMMAND - 1) / INSTANCES_PER_COMMAND;
+    const uint32_t runCount = (commandCount + COMMANDS_PER_RUN - 1) / COMMANDS_PER_RUN;
+    for (uint32_t i = 0; i < (uint32_t)OBJECT_COUNT; ++i)
+    {
+        entries[i].sphere = glm::vec4(side(random), side(random), depth(random), radius(random));
+        entries[i].command = i / INSTANCES_PER_COMMAND;
+        entries[i].object = i;
+    }
+
+    // Uploaded like Render does with the GPU culling: no instances yet, each command with its own slots
+    std::vector<TestCommand> commands(commandCount);
+    std::vector<glm::uvec2> commandRuns(commandCount);
+    for (uint32_t c = 0; c < commandCount; ++c)
+    {
+        commands[c].count = INDICES_PER_COMMAND;
+        commands[c].baseInstance = c * INSTANCES_PER_COMMAND;
+        commandRuns[c] = glm::uvec2(c / COMMANDS_PER_RUN, (c / COMMANDS_PER_RUN) * COMMANDS_PER_RUN);
+    }
+
+    unsigned int commandBuffer = 0;
+    unsigned int instanceBuffer = 0;
+    glGenBuffers(1, &commandBuffer);
+    glGenBuffers(1, &instanceBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (size_t)OBJECT_COUNT * sizeof(uint32_t), nullptr, GL_DYNAMIC_READ);
+
+    auto UploadCommands = [&]()
+        {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, commands.size() * sizeof(TestCommand), commands.data(), GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        };
+
+    GpuCulling culling;
+
+    // The depth of the occluder, through the same pass Render uses
+    glm::vec4 occluderClip = projection * glm::vec4(0.0f, 0.0f, -10.0f, 1.0f);
+    Shader occluderShader(OccluderShaders::vertex, OccluderShaders::fragment);
+    unsigned int emptyVAO = 0;
+    glGenVertexArrays(1, &emptyVAO);
+
+    glEnable(GL_DEPTH_TEST);
+    culling.BeginOccluderPass(PYRAMID_SIZE, PYRAMID_SIZE);
+    occluderShader.Use();
+    occluderShader.SetFloat("ndcDepth", occluderClip.z / occluderClip.w);
+    glBindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+    culling.EndOccluderPass(viewProjection, PYRAMID_SIZE, PYRAMID_SIZE);
+
+    UploadCommands();
+    culling.Cull(entries, commandRuns, runCount, commandBuffer, instanceBuffer, frustum, true);
+
+    int failures = 0;
+
+    // Every entry and every texel of the pyramid against the CPU reference
+    unsigned int mismatches = culling.Validate(entries, frustum, true);
+    if (mismatches != 0)
+    {
+        printf("FAIL: %u results or pyramid texels different from the CPU reference\n", mismatches);
+        ++failures;
+    }
+
+    // What the CPU expects on each command, with the same pyramid read back
+    DepthPyramid pyramid;
+    if (!culling.ReadDepthPyramid(pyramid, PYRAMID_SIZE))
+    {
+        printf("FAIL: the occluder pass didn't build a pyramid\n");
+        return 1;
+    }
+
+    uint32_t expectedCounts[3] = { 0, 0, 0 };
+    uint32_t expectedTriangles = 0;
+    std::vector<std::vector<uint32_t>> expectedObjects(commandCount);
+    for (const CullEntry& entry : entries)
+    {
+        CullResult result = GpuCulling::CullReference(entry, frustum, &pyramid);
+        ++expectedCounts[result];
+        if (result == CULL_VISIBLE)
+        {
+            expectedObjects[entry.command].push_back(entry.object);
+            expectedTriangles += INDICES_PER_COMMAND / 3;
+        }
+    }
+
+    printf("%d objects: %u visible, %u outside the frustum, %u occluded\n", OBJECT_COUNT, expectedCounts[CULL_VISIBLE], expectedCounts[CULL_FRUSTUM], expectedCounts[CULL_OCCLUDED]);
+    if (expectedCounts[CULL_VISIBLE] == 0 || expectedCounts[CULL_FRUSTUM] == 0 || expectedCounts[CULL_OCCLUDED] == 0)
+    {
+        printf("FAIL: the scene doesn't reach the three results\n");
+        ++failures;
+    }
+
+    // The compacted commands of each run, with their instance slots
+    std::vector<uint32_t> runCounts(runCount);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, culling.GetRunCountBuffer());
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, runCounts.size() * sizeof(uint32_t), runCounts.data());
+
+    std::vector<TestCommand> drawCommands(commandCount);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, culling.GetDrawBuffer());
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, drawCommands.size() * sizeof(TestCommand), drawCommands.data());
+
+    std::vector<uint32_t> instanceObjects(OBJECT_COUNT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, instanceObjects.size() * sizeof(uint32_t), instanceObjects.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    unsigned int commandErrors = 0;
+    for (uint32_t run = 0; run < runCount; ++run)
+    {
+        const uint32_t first = run * COMMANDS_PER_RUN;
+        const uint32_t last = std::min(first + COMMANDS_PER_RUN, commandCount);
+
+        uint32_t expectedCommands = 0;
+        for (uint32_t c = first; c < last; ++c)
+        {
+            if (!expectedObjects[c].empty()) ++expectedCommands;
+        }
+        if (runCounts[run] != expectedCommands)
+        {
+            ++commandErrors;
+            continue;
+        }
+
+        for (uint32_t d = first; d < first + runCounts[run]; ++d)
+        {
+            const TestCommand& command = drawCommands[d];
+            const uint32_t c = command.baseInstance / INSTANCES_PER_COMMAND;
+            if (c < first || c >= last || command.instanceCount != expectedObjects[c].size())
+            {
+                ++commandErrors;
+                continue;
+            }
+
+            // The order of the slots depends on the atomics, only the set has to match
+            std::vector<uint32_t> drawn(instanceObjects.begin() + command.baseInstance, instanceObjects.begin() + command.baseInstance + command.instanceCount);
+            std::sort(drawn.begin(), drawn.end());
+            std::vector<uint32_t> expected = expectedObjects[c];
+            std::sort(expected.begin(), expected.end());
+            if (drawn != expected) ++commandErrors;
+        }
+    }
+    if (commandErrors != 0)
+    {
+        printf("FAIL: %u runs or compacted commands different from the CPU reference\n", commandErrors);
+        ++failures;
+    }
+
+    // The stats are read one Cull later, once the fence of the first one is signaled
+    glFinish();
+    UploadCommands();
+    culling.Cull(entries, commandRuns, runCount, commandBuffer, instanceBuffer, frustum, true);
+    if (culling.visibleEntries != expectedCounts[CULL_VISIBLE] || culling.frustumCulled != expectedCounts[CULL_FRUSTUM] ||
+        culling.occluded != expectedCounts[CULL_OCCLUDED] || culling.triangles != expectedTriangles)
+    {
+        printf("FAIL: stats %u visible, %u outside, %u occluded, %u triangles\n", culling.visibleEntries, culling.frustumCulled, culling.occluded, culling.triangles);
+        ++failures;
+    }
+
+    glDeleteVertexArrays(1, &emptyVAO);
+    glDeleteBuffers(1, &commandBuffer);
+    glDeleteBuffers(1, &instanceBuffer);
+    glDeleteProgram(occluderShader.ID);
+
+    if (failures == 0) printf("PASS\n");
+    return (failures == 0) ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+    // An environment variable still wins, so a desktop driver can be used too
+    SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+    if (!SDL_Init(SDL_INIT_VIDEO))
+    {
+        printf("SKIP: SDL could not initialize: %s\n", SDL_GetError());
+        return 2;
+    }
+
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 6);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+    SDL_Window* window = SDL_CreateWindow("GpuCullingTest", 64, 64, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    SDL_GLContext context = (window != nullptr) ? SDL_GL_CreateContext(window) : nullptr;
+    if (context == nullptr || !gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress))
+    {
+        printf("SKIP: no OpenGL 4.6 context: %s\n", SDL_GetError());
+        if (window != nullptr) SDL_DestroyWindow(window);
+        SDL_Quit();
+        return 2;
+    }
+    printf("%s, %s\n", (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+
+    int result = RunTest();
+
+    SDL_GL_DestroyContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return result;
+}
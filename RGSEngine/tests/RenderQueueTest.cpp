@@ -0,0 +1,111 @@
+// RenderQueue sort and batching with 10k cube DrawItems, the draw calls counted as SubmitRenderQueue does them:
+// one glDrawElementsInstanced per batch of MIN_INSTANCES or more, one draw per item for the rest
+// Exits with 1 when a queue gets a different number of calls
+
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static const unsigned int CUBE_COUNT = 10000;
+static const unsigned int SHADER_ID = 3;
+static const unsigned int CUBE_GEOMETRY = 1;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static DrawItem MakeCube(unsigned int index, unsigned int textureID, unsigned int geometryID, unsigned int lod)
+{
+	DrawItem item;
+	item.worldMatrix[3] = glm::vec4((float)(index % 100), 0.0f, (float)(index / 100), 1.0f);
+	item.shaderID = SHADER_ID;
+	item.textureID = textureID;
+	item.VAO = geometryID;
+	item.geometryID = geometryID;
+	item.lod = lod;
+	item.sortKey = RenderQueue::MakeSortKey(item.shaderID, item.textureID, item.geometryID, item.lod);
+	return item;
+}
+
+static bool RunQueue(const char* name, std::vector<DrawItem> opaqueQueue, unsigned int expectedDrawCalls, unsigned int expectedInstanced)
+{
+	// Collected in scene order, not in the sorted one
+	std::mt19937 random(1234);
+	std::shuffle(opaqueQueue.begin(), opaqueQueue.end(), random);
+
+	std::vector<DrawItem> blendedQueue;
+	std::vector<RenderQueue::Batch> batches;
+
+	Clock::time_point start = Clock::now();
+	RenderQueue::Sort(opaqueQueue, blendedQueue);
+	RenderQueue::BuildBatches(opaqueQueue, batches);
+	double elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	unsigned int drawCalls = 0;
+	unsigned int instancedDrawCalls = 0;
+	size_t covered = 0;
+	bool valid = true;
+	for (const RenderQueue::Batch& batch : batches)
+	{
+		// Together and in order, every item of a batch able to share the call with the first one
+		valid = valid && (batch.first == covered) && (batch.count > 0);
+		for (size_t k = batch.first; k < batch.first + batch.count && valid; ++k)
+		{
+			valid = RenderQueue::CanShareBatch(opaqueQueue[batch.first], opaqueQueue[k]);
+		}
+		covered += batch.count;
+
+		if (batch.count >= RenderQueue::MIN_INSTANCES)
+		{
+			++drawCalls;
+			++instancedDrawCalls;
+		}
+		else
+		{
+			drawCalls += (unsigned int)batch.count;
+		}
+	}
+	valid = valid && (covered == opaqueQueue.size());
+
+	bool passed = valid && drawCalls == expectedDrawCalls && instancedDrawCalls == expectedInstanced;
+	printf("%s: %zu items, %u draw calls (%u instanced), expected %u (%u instanced), sort and batch %.3f ms: %s\n",
+		name, opaqueQueue.size(), drawCalls, instancedDrawCalls, expectedDrawCalls, expectedInstanced, elapsedMs, passed ? "ok" : "FAIL");
+	return passed;
+}
+
+int main()
+{
+	bool passed = true;
+
+	// The same cube everywhere, a single instanced call
+	std::vector<DrawItem> queue;
+	for (unsigned int i = 0; i < CUBE_COUNT; ++i) queue.push_back(MakeCube(i, 10, CUBE_GEOMETRY, 0));
+	passed = RunQueue("Same cube", queue, 1, 1) && passed;
+
+	// 4 textures and 3 LODs, a call for each of the 12 groups, and 5 other meshes drawn alone
+	queue.clear();
+	for (unsigned int i = 0; i < CUBE_COUNT; ++i) queue.push_back(MakeCube(i, 10 + i % 4, CUBE_GEOMETRY, (i / 4) % 3));
+	for (unsigned int i = 0; i < 5; ++i) queue.push_back(MakeCube(i, 10, CUBE_GEOMETRY + 1 + i, 0));
+	passed = RunQueue("Textures and LODs", queue, 12 + 5, 12) && passed;
+
+	// Every 10th cube alpha tested, the same key as the rest but a batch of its own
+	queue.clear();
+	for (unsigned int i = 0; i < CUBE_COUNT; ++i)
+	{
+		DrawItem item = MakeCube(i, 10, CUBE_GEOMETRY, 0);
+		item.alphaTest = (i % 10 == 0);
+		item.alphaThreshold = item.alphaTest ? 0.5f : 0.0f;
+		queue.push_back(item);
+	}
+	passed = RunQueue("Alpha tested cubes", queue, 2, 2) && passed;
+
+	// Every cube with its own texture, nothing to instance
+	queue.clear();
+	for (unsigned int i = 0; i < CUBE_COUNT; ++i) queue.push_back(MakeCube(i, 10 + i, CUBE_GEOMETRY, 0));
+	passed = RunQueue("Unique textures", queue, CUBE_COUNT, 0) && passed;
+
+	printf(passed ? "PASS\n" : "FAIL\n");
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+// SoftwareOcclusion and DepthPyramid on the CPU: a wall covering the left of the screen and small boxes behind it
+// A box just past the edge of the wall, inside the texel the edge crosses, must stay visible
+// Exits with 1 when a box gets the wrong result
+
+#include "SoftwareOcclusion.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+static const float FOV = 60.0f;
+static const float WALL_DISTANCE = 10.0f;
+static const float BOX_DEPTH = 0.5f;
+
+// Texel column 128 is crossed by the edge of the wall, its centre is covered but not all of it
+static const float WALL_EDGE_TEXEL = 128.6f;
+
+static float TexelToNdc(float texel) { return texel / SoftwareOcclusion::WIDTH * 2.0f - 1.0f; }
+
+// A box whose far face is at distance and whose rectangle on the screen stays between the texels given, on both axes
+static AABB BoxBetweenTexels(float firstTexel, float lastTexel, float distance)
+{
+    // With aspect 1 the x and the y of a point at distance d are ndc * d * tan(fov / 2)
+    // Of the near and the far face, the one whose corner is nearer to the centre of the screen
+    const float halfHeight = std::tan(glm::radians(FOV * 0.5f));
+    const float farDistance = distance;
+    const float nearDistance = distance - BOX_DEPTH;
+    const float first = TexelToNdc(firstTexel) * halfHeight;
+    const float last = TexelToNdc(lastTexel) * halfHeight;
+
+    AABB box;
+    const float minCoord = std::max(first * farDistance, first * nearDistance);
+    const float maxCoord = std::min(last * farDistance, last * nearDistance);
+    box.min = glm::vec3(minCoord, minCoord, -farDistance);
+    box.max = glm::vec3(maxCoord, maxCoord, -nearDistance);
+    return box;
+}
+
+static bool Check(const char* name, bool result, bool expected)
+{
+    printf("%s: %s\n", name, (result == expected) ? "ok" : "FAIL");
+    return result == expected;
+}
+
+int main()
+{
+    const glm::mat4 projection = glm::perspective(glm::radians(FOV), 1.0f, 0.1f, 100.0f);
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    // Tall enough that the diagonal of the quad is outside of the screen
+    const float halfHeight = std::tan(glm::radians(FOV * 0.5f));
+    const float edge = TexelToNdc(WALL_EDGE_TEXEL) * WALL_DISTANCE * halfHeight;
+    const float positions[] =
+    {
+        -20.0f, -100.0f, -WALL_DISTANCE,
+        edge, -100.0f, -WALL_DISTANCE,
+        edge, 100.0f, -WALL_DISTANCE,
+        -20.0f, 100.0f, -WALL_DISTANCE
+    };
+    const unsigned int indices[] = { 0, 1, 2, 0, 2, 3 };
+
+    SoftwareOcclusion occlusion;
+    occlusion.Begin(1.0f, projection * view);
+    occlusion.RasterizeMesh(positions, indices, 6, glm::mat4(1.0f));
+    occlusion.End();
+
+    bool passed = Check("Wall triangles", occlusion.GetTriangleCount() == 2, true);
+
+    // Inside the texel the edge crosses, to its right, less than a texel from the wall
+    passed = Check("Box past the edge of the wall", occlusion.IsOccluded(BoxBetweenTexels(WALL_EDGE_TEXEL + 0.1f, WALL_EDGE_TEXEL + 0.35f, 20.0f)), false) && passed;
+
+    // Well inside the wall, on the right of it and in front of it
+    passed = Check("Box behind the wall", occlusion.IsOccluded(BoxBetweenTexels(98.0f, 103.0f, 20.0f)), true) && passed;
+    passed = Check("Box right of the wall", occlusion.IsOccluded(BoxBetweenTexels(158.0f, 163.0f, 20.0f)), false) && passed;
+    passed = Check("Box in front of the wall", occlusion.IsOccluded(BoxBetweenTexels(98.0f, 103.0f, 5.0f)), false) && passed;
+
+    printf(passed ? "PASS\n" : "FAIL\n");
+    return passed ? 0 : 1;
+}